@@ -0,0 +1,78 @@
+//
+//  Arena.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 每个工作线程一个的线性分配器（arena），给模拟器、payoff、折现等提供临时内存。
+// 分配只是移动指针，按64字节对齐（AVX-512一整条缓存行），用Scope在路径块结束后整体回退，稳态下不再调用malloc。
+
+# ifndef Arena_hpp
+# define Arena_hpp
+
+# include <cstddef>
+# include <vector>
+# include <Eigen/Dense>
+
+class Arena {
+public:
+    static constexpr std::size_t kAlignment = 64;
+
+    explicit Arena(std::size_t capacity, bool useHugePages = false);
+    virtual ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // 当前线程的arena。第一次使用时按configure设置的容量和是否使用大页创建
+    static Arena& local();
+    static void configure(std::size_t capacity, bool useHugePages);
+
+    void* allocate(std::size_t bytes);
+    template<typename T>
+    T* allocate_array(std::size_t count);
+    Eigen::Map<Eigen::MatrixXd, Eigen::Aligned64> allocate_matrix(Eigen::Index rows, Eigen::Index cols);
+    Eigen::Map<Eigen::VectorXd, Eigen::Aligned64> allocate_vector(Eigen::Index size);
+
+    std::size_t mark() const;
+    // 回退到mark。回退到0且没有打开的Scope时释放溢出块，并把主缓冲区扩大到历史峰值，之后同样规模的路径块不会再溢出。
+    // 溢出块不移动offset，嵌套的Scope也可能从0开始，所以只能在最外层Scope结束时释放，否则会释放外层仍在使用的内存
+    void rewind(std::size_t mark);
+    void reset();
+
+    std::size_t capacity() const;
+    std::size_t used() const;
+    bool usesHugePages() const;
+
+    // 作用域内的分配在析构时整体回退
+    class Scope {
+    public:
+        explicit Scope(Arena& arena);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        Arena& arena_;
+        std::size_t mark_;
+    };
+
+private:
+    char* buffer_;
+    std::size_t capacity_;
+    std::size_t offset_;
+    bool useHugePages_;
+    bool mapped_;                       // buffer_是否来自mmap（大页）
+    std::vector<void*> overflow_;       // 主缓冲区放不下时临时从堆上分配的块
+    std::size_t overflowBytes_;
+    std::size_t peak_;
+    int scopeDepth_;                    // 当前打开的Scope层数
+
+    void allocate_buffer(std::size_t capacity);
+    void release_buffer();
+};
+
+template<typename T>
+T* Arena::allocate_array(std::size_t count) {
+    return static_cast<T*>(allocate(count * sizeof(T)));
+}
+
+# endif /* Arena_hpp */
@@ -21,8 +21,6 @@ public:
     GeometricBrownianMotionModel(const Parameters& params);
     virtual ~GeometricBrownianMotionModel() = default;
     double simulatePrice(const Parameters& params) const override;
-private:
-    double dt_;
 };
 
 class JumpDiffusionPriceModel : public AssetPriceModel {
@@ -32,7 +30,6 @@ public:
     double simulatePrice(const Parameters& params) const override;
 
 private:
-    double dt_;
     double jumpMean_JDPM_;      // class定义时需要输入的参数，此外的参数都是需要后续外部引入的
     double jumpVol_JDPM_;
     double jumpIntensity_JDPM_;
@@ -0,0 +1,34 @@
+//
+//  BlackScholes.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 欧式期权的Black-Scholes闭式价格和希腊字母（连续复利无风险利率，无股息）。
+// 向量版本对一整批标的价格/波动率一次计算，用于风险情景的全量重估和对冲回测
+
+# ifndef BlackScholes_hpp
+# define BlackScholes_hpp
+
+# include <Eigen/Dense>
+# include "SensitivityAnalysis.hpp"
+
+class BlackScholes {
+public:
+    static double price(bool isCall, double spot, double strike, double rate, double volatility, double maturity);
+    static Greeks greeks(bool isCall, double spot, double strike, double rate, double volatility, double maturity);
+
+    // prices(i) = price(isCall, spots(i), strike, rate, volatilities(i), maturity)
+    static void price(bool isCall, const Eigen::Ref<const Eigen::ArrayXd>& spots, double strike, double rate,
+                      const Eigen::Ref<const Eigen::ArrayXd>& volatilities, double maturity, Eigen::Ref<Eigen::ArrayXd> prices);
+    // 价格、delta、gamma一起计算，共用d1、d2
+    static void greeks(bool isCall, const Eigen::Ref<const Eigen::ArrayXd>& spots, double strike, double rate,
+                       const Eigen::Ref<const Eigen::ArrayXd>& volatilities, double maturity,
+                       Eigen::Ref<Eigen::ArrayXd> prices, Eigen::Ref<Eigen::ArrayXd> deltas, Eigen::Ref<Eigen::ArrayXd> gammas);
+    static void delta(bool isCall, const Eigen::Ref<const Eigen::ArrayXd>& spots, double strike, double rate,
+                      const Eigen::Ref<const Eigen::ArrayXd>& volatilities, double maturity, Eigen::Ref<Eigen::ArrayXd> deltas);
+
+    static double normal_cdf(double x);
+};
+
+# endif /* BlackScholes_hpp */
@@ -4,10 +4,92 @@
 //
 //  Created by 俊延 on 2024/7/5.
 //
+// 市场数据接口：CSV只在第一次使用时转换为列式二进制文件，之后用mmap映射，按标的和日期区间零拷贝地读取。
+// CSV第一行为列名，前两列固定为symbol和date，其余列都是数值列。日期写作YYYY-MM-DD或YYYYMMDD，统一存为整数YYYYMMDD；
+// 其他列中形如YYYY-MM-DD的值（例如expiry）同样转成YYYYMMDD，C/P（call/put）转成1/0。例如：
+//   现货历史   symbol,date,close
+//   期权快照   symbol,date,expiry,strike,type,bid,ask
+// 行按(symbol, date, 其余各列)排序，所以同一标的的日期区间、同一天同一到期日的整条行权价序列都是连续的行，可以直接映射为Eigen向量，
+// 交给GARCHCalibrator::fit、SABRImpliedVolatility::calibrate等函数。
 
 # ifndef DataInterface_hpp
 # define DataInterface_hpp
 
-# include <stdio.h>
+# include <string>
+# include <vector>
+# include <cstdint>
+# include <cstddef>
+# include <Eigen/Dense>
+
+class MarketDataStore;
+
+// 一段连续的行[begin, end)，列以Eigen::Map的形式返回，指向映射的文件本身，在MarketDataStore存活期间有效
+class MarketDataSlice {
+public:
+    MarketDataSlice(const MarketDataStore& store, std::size_t begin, std::size_t end);
+
+    Eigen::Index size() const;
+    Eigen::Map<const Eigen::VectorXi> dates() const;
+    Eigen::Map<const Eigen::VectorXd> column(const std::string& name) const;
+    Eigen::Map<const Eigen::ArrayXd> array(const std::string& name) const;
+
+    // 在本区间内取某一列等于value的子区间，要求该列在区间内有序：例如单个日期内的expiry，或者固定expiry后的strike
+    MarketDataSlice equal_range(const std::string& name, double value) const;
+    // 相邻两行价格的对数收益率ln(P_t / P_{t-1})，长度为size() - 1（需要新建向量，不是视图）
+    Eigen::VectorXd log_returns(const std::string& name = "close") const;
+
+private:
+    const MarketDataStore* store_;
+    std::size_t begin_;
+    std::size_t end_;
+};
+
+class MarketDataStore {
+public:
+    // 把CSV转换为列式二进制文件。整个CSV只读一遍，按列存入内存后排序写出
+    static void convert_csv(const std::string& csvPath, const std::string& binaryPath);
+    // 二进制文件不存在或者比CSV旧时先转换，然后打开
+    static MarketDataStore open_csv(const std::string& csvPath, const std::string& binaryPath);
+
+    explicit MarketDataStore(const std::string& binaryPath);
+    virtual ~MarketDataStore();
+    MarketDataStore(const MarketDataStore&) = delete;
+    MarketDataStore& operator=(const MarketDataStore&) = delete;
+    MarketDataStore(MarketDataStore&& other) noexcept;
+    MarketDataStore& operator=(MarketDataStore&& other) = delete;
+
+    std::size_t getNumRows() const;
+    const std::vector<std::string>& getColumnNames() const;
+    std::vector<std::string> getSymbols() const;
+
+    // 标的在[fromDate, toDate]（YYYYMMDD，闭区间）内的所有行；标的不存在时抛出异常，区间内没有数据时返回空区间
+    MarketDataSlice slice(const std::string& symbol, int fromDate, int toDate) const;
+    MarketDataSlice slice(const std::string& symbol) const;
+
+    // YYYYMMDD两个日期之间的自然日天数（b - a），期权快照中由date和expiry计算到期时间
+    static long days_between(int a, int b);
+
+private:
+    friend class MarketDataSlice;
+
+    struct SymbolEntry {
+        std::string name;
+        std::size_t firstRow;
+        std::size_t numRows;
+    };
+
+    void* mapping_;
+    std::size_t mappingSize_;
+    bool mapped_;               // false时mapping_为整个文件读入的缓冲区（不支持mmap的平台）
+    std::size_t numRows_;
+    std::vector<std::string> columnNames_;
+    std::vector<SymbolEntry> symbols_;      // 按名称排序
+    const std::int32_t* dates_;
+    std::vector<const double*> columns_;
+
+    void release();
+    std::size_t column_index(const std::string& name) const;
+    const SymbolEntry& find_symbol(const std::string& symbol) const;
+};
 
 # endif /* DataInterface_hpp */
@@ -0,0 +1,66 @@
+//
+//  FloatPathValidation.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 单精度路径模式（floatPaths）的验收报告：同一组随机数分别用双精度和单精度推进路径，在同一批路径上对比各个payoff的价格。
+// 两种模式使用完全相同的dW，价格之差只来自单精度的舍入误差，与蒙特卡罗误差无关，因此用配对差值的均值和标准误衡量，
+// 并要求差值不超过双精度价格标准误的floatValidationTolerance倍（默认0.1），即单精度误差远小于模拟本身的统计误差。
+// 需要的参数：PricingModel各模型的参数（GBM + 常数波动率 + 确定性利率）、spot、strike、numSteps、dt、volatility；
+// 可选floatValidationPaths（默认100000，至少2，不必是路径块大小的倍数）、floatValidationTolerance、seed，障碍期权的barrier（默认0.8 * spot）
+
+# ifndef FloatPathValidation_hpp
+# define FloatPathValidation_hpp
+
+# include <string>
+# include <vector>
+# include <ostream>
+# include <Eigen/Dense>
+# include "Parameters.hpp"
+
+class PricingModel;
+class Payoff;
+
+struct FloatPathComparison {
+    std::string payoff;
+    double doublePrice;
+    double floatPrice;
+    double difference;                  // floatPrice - doublePrice
+    double differenceStandardError;     // 配对差值的标准误
+    double standardError;               // 双精度价格的标准误
+    double relativeDifference;          // |difference| / doublePrice
+    bool passed;
+};
+
+struct FloatPathReport {
+    std::vector<FloatPathComparison> comparisons;
+    double maxTerminalRelativeError;    // 所有路径上期末价格的最大相对误差
+    double doubleSeconds;               // 双精度模拟耗时（路径生成、payoff和折现）
+    double floatSeconds;
+    long numPaths;
+    bool passed;
+};
+
+class FloatPathValidation {
+public:
+    FloatPathValidation(const PricingModel& pricingModel, const Parameters& params);
+    virtual ~FloatPathValidation() = default;
+
+    // 标准payoff：欧式看涨、欧式看跌、亚式、回溯、向下敲出看涨
+    FloatPathReport run() const;
+    FloatPathReport run(const std::vector<const Payoff*>& payoffs) const;
+
+    static void print(const FloatPathReport& report, std::ostream& out);
+
+private:
+    const PricingModel& pricingModel_;
+    Parameters params_;
+    long numPaths_;
+    double tolerance_;
+
+    // 生成所有路径块，把每个payoff的折现值写入discounted（路径数 x payoff数），期末价格写入terminal，返回耗时（秒）
+    double simulate(bool floatPaths, const std::vector<const Payoff*>& payoffs, Eigen::MatrixXd& discounted, Eigen::VectorXd& terminal) const;
+};
+
+# endif /* FloatPathValidation_hpp */
@@ -0,0 +1,50 @@
+//
+//  GARCHCalibration.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// GARCH(1,1)的极大似然估计：h_t = alpha0 + alpha1 * e_{t-1}^2 + beta * h_{t-1}，
+// 对数似然和解析梯度在一次方差递推中同时得到，多个序列交给工作窃取调度器并行拟合
+
+# ifndef GARCHCalibration_hpp
+# define GARCHCalibration_hpp
+
+# include <string>
+# include <vector>
+# include <unordered_map>
+# include <Eigen/Dense>
+# include "Parameters.hpp"
+
+struct GARCHFit {
+    double alpha0;
+    double alpha1;
+    double beta;
+    double logLikelihood;
+    double nextVolatility;      // 样本末尾之后一期的条件波动率sqrt(h_{n+1})，与GARCHModel的vt同为单期尺度
+    int iterations;
+    bool converged;
+};
+
+class GARCHCalibrator {
+public:
+    // 可选参数garchMaxIterations（默认200）、garchTolerance（平均对数似然梯度的范数阈值，默认1e-8）
+    explicit GARCHCalibrator(const Parameters& params);
+    virtual ~GARCHCalibrator() = default;
+
+    // returns为去均值前的收益率序列
+    GARCHFit fit(const Eigen::Ref<const Eigen::VectorXd>& returns) const;
+
+    // 并行拟合多个序列，结果写入results[name]中的alpha0_GARCHM、alpha1_GARCHM、beta_GARCHM、volatility、garchLogLikelihood和garchConverged，
+    // 已有的其他参数保持不变
+    void fit_all(const std::vector<std::string>& names, const std::vector<Eigen::VectorXd>& returns, std::unordered_map<std::string, Parameters>& results) const;
+
+    // 对数似然及其对(alpha0, alpha1, beta)的梯度。squaredResiduals为去均值后收益率的平方，h_1取样本方差
+    static double log_likelihood(const Eigen::Ref<const Eigen::VectorXd>& squaredResiduals, double alpha0, double alpha1, double beta, Eigen::Vector3d& gradient);
+
+private:
+    int maxIterations_;
+    double tolerance_;
+};
+
+# endif /* GARCHCalibration_hpp */
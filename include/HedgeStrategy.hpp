@@ -8,35 +8,54 @@
 # ifndef HedgeStrategy_hpp
 # define HedgeStrategy_hpp
 
-// 抽象对冲策略基类
+# include <Eigen/Dense>
+
+// 抽象对冲策略基类。hedge返回每单位多头期权对应的标的头寸价值（除以spotPrice即为持股数）
 class HedgeStrategy {
 public:
     virtual ~HedgeStrategy() = default;
     virtual double hedge(double spotPrice, double optionPrice, double delta, double gamma) const = 0;
+    // 对一个时间步的所有路径一次计算，hedges(i) = hedge(spots(i), optionPrices(i), deltas(i), gammas(i))。
+    // 默认实现逐个调用hedge，派生类用数组运算重写，回测时避免每条路径一次虚函数调用
+    virtual void hedgeColumn(const Eigen::Ref<const Eigen::ArrayXd>& spots, const Eigen::Ref<const Eigen::ArrayXd>& optionPrices,
+                             const Eigen::Ref<const Eigen::ArrayXd>& deltas, const Eigen::Ref<const Eigen::ArrayXd>& gammas,
+                             Eigen::Ref<Eigen::ArrayXd> hedges) const;
 };
 
 // Delta对冲策略
 class DeltaHedge : public HedgeStrategy {
 public:
     double hedge(double spotPrice, double optionPrice, double delta, double gamma) const override;
+    void hedgeColumn(const Eigen::Ref<const Eigen::ArrayXd>& spots, const Eigen::Ref<const Eigen::ArrayXd>& optionPrices,
+                     const Eigen::Ref<const Eigen::ArrayXd>& deltas, const Eigen::Ref<const Eigen::ArrayXd>& gammas,
+                     Eigen::Ref<Eigen::ArrayXd> hedges) const override;
 };
 
 // Delta-Gamma对冲策略
 class DeltaGammaHedge : public HedgeStrategy {
 public:
     double hedge(double spotPrice, double optionPrice, double delta, double gamma) const override;
+    void hedgeColumn(const Eigen::Ref<const Eigen::ArrayXd>& spots, const Eigen::Ref<const Eigen::ArrayXd>& optionPrices,
+                     const Eigen::Ref<const Eigen::ArrayXd>& deltas, const Eigen::Ref<const Eigen::ArrayXd>& gammas,
+                     Eigen::Ref<Eigen::ArrayXd> hedges) const override;
 };
 
 // 本地对冲策略
 class LocalHedge : public HedgeStrategy {
 public:
     double hedge(double spotPrice, double optionPrice, double delta, double gamma) const override;
+    void hedgeColumn(const Eigen::Ref<const Eigen::ArrayXd>& spots, const Eigen::Ref<const Eigen::ArrayXd>& optionPrices,
+                     const Eigen::Ref<const Eigen::ArrayXd>& deltas, const Eigen::Ref<const Eigen::ArrayXd>& gammas,
+                     Eigen::Ref<Eigen::ArrayXd> hedges) const override;
 };
 
 // 动态对冲策略
 class DynamicHedge : public HedgeStrategy {
 public:
     double hedge(double spotPrice, double optionPrice, double delta, double gamma) const override;
+    void hedgeColumn(const Eigen::Ref<const Eigen::ArrayXd>& spots, const Eigen::Ref<const Eigen::ArrayXd>& optionPrices,
+                     const Eigen::Ref<const Eigen::ArrayXd>& deltas, const Eigen::Ref<const Eigen::ArrayXd>& gammas,
+                     Eigen::Ref<Eigen::ArrayXd> hedges) const override;
 };
 
 # endif // HEDGESTRATEGY_HPP
@@ -0,0 +1,58 @@
+//
+//  HedgingBacktest.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 在模拟路径上回放离散对冲：期初以Black-Scholes价格买入（或卖出）期权，按HedgeStrategy在每个调仓时点调整标的头寸，
+// 调仓按PricingModel中的TransactionCost收费，现金按路径上的短期利率计息，到期结算payoff后得到每条路径的对冲盈亏。
+// 一个时间步的所有路径一次处理（hedgeColumn、getCostColumn），路径块之间并行。
+// 需要的参数：PricingModel各模型的参数、numSteps、dt、strike；可选hedgePaths（默认10000）、hedgeInterval（每几步调仓一次，默认1）、
+// hedgeThreshold（持股变化不超过该值时不调仓，默认0）、hedgeVolatility（对冲者使用的波动率，默认用模拟的波动率路径）、
+// hedgeOptionPosition（期权数量，默认-1即卖出一份期权并对冲）、seed
+
+# ifndef HedgingBacktest_hpp
+# define HedgingBacktest_hpp
+
+# include <vector>
+# include <utility>
+# include <Eigen/Dense>
+# include "Parameters.hpp"
+
+class PricingModel;
+class HedgeStrategy;
+
+struct HedgingReport {
+    double premium;                 // 期初期权的单位价格
+    double mean;                    // 到期时对冲盈亏（终值）的均值
+    double stdev;
+    std::vector<std::pair<double, double>> quantiles;   // (概率, 分位数)
+    double averageRebalances;       // 每条路径的平均调仓次数
+    double averageCost;             // 每条路径的平均交易成本
+    long numPaths;
+    Eigen::VectorXd pnl;            // 每条路径的盈亏
+};
+
+class HedgingBacktest {
+public:
+    // 期权的Greeks使用Black-Scholes闭式解，因此payoff必须是EuropeanCallPayoff或EuropeanPutPayoff
+    HedgingBacktest(const PricingModel& pricingModel, const HedgeStrategy& strategy, const Parameters& params);
+    virtual ~HedgingBacktest() = default;
+
+    HedgingReport run() const;
+
+private:
+    const PricingModel& pricingModel_;
+    const HedgeStrategy& strategy_;
+    Parameters params_;
+    bool isCall_;
+    long numPaths_;
+    int hedgeInterval_;
+    double hedgeThreshold_;
+    double optionPosition_;
+
+    // 一个路径块的回测，写入该块每条路径的盈亏、调仓次数和交易成本（最后一个块不足200条路径时只写入前pnl.size()条）
+    void backtest_block(unsigned int blockSeed, Eigen::Ref<Eigen::VectorXd> pnl, Eigen::Ref<Eigen::VectorXd> rebalances, Eigen::Ref<Eigen::VectorXd> costs) const;
+};
+
+# endif /* HedgingBacktest_hpp */
@@ -8,6 +8,24 @@
 #ifndef ImpliedVolatility_hpp
 #define ImpliedVolatility_hpp
 
-#include <stdio.h>
+#include <Eigen/Dense>
+
+class Parameters;
+
+enum class SABRExpansion {
+    Hagan,      // Hagan et al. (2002) 对数正态展开
+    Obloj       // Obloj (2008) 修正的首项，远离平值和beta < 1时更准确，修正项与Hagan相同
+};
+
+// SABR模型的闭式隐含波动率：对同一到期日的整组行权价一次计算，使用Parameters中的alpha_SABRM、beta_SABRM、rho_SABRM、nu_SABRM
+class SABRImpliedVolatility {
+public:
+    static void implied_volatility(double forward, double maturity, const Parameters& params, const Eigen::Ref<const Eigen::ArrayXd>& strikes, Eigen::Ref<Eigen::ArrayXd> volatilities, SABRExpansion expansion = SABRExpansion::Obloj);
+    static void implied_volatility(double forward, double maturity, double alpha, double beta, double rho, double nu, const Eigen::Ref<const Eigen::ArrayXd>& strikes, Eigen::Ref<Eigen::ArrayXd> volatilities, SABRExpansion expansion = SABRExpansion::Obloj);
+
+    // 单个到期日切片的校准：beta_SABRM固定，用Levenberg-Marquardt拟合alpha、rho、nu使隐含波动率的平方误差最小，
+    // 结果写回params（已有的alpha_SABRM、rho_SABRM、nu_SABRM作为初值），返回拟合的均方根误差
+    static double calibrate(double forward, double maturity, const Eigen::Ref<const Eigen::ArrayXd>& strikes, const Eigen::Ref<const Eigen::ArrayXd>& marketVolatilities, Parameters& params, SABRExpansion expansion = SABRExpansion::Obloj);
+};
 
 #endif /* ImpliedVolatility_hpp */
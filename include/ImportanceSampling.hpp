@@ -0,0 +1,24 @@
+//
+//  ImportanceSampling.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 重要性抽样：平移标的资产布朗运动的漂移，让深度虚值期权和敲入障碍期权的路径更多地落在有支付的区域
+
+# ifndef ImportanceSampling_hpp
+# define ImportanceSampling_hpp
+
+class Parameters;
+class PricingModel;
+
+class ImportanceSampling {
+public:
+    virtual ~ImportanceSampling() = default;
+    // 把布朗运动终值的均值移到行权价（或离spot最近的敲入障碍）对应的位置，作为优化的起点
+    static double initial_drift(const PricingModel& pricingModel, const Parameters& params);
+    // 在theta0下做一次试算，用牛顿法最小化估计量的二阶矩E_P[f^2 * dP/dQ_theta]
+    static double optimal_drift(const PricingModel& pricingModel, const Parameters& params);
+};
+
+# endif /* ImportanceSampling_hpp */
@@ -9,18 +9,47 @@
 #define MONTE_CARLO_SIMULATOR_HPP
 
 # include <Eigen/Dense>
+# include <random>
+# include <memory>
 # include "Parameters.hpp"
 # include "PricingModel.hpp"
+# include "RandomNumberGenerator.hpp"
+
+class SamplingStrategy;
+class RandomPipeline;
+struct CurveGrid;
 
 class MonteCarloSimulator {
 public:
+    // generate_paths一次生成的路径数。按路径块并行的模块（多层蒙特卡罗、对冲回测、路径存储等）都以此为块大小
+    static constexpr long kBlockPaths = 200;
+
     MonteCarloSimulator(const Parameters& params, const PricingModel& pricingModel);
+    virtual ~MonteCarloSimulator();
     void run_simulation();
     void generate_paths();
+    // 用外部给定的dW（行为路径，列为时间步）推进路径，多层蒙特卡罗等需要粗细两层共享布朗增量时使用
+    void generate_paths(const Eigen::Ref<const Eigen::MatrixXd>& dw_spot, const Eigen::Ref<const Eigen::MatrixXd>& dw_volatility, const Eigen::Ref<const Eigen::MatrixXd>& dw_rate);
     const Eigen::MatrixXd& get_price_paths() const;
     // 最后一个const表示该函数内的内容都不能修改。但是private中mutable的成员变量是可以修改的
     const Eigen::MatrixXd& get_rate_paths() const;
     const Eigen::MatrixXd& get_volatility_paths() const;
+    // 利率模型能精确抽样一步内的∫r ds时，第k列为[t_k, t_k+1]上的积分，否则为空
+    const Eigen::MatrixXd& get_integrated_rate_paths() const;
+    // 重要性抽样：dW_spot整体加上theta * dt的漂移，get_likelihood_ratios返回每条路径的似然比dP/dQ
+    void set_drift_shift(double theta);
+    const Eigen::VectorXd& get_likelihood_ratios() const;
+    const Eigen::VectorXd& get_terminal_brownian() const;
+    // 标的资产驱动的抽样策略，默认为对偶变量。get_path_weights为抽样权重与似然比的乘积，定价时乘在折现payoff上
+    void set_sampling_strategy(const SamplingStrategy* strategy);
+    const Eigen::VectorXd& get_path_weights() const;
+    const Eigen::VectorXi& get_strata() const;
+    // 把随机数发生器重置到(seed, stream)的起点，之后generate_paths生成的路径只由(seed, stream)和参数决定（PathBlockStore按块重新生成路径时使用）
+    void set_random_stream(std::uint64_t seed, std::uint32_t stream);
+    // params中有yieldCurve时为本模拟器时间网格上的曲线，否则为nullptr
+    const CurveGrid* get_curve_grid() const;
+    // params中floatPaths为true时，GBM + 常数波动率 + 确定性利率的路径在单精度下按对数空间推进（见advance_float）
+    bool uses_float_paths() const;
 
 private:
     Parameters params_;
@@ -32,9 +61,34 @@ private:
     Eigen::MatrixXd pricePaths_;
     Eigen::MatrixXd ratePaths_;
     Eigen::MatrixXd volatilityPaths_;
+    Eigen::MatrixXd integratedRatePaths_;
+    double driftShift_;
+    Eigen::VectorXd terminalBrownian_;      // 每条路径平移后的W_T
+    Eigen::VectorXd likelihoodRatios_;
+    const SamplingStrategy* samplingStrategy_;
+    Eigen::VectorXd samplingWeights_;
+    Eigen::VectorXd pathWeights_;
+    Eigen::VectorXi strata_;
+    std::shared_ptr<const CurveGrid> curveGrid_;
+    RandomNumberGenerator rng_;             // 每个模拟器独立的随机数引擎（整块生成正态数），params中有seed时可复现
+
+    bool floatPaths_;
+    Eigen::MatrixXf logPaths_;              // 单精度模式下的ln(S / S0)
+    std::unique_ptr<RandomPipeline> pipeline_;  // rngPipeline为off时为nullptr
+    int chunkSteps_;                        // 流水线每段的时间步数
 
-    
-    double get_random_number();
+    // 标准正态数整块写入dw后乘上sqrt(dt)
+    void fill_increments(Eigen::Ref<Eigen::MatrixXd> dw, double sqrt_dt);
+    static void fill_other_drivers(RandomNumberGenerator& rng, const SamplingStrategy& sampling, Eigen::Ref<Eigen::MatrixXd> dw, double sqrt_dt);
+    void generate_pipelined_paths(const SamplingStrategy& sampling);
+    // 路径推进分为三步：设置第0列；按段推进（dW为这一段的增量）；最后计算似然比
+    void begin_paths(Eigen::Index numPaths, Eigen::Index numSteps);
+    void advance(Eigen::Index firstStep, const Eigen::Ref<const Eigen::MatrixXd>& dw_spot, const Eigen::Ref<const Eigen::MatrixXd>& dw_volatility,
+                 const Eigen::Ref<const Eigen::MatrixXd>& dw_rate, const Eigen::Ref<const Eigen::MatrixXd>& dw_rateIntegral);
+    void finish_paths(Eigen::Index numSteps);
+    // 单精度路径：x = ln(S / S0)逐列累加，SIMD宽度加倍、推进过程的内存带宽减半；
+    // 随机数、利率、似然比仍为双精度，最后S = S0 * exp(x)转换回双精度的pricePaths_，payoff和折现都在双精度下计算
+    void advance_float(Eigen::Index firstStep, const Eigen::Ref<const Eigen::MatrixXd>& dw_spot, double shift);
     // bool check_convergence();
 };
 
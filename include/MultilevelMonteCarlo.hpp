@@ -0,0 +1,54 @@
+//
+//  MultilevelMonteCarlo.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 多层蒙特卡罗（Giles MLMC）：在numSteps的层级上构造共享布朗增量的粗细路径对，
+// 用各层修正量之和代替最细网格上的直接估计
+
+# ifndef MultilevelMonteCarlo_hpp
+# define MultilevelMonteCarlo_hpp
+
+# include <vector>
+# include <Eigen/Dense>
+# include "Parameters.hpp"
+# include "StatisticsAccumulator.hpp"
+
+class PricingModel;
+
+class MultilevelMonteCarlo {
+public:
+    MultilevelMonteCarlo(const PricingModel& pricingModel, const Parameters& params);
+    virtual ~MultilevelMonteCarlo() = default;
+
+    double calculatePrice();
+
+    int getNumLevels() const;
+    const std::vector<long>& getLevelSamples() const;
+    double getLevelMean(int level) const;
+    double getLevelVariance(int level) const;
+
+private:
+    const PricingModel& pricingModel_;
+    Parameters params_;
+
+    double maturity_;           // T = numSteps * dt，所有层共享
+    int baseSteps_;             // 第0层的时间步数
+    int refinement_;            // 相邻两层时间步数之比M
+    int maxLevels_;
+    long initialSamples_;
+    double targetRMSE_;
+
+    // 每层修正量Y_l = P_l - P_{l-1}的样本数和矩，路径块按固定顺序树形合并，结果与线程数无关
+    std::vector<long> samples_;
+    std::vector<TreeAccumulator> moments_;
+
+    int levelSteps(int level) const;
+    double levelCost(int level) const;
+    void add_level();
+    void sample_level(int level, long numSamples);
+    MomentAccumulator sample_block(int level, long numPaths, unsigned int blockSeed) const;
+};
+
+# endif /* MultilevelMonteCarlo_hpp */
@@ -14,6 +14,8 @@
 # include <unordered_map>
 # include <string>
 # include <any>
+# include <set>
+# include <cstdint>
 # include <stdexcept>
 
 class Parameters {
@@ -27,8 +29,17 @@ public:
     template<typename T>
     T get(const std::string& key) const;
 
+    // 返回引用而不是副本，热路径中读取string等参数时避免复制
+    template<typename T>
+    const T& getRef(const std::string& key) const;
+
     bool contains(const std::string& key) const;
 
+    // 所有参数（按key排序，跳过ignoredKeys）的64位哈希写入hash，用于判断两组参数是否生成相同的路径（例如PathCache的文件名）。
+    // 支持double、int、long、bool、std::string、std::vector<double>和Eigen::MatrixXd类型的值（按内容哈希）；
+    // 遇到无法按内容比较的值（例如yieldCurve、curveGrid指针）时返回false，调用方应当视为没有指纹
+    bool fingerprint(std::uint64_t& hash, const std::set<std::string>& ignoredKeys = {}) const;
+
     void updateWithRandomness(double dW1, double dW2, double dW3);
 
 private:
@@ -54,5 +65,14 @@ T Parameters::get(const std::string& key) const {
         throw std::runtime_error("Key not found: " + key);
     }
 }
+template<typename T>
+const T& Parameters::getRef(const std::string& key) const {
+    auto it = data_.find(key);
+    if (it != data_.end()) {
+        return std::any_cast<const T&>(it->second);
+    } else {
+        throw std::runtime_error("Key not found: " + key);
+    }
+}
 // 模版类的操作的实现必须在hpp中完成，否则在cpp中实现的话，有些时候就会出现链接不到的情况
 # endif // PARAMETERS_HPP
@@ -0,0 +1,69 @@
+//
+//  PathBlockStore.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 只保存种子的路径集合：第b个路径块的随机数来自计数器型发生器的(seed, stream = b)，块本身不占内存，
+// 需要时用MonteCarloSimulator重新生成，每次得到逐位相同的路径。适合需要多次遍历同一组路径、但路径矩阵放不进内存的场景：
+// bump法希腊字母（每个情景在同一组随机数上重新模拟，即公共随机数）、LSM的后向回归、对冲回测等。
+// 用一次重新模拟换取O(1)的内存：numPaths条路径只需要一个种子，遍历时同一时刻只有 工作线程数 个路径块在内存中。
+// params中有pathCache（目录）时，路径块同时写入磁盘缓存（见PathCache），之后用相同模型、参数和种子构造的PathBlockStore
+// （包括以后的运行）直接映射缓存文件，price不再生成路径。可选pathCacheMaxBytes为缓存目录的大小上限（默认4GB）。
+// 参数中有无法按内容哈希的值（例如yieldCurve）时不使用缓存。
+
+# ifndef PathBlockStore_hpp
+# define PathBlockStore_hpp
+
+# include <cstdint>
+# include <string>
+# include <memory>
+# include <functional>
+# include "Parameters.hpp"
+# include "Pricing.hpp"
+
+class PricingModel;
+class MonteCarloSimulator;
+class SamplingStrategy;
+class PathCache;
+struct PathBlockView;
+
+class PathBlockStore {
+public:
+    // numPaths向上取整到路径块大小（200）的倍数。抽样策略按params中的sampling创建，遍历期间不做自适应更新，保证每次生成的路径相同
+    // 使用pathCache时必须给出seed，缓存文件不存在或者无效时在构造函数中生成全部路径块并写入
+    PathBlockStore(const PricingModel& pricingModel, const Parameters& params, long numPaths);
+    virtual ~PathBlockStore();
+
+    long getNumPaths() const;
+    long getNumBlocks() const;
+    std::uint64_t getSeed() const;
+    // 路径来自磁盘缓存时为true（构造时命中或者刚写入），此时与构造参数相同的情景不再模拟
+    bool is_cached() const;
+    void set_drift_shift(double theta);
+
+    // 把第block块生成到simulator中；simulator可以用bump过的参数构造，随机数不变
+    void generate_block(long block, MonteCarloSimulator& simulator) const;
+    // 并行地依次生成所有块并调用visit(block, simulator)，visit可能在多个线程上同时执行。可以反复调用，每次路径相同
+    void for_each_block(const std::function<void(long block, const MonteCarloSimulator& simulator)>& visit) const;
+    void for_each_block(const Parameters& scenario, const std::function<void(long block, const MonteCarloSimulator& simulator)>& visit) const;
+    // 在全部路径上定价（折现payoff乘路径权重的均值），scenario为bump后的参数。块之间按序号合并，结果与线程数无关
+    PricingResult price(const Parameters& scenario) const;
+    PricingResult price() const;
+    // 依次访问每个块的价格路径、折现因子和路径权重：scenario的路径与缓存相同时直接映射缓存，否则重新模拟
+    void for_each_block_view(const Parameters& scenario, const std::function<void(long block, const PathBlockView& view)>& visit) const;
+
+private:
+    const PricingModel& pricingModel_;
+    Parameters params_;
+    long numBlocks_;
+    std::uint64_t seed_;
+    double driftShift_;
+    std::unique_ptr<SamplingStrategy> sampling_;
+    std::unique_ptr<PathCache> cache_;
+
+    bool uses_cache(const Parameters& scenario) const;
+    void build_cache(const std::string& directory, const std::string& path, std::uint64_t key, long numColumns, std::uint64_t maxBytes);
+};
+
+# endif /* PathBlockStore_hpp */
@@ -0,0 +1,85 @@
+//
+//  PathCache.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 路径块的磁盘缓存：PathBlockStore生成的每个路径块（价格路径、折现因子、路径权重、似然比、分层号）写入一个二进制文件，
+// 文件名由模型类型、影响路径的参数、种子和路径数的哈希决定。之后的运行用mmap映射同一个文件，
+// 以Eigen::Map零拷贝地交给payoff，完全跳过路径生成。每个块带有校验和，打开时全部校验一遍，
+// 文件损坏、被截断或者与当前配置不符时视为不存在（重新生成并覆盖）。
+// 缓存目录有总大小上限，超出时按最近使用时间淘汰最旧的文件。
+
+# ifndef PathCache_hpp
+# define PathCache_hpp
+
+# include <string>
+# include <vector>
+# include <cstdint>
+# include <cstddef>
+# include <memory>
+# include <Eigen/Dense>
+
+class PricingModel;
+class Parameters;
+
+// 一个路径块在缓存文件中的视图，在PathCache存活期间有效
+struct PathBlockView {
+    Eigen::Map<const Eigen::MatrixXd> pricePaths;       // 路径数 x (numSteps + 1)
+    Eigen::Map<const Eigen::VectorXd> discountFactors;
+    Eigen::Map<const Eigen::VectorXd> pathWeights;
+    Eigen::Map<const Eigen::VectorXd> likelihoodRatios;
+    Eigen::Map<const Eigen::VectorXi> strata;          // 不分层时为-1
+};
+
+class PathCache {
+public:
+    // 同一个缓存键的路径逐位相同：模型类型、除payoff参数以外的所有参数、种子和块数。
+    // 参数中有无法按内容哈希的值（见Parameters::fingerprint）时返回false，这样的参数不能缓存
+    static bool cache_key(const PricingModel& pricingModel, const Parameters& params, long numBlocks, std::uint64_t seed, std::uint64_t& key);
+    static std::string file_path(const std::string& directory, std::uint64_t key);
+    // 文件不存在或校验失败时返回nullptr
+    static std::unique_ptr<PathCache> open(const std::string& path, std::uint64_t key, long numBlocks, long blockSize, long numColumns);
+    // 在写入numBytes字节的新文件之前按最近使用时间淘汰旧文件，使目录总大小不超过maxBytes；新文件本身超过上限时返回false
+    static bool make_room(const std::string& directory, std::uint64_t numBytes, std::uint64_t maxBytes);
+    static std::uint64_t file_size(long numBlocks, long blockSize, long numColumns);
+
+    virtual ~PathCache();
+    PathCache(const PathCache&) = delete;
+    PathCache& operator=(const PathCache&) = delete;
+
+    long getNumBlocks() const;
+    std::uint64_t getKey() const;
+    PathBlockView block(long index) const;
+
+    // 写缓存文件：先写入临时文件，全部块写完后再重命名，其他进程不会读到写了一半的文件。write_block可以在多个线程上同时调用
+    class Writer {
+    public:
+        Writer(const std::string& path, std::uint64_t key, long numBlocks, long blockSize, long numColumns);
+        virtual ~Writer();
+        void write_block(long index, const Eigen::Ref<const Eigen::MatrixXd>& pricePaths, const Eigen::Ref<const Eigen::VectorXd>& discountFactors,
+                         const Eigen::Ref<const Eigen::VectorXd>& pathWeights, const Eigen::Ref<const Eigen::VectorXd>& likelihoodRatios,
+                         const Eigen::Ref<const Eigen::VectorXi>& strata);
+        // 写入文件头和校验和表并重命名为正式文件名；没有调用commit时析构会删除临时文件
+        void commit();
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> impl_;
+    };
+
+private:
+    void* mapping_;
+    std::size_t mappingSize_;
+    std::uint64_t key_;
+    long numBlocks_;
+    long blockSize_;
+    long numColumns_;
+    std::size_t dataOffset_;
+    std::size_t blockStride_;
+
+    PathCache();
+    void release();
+};
+
+# endif /* PathCache_hpp */
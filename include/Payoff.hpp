@@ -11,6 +11,7 @@
 # include <string>
 # include <memory>
 # include <vector>
+# include <set>
 # include <Eigen/Dense>
 
 class Parameters;
@@ -18,8 +19,14 @@ class Parameters;
 class Payoff {
 public:
     virtual ~Payoff() = default;
-    virtual Eigen::VectorXd operator()(const Parameters& params, const Eigen::MatrixXd& paths) const = 0;
+    // 默认实现分配返回向量后调用evaluate
+    virtual Eigen::VectorXd operator()(const Parameters& params, const Eigen::MatrixXd& paths) const;
+    // 把payoff写入调用方提供的内存（例如arena），不做任何堆分配。paths可以是arena中的Map或者某个矩阵的若干列
+    virtual void evaluate(const Parameters& params, const Eigen::Ref<const Eigen::MatrixXd>& paths, Eigen::Ref<Eigen::VectorXd> payoffs) const = 0;
     virtual std::string getName() const = 0;
+    // 所有payoff读取的参数：只影响payoff、不影响路径，共享路径的分组（PortfolioRunner）和路径缓存的键（PathCache）都忽略这些参数。
+    // 新的payoff参数加在这里
+    static const std::set<std::string>& getPayoffKeys();
 };
 
 // 欧式看涨期权
@@ -27,7 +34,7 @@ class EuropeanCallPayoff : public Payoff {
 public:
     EuropeanCallPayoff();
     virtual ~EuropeanCallPayoff() = default;
-    Eigen::VectorXd operator()(const Parameters& params, const Eigen::MatrixXd& paths) const override;
+    void evaluate(const Parameters& params, const Eigen::Ref<const Eigen::MatrixXd>& paths, Eigen::Ref<Eigen::VectorXd> payoffs) const override;
     std::string getName() const override;
 };
 
@@ -36,16 +43,23 @@ class EuropeanPutPayoff : public Payoff {
 public:
     EuropeanPutPayoff();
     virtual ~EuropeanPutPayoff() = default;
-    Eigen::VectorXd operator()(const Parameters& params, const Eigen::MatrixXd& paths) const override;
+    void evaluate(const Parameters& params, const Eigen::Ref<const Eigen::MatrixXd>& paths, Eigen::Ref<Eigen::VectorXd> payoffs) const override;
     std::string getName() const override;
 };
 
-// 障碍期权
+// 障碍期权。参数：payoff（内层EuropeanCallPayoff或EuropeanPutPayoff）、strike、isUpIn/isUpOut/isDownIn/isDownOut，
+//   dt（布朗桥修正或分段障碍时需要）、volatility（布朗桥修正且没有barrierVolatility时需要），以及
+//   单障碍：barrier，或者分段常数的barrierScheduleTimes + barrierScheduleLevels（std::vector<double>，第k段为(t_{k-1}, t_k]）
+//   双障碍：upperBarrier + lowerBarrier，或者barrierScheduleTimes + upperBarrierScheduleLevels + lowerBarrierScheduleLevels，
+//          任一障碍被触及即视为触及，敲入/敲出由isUpIn || isDownIn决定
+//   可选：rebate（敲出期权触及障碍或敲入期权未触及时在到期日支付，默认0）、barrierVolatility（布朗桥修正用的波动率，默认volatility）、
+//        barrierDiscrete（true时只在时间网格上监测，不做布朗桥修正）
+// 连续监测时，相邻两个时间点之间按布朗桥计算穿越障碍的条件概率，payoff乘上未触及的概率，粗网格上也没有离散监测的偏差
 class BarrierPayoff : public Payoff {
 public:
     BarrierPayoff();     // double barrier, bool isKnockIn
     virtual ~BarrierPayoff() = default;
-    Eigen::VectorXd operator()(const Parameters& params, const Eigen::MatrixXd& paths) const override;
+    void evaluate(const Parameters& params, const Eigen::Ref<const Eigen::MatrixXd>& paths, Eigen::Ref<Eigen::VectorXd> payoffs) const override;
     std::string getName() const override;
 /*private:
     double barrier_;
@@ -57,7 +71,7 @@ class AsianPayoff : public Payoff {
 public:
     AsianPayoff();
     virtual ~AsianPayoff() = default;
-    Eigen::VectorXd operator()(const Parameters& params, const Eigen::MatrixXd& paths) const override;
+    void evaluate(const Parameters& params, const Eigen::Ref<const Eigen::MatrixXd>& paths, Eigen::Ref<Eigen::VectorXd> payoffs) const override;
     std::string getName() const override;
     // void addSpot(const Parameters& params);
 /*private:
@@ -69,7 +83,7 @@ class LookbackPayoff : public Payoff {
 public:
     LookbackPayoff();
     virtual ~LookbackPayoff() = default;
-    Eigen::VectorXd operator()(const Parameters& params, const Eigen::MatrixXd& paths) const override;
+    void evaluate(const Parameters& params, const Eigen::Ref<const Eigen::MatrixXd>& paths, Eigen::Ref<Eigen::VectorXd> payoffs) const override;
     std::string getName() const override;
     // void addSpot(const Parameters& params);
 /*private:
@@ -0,0 +1,124 @@
+//
+//  PayoffExpression.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 组合payoff：由路径特征（期末价格、平均价格、最大值、最小值、某一步的价格）、常数和参数，经过线性组合、max/min、指示函数组合而成。
+// 例如蝶式价差 call(S_T, K1) - 2 * call(S_T, K2) + call(S_T, K3) 只需要一次模拟。
+// CompiledPayoff在构造时把表达式编译成一段指令：先用一次遍历求出所有用到的路径特征（每条路径只读一次），
+// 再在整块路径上执行指令（常数折叠、常数操作数直接嵌入指令），中间结果放在arena中，不分配堆内存。
+
+# ifndef PayoffExpression_hpp
+# define PayoffExpression_hpp
+
+# include <string>
+# include <vector>
+# include <memory>
+# include "Payoff.hpp"
+
+class PayoffExpression {
+public:
+    enum class Kind { Terminal, Initial, Average, Maximum, Minimum, Step, Constant, Parameter, Add, Sub, Mul, Max, Min, Greater, Neg };
+
+    // 路径特征
+    static PayoffExpression terminal();
+    static PayoffExpression initial();
+    static PayoffExpression average();          // 包含期初价格在内所有时间点的算术平均，与AsianPayoff一致
+    static PayoffExpression path_maximum();
+    static PayoffExpression path_minimum();
+    static PayoffExpression at_step(int step);  // 第step列（0为期初）
+    static PayoffExpression constant(double value);
+    static PayoffExpression parameter(const std::string& key);     // 每次evaluate时从params读取的double
+
+    static PayoffExpression maximum(const PayoffExpression& a, const PayoffExpression& b);
+    static PayoffExpression minimum(const PayoffExpression& a, const PayoffExpression& b);
+    static PayoffExpression indicator(const PayoffExpression& a, const PayoffExpression& b);   // 1{a > b}
+
+    // 常用结构
+    static PayoffExpression call(const PayoffExpression& underlying, double strike);
+    static PayoffExpression put(const PayoffExpression& underlying, double strike);
+    static PayoffExpression bull_spread(double lowStrike, double highStrike);
+    static PayoffExpression bear_spread(double lowStrike, double highStrike);
+    static PayoffExpression straddle(double strike);
+    static PayoffExpression strangle(double putStrike, double callStrike);
+    static PayoffExpression butterfly(double lowStrike, double midStrike, double highStrike);
+    static PayoffExpression condor(double strike1, double strike2, double strike3, double strike4);
+
+    Kind getKind() const;
+
+    friend PayoffExpression operator+(const PayoffExpression& a, const PayoffExpression& b);
+    friend PayoffExpression operator-(const PayoffExpression& a, const PayoffExpression& b);
+    friend PayoffExpression operator*(const PayoffExpression& a, const PayoffExpression& b);
+    friend PayoffExpression operator-(const PayoffExpression& a);
+    friend PayoffExpression operator+(const PayoffExpression& a, double b);
+    friend PayoffExpression operator+(double a, const PayoffExpression& b);
+    friend PayoffExpression operator-(const PayoffExpression& a, double b);
+    friend PayoffExpression operator-(double a, const PayoffExpression& b);
+    friend PayoffExpression operator*(const PayoffExpression& a, double b);
+    friend PayoffExpression operator*(double a, const PayoffExpression& b);
+
+private:
+    friend class CompiledPayoff;
+
+    struct Node {
+        Kind kind;
+        double value;           // Constant的值
+        int step;               // Step的列
+        std::string key;        // Parameter的key
+        std::shared_ptr<const Node> left;
+        std::shared_ptr<const Node> right;
+    };
+    std::shared_ptr<const Node> node_;
+
+    explicit PayoffExpression(std::shared_ptr<const Node> node);
+    static PayoffExpression leaf(Kind kind);
+    static PayoffExpression binary(Kind kind, const PayoffExpression& a, const PayoffExpression& b);
+};
+
+class CompiledPayoff : public Payoff {
+public:
+    explicit CompiledPayoff(const PayoffExpression& expression, const std::string& name = "CompiledPayoff");
+    virtual ~CompiledPayoff() = default;
+    void evaluate(const Parameters& params, const Eigen::Ref<const Eigen::MatrixXd>& paths, Eigen::Ref<Eigen::VectorXd> payoffs) const override;
+    std::string getName() const override;
+
+    std::size_t getNumInstructions() const;
+
+private:
+    enum class Op {
+        Load,           // 压入一个路径特征
+        Immediate,      // 压入常数或参数（整列填充）
+        Add, Sub, Mul, Max, Min, Greater,
+        // 右操作数为常数/参数时直接嵌入指令，不占用栈
+        AddImm, SubImm, RSubImm, MulImm, MaxImm, MinImm, GreaterImm, LessImm,
+        Neg,
+        // 窥孔优化后的融合指令：直接从路径特征算出max(x - K, 0)或max(K - x, 0)；top-1 += c * top
+        LoadCall, LoadPut, AddScaled
+    };
+    enum class Feature { Terminal, Initial, Average, Maximum, Minimum, Step };
+
+    struct Instruction {
+        Op op;
+        Feature feature;
+        int step;
+        double constant;
+        int parameter;          // >= 0时常数取第parameter个参数的值
+    };
+
+    std::string name_;
+    std::vector<Instruction> program_;
+    std::vector<std::string> parameterKeys_;
+    int maxDepth_;
+    bool needAverage_;
+    bool needMaximum_;
+    bool needMinimum_;
+    int maxStep_;
+
+    // 返回值为true时node是常数（或参数），不生成指令，值写入immediate
+    bool compile(const PayoffExpression::Node& node, int depth, Instruction& immediate);
+    int parameter_index(const std::string& key);
+    void fuse();
+};
+
+# endif /* PayoffExpression_hpp */
@@ -0,0 +1,66 @@
+//
+//  PortfolioRunner.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 批量定价：读取交易文件，统一校验参数，把可以共享路径的交易分组，交给调度器并行定价，结果写入输出文件。
+// 交易文件每行一笔交易，由空白分隔的key=value组成，#之后为注释：
+//   trade=T1 rateModel=ConstantRateModel volatilityModel=ConstantVolatilityModel assetModel=GeometricBrownianMotionModel
+//   payoff=EuropeanPutPayoff spot=100 rate=0.05 volatility=0.2 dt=0.003968 numSteps=25 strike=100
+//   maxSimulations=100000 confidenceLevel=0.95 tolerance=0.001 seed=42
+// 模型和payoff名称与ModelParams一致；BarrierPayoff的内层期权类型写作barrierPayoff=EuropeanCallPayoff。
+// 其余的key原样放入该交易的Parameters（整数、布尔、字符串类型的key见PortfolioRunner.cpp）
+
+# ifndef PortfolioRunner_hpp
+# define PortfolioRunner_hpp
+
+# include <string>
+# include <vector>
+# include <map>
+# include "Parameters.hpp"
+# include "Pricing.hpp"
+
+struct TradeSpec {
+    std::string id;
+    std::string rateModel;
+    std::string volatilityModel;
+    std::string assetModel;
+    std::string payoff;
+    Parameters params;
+    std::map<std::string, std::string> fields;     // 原始文本，用于判断两笔交易的路径是否相同
+    int line;
+};
+
+struct TradeResult {
+    std::string id;
+    PricingResult result;
+    size_t group;
+    size_t groupSize;
+    double groupSeconds;        // 所在分组的总耗时（共享路径的交易无法单独计时）
+};
+
+class PortfolioRunner {
+public:
+    explicit PortfolioRunner(const std::string& jobFile);
+    virtual ~PortfolioRunner() = default;
+
+    static std::vector<TradeSpec> read_job_file(const std::string& path);
+
+    // 在定价之前检查所有交易（包括按定价时的方式构造模型、抽样策略和模拟器），任何一笔缺少参数、名称未知或者设置无效时抛出异常，列出全部问题
+    void validate() const;
+    std::vector<TradeResult> run();
+    void write_results(const std::string& path, const std::vector<TradeResult>& results) const;
+
+    double getElapsedSeconds() const;
+    double getTradesPerSecond() const;
+
+private:
+    std::vector<TradeSpec> trades_;
+    double elapsedSeconds_;
+
+    // 路径只由模型和非payoff参数决定，这些都相同的交易分为一组
+    std::vector<std::vector<size_t>> group_trades() const;
+};
+
+# endif /* PortfolioRunner_hpp */
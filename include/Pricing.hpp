@@ -12,7 +12,12 @@ class MonteCarloSimulator;
 class Payoff;
 class Parameters;
 class PricingModel;
+class RateModel;
+class MomentAccumulator;
+class QuantileSketch;
 # include <vector>
+# include <memory>
+# include <cstddef>
 # include <Eigen/Dense>
 /*
 class Pricing {
@@ -26,15 +31,84 @@ public:
     static double calculatePrice(MonteCarloSimulator& simulator, const PricingModel& pricingModel, const Parameters& params);
 };
 */
+// 一次定价的完整结果：均值、置信区间以及实际使用的路径数
+struct PricingResult {
+    double price;
+    double lowerBound;
+    double upperBound;
+    double standardError;
+    long numSimulations;
+    bool converged;
+    // params中payoffDistribution为true时为折现payoff（按路径权重加权）分布的分位数草图，否则为nullptr
+    std::shared_ptr<const QuantileSketch> distribution;
+};
+
+// 每轮路径块完成后的中间结果
+struct PricingProgress {
+    long numSimulations;
+    double price;
+    double standardError;
+    double gelmanRubin;
+    bool converged;
+};
+
+// 观察和控制一次定价：每轮结束后调用on_progress，返回false时提前结束（结果的converged为false）；
+// tolerance返回本轮收敛判断使用的容差，可以在运行中收紧。两者都在执行定价的线程上调用
+class PricingMonitor {
+public:
+    virtual ~PricingMonitor() = default;
+    virtual bool on_progress(const PricingProgress& progress) = 0;
+    virtual double tolerance(double requested) { return requested; }
+};
+
+// 共享路径定价（Pricing::calculateSharedResults）中各个cell的payoff，例如批量定价中的一组交易、价格表中的每个(payoff, 到期日)。
+// 不同chain的路径块在不同线程上并行处理，chain序号为0到Pricing::kNumChains - 1，需要暂存的中间量按chain分开保存
+class SharedPathEvaluator {
+public:
+    virtual ~SharedPathEvaluator() = default;
+    virtual std::size_t getNumCells() const = 0;
+    // 每个路径块开始时调用一次，计算该块上所有cell共用的量（例如折现因子）
+    virtual void begin_block(int chain, const MonteCarloSimulator& simulator);
+    // 把cell在该路径块上的折现payoff（不乘路径权重）写入values
+    virtual void evaluate(int chain, const MonteCarloSimulator& simulator, std::size_t cell, Eigen::Ref<Eigen::VectorXd> values) const = 0;
+    // 自适应抽样按这个cell的payoff调整分配
+    virtual std::size_t getSamplingCell() const;
+};
+
 class Pricing {
 public:
+    // Gelman-Rubin判断使用的chain数，每轮每个chain生成一个路径块
+    static constexpr int kNumChains = 8;
+
     virtual ~Pricing() = default;
     static double calculate_mean(const Eigen::VectorXd& values);
     static double calculate_stdev(const Eigen::VectorXd& values, double mean);
     static double get_z_value(double confidence_level);
     static bool is_converged(const std::vector<Eigen::VectorXd>& chains, double tolerance);
     static double calculate_gelman_rubin(const std::vector<Eigen::VectorXd>& chains);
+    // 确定性模式下每个chain只保留可合并的矩，收敛判断直接用矩计算
+    static bool is_converged(const std::vector<MomentAccumulator>& chains, double tolerance);
+    static double calculate_gelman_rubin(const std::vector<MomentAccumulator>& chains);
+    // 分层抽样：把一个路径块的values * likelihoodRatios按strata中的层号分组，每层的矩写入moments（大小为层数），再交给StratifiedAccumulator
+    static void calculate_strata_moments(const Eigen::Ref<const Eigen::VectorXi>& strata, const Eigen::Ref<const Eigen::VectorXd>& values,
+                                         const Eigen::Ref<const Eigen::VectorXd>& likelihoodRatios, std::vector<MomentAccumulator>& moments);
+    static Eigen::VectorXd calculate_discount_factors(const Eigen::MatrixXd& ratePaths, double dt);
+    static void calculate_discount_factors(const Eigen::Ref<const Eigen::MatrixXd>& ratePaths, double dt, Eigen::Ref<Eigen::VectorXd> discountFactors);
+    // 模拟器带有收益率曲线且利率模型是确定性的时候直接取曲线网格上的P(0, T)；模型能精确抽样∫r ds时用抽样的积分；否则对模拟的利率路径积分
+    static Eigen::VectorXd calculate_discount_factors(const MonteCarloSimulator& simulator, const RateModel& rateModel, double dt);
+    static void calculate_discount_factors(const MonteCarloSimulator& simulator, const RateModel& rateModel, double dt, Eigen::Ref<Eigen::VectorXd> discountFactors);
+    // 折现到第numSteps步（观察日早于路径终点时使用，例如TermStructurePricer的每个到期日）
+    static void calculate_discount_factors(const MonteCarloSimulator& simulator, const RateModel& rateModel, double dt, Eigen::Index numSteps, Eigen::Ref<Eigen::VectorXd> discountFactors);
     static double calculatePrice(const PricingModel& pricingModel, const Parameters& params);
+    // 与calculatePrice相同，返回置信区间等完整结果。params中quiet为true时不打印收敛过程（批量定价时使用）；
+    // payoffDistribution为true时每个chain另外累加一个QuantileSketch（可选quantileCompression，默认200），结果中给出分位数、直方图和尾部期望
+    static PricingResult calculateResult(const PricingModel& pricingModel, const Parameters& params);
+    // monitor可以为nullptr。异步接口见PricingService
+    static PricingResult calculateResult(const PricingModel& pricingModel, const Parameters& params, PricingMonitor* monitor);
+    // 多个cell共享同一批路径：每轮kNumChains个chain各生成一个路径块，每个cell在块上的payoff由evaluator给出，统计量全部用可合并的矩（同确定性模式）。
+    // 每个cell有自己的Gelman-Rubin判断，全部收敛或达到maxSimulations时结束；payoffDistribution为true时每个cell另外给出分位数草图。
+    // pathModel只用来生成路径和选择利率模型，不支持重要性抽样（漂移平移量与payoff有关）
+    static std::vector<PricingResult> calculateSharedResults(const PricingModel& pathModel, const Parameters& params, SharedPathEvaluator& evaluator);
 };
 
 # endif /* Pricing_hpp */
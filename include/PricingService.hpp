@@ -0,0 +1,109 @@
+//
+//  PricingService.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 异步定价接口：submit立即返回PricingHandle，结果通过future取得，多个请求可以同时在途。
+// 每个请求的轮次循环在服务自己的请求线程上执行（不是调度器的工作线程），只有每轮的路径块作为任务交给工作窃取调度器，
+// 所以一个请求等待路径块时最多帮忙执行别的路径块，不会在同一个栈上嵌套执行另一个请求的整个定价过程。
+// 每轮路径块（1600条路径）结束后：调用进度回调（当前价格、标准误差、Gelman-Rubin统计量），检查取消和截止时间，
+// 并读取当前的容差，所以前端可以在市场变化时取消请求，或者收紧容差让它继续算下去。
+// 取消的请求future抛出PricingCancelled；到达截止时间的请求返回当时的估计（converged为false）。
+// PricingModel及其引用的模型对象由调用方持有，必须存活到future就绪。
+
+# ifndef PricingService_hpp
+# define PricingService_hpp
+
+# include <atomic>
+# include <chrono>
+# include <condition_variable>
+# include <deque>
+# include <functional>
+# include <future>
+# include <memory>
+# include <mutex>
+# include <stdexcept>
+# include <string>
+# include <thread>
+# include <vector>
+# include "Parameters.hpp"
+# include "Pricing.hpp"
+
+class PricingModel;
+
+class PricingCancelled : public std::runtime_error {
+public:
+    PricingCancelled() : std::runtime_error("Pricing request cancelled") {}
+};
+
+// 可以在多个请求之间共享（复制后指向同一个标志），cancel后所有持有它的请求在下一轮结束时停止
+class CancellationToken {
+public:
+    CancellationToken();
+    void cancel();
+    bool is_cancelled() const;
+
+private:
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+enum class PricingStatus { Queued, Running, Converged, MaxSimulations, DeadlineReached, Cancelled, Failed };
+
+struct PricingRequestOptions {
+    // 在执行该请求的请求线程上调用，应当很快返回
+    std::function<void(const PricingProgress&)> onProgress;
+    CancellationToken cancellation;
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+};
+
+class PricingHandle {
+public:
+    // 阻塞直到结果就绪；请求被取消时抛出PricingCancelled，定价出错时重新抛出原来的异常
+    PricingResult get() const;
+    std::future_status wait_for(std::chrono::milliseconds timeout) const;
+
+    // 只取消本请求（不影响共享同一个CancellationToken的其他请求）
+    void cancel();
+    // 在运行中修改收敛容差或截止时间，从下一轮开始生效
+    void set_tolerance(double tolerance);
+    void set_deadline(std::chrono::steady_clock::time_point deadline);
+
+    PricingStatus getStatus() const;
+    // 最近一轮的中间结果，还没有完成第一轮时numSimulations为0
+    PricingProgress getProgress() const;
+
+private:
+    friend class PricingService;
+    struct State;
+    std::shared_ptr<State> state_;
+    std::shared_future<PricingResult> result_;
+};
+
+class PricingService {
+public:
+    // numRequestThreads为同时运行的请求数上限，更多的请求排队（状态为Queued）
+    explicit PricingService(unsigned int numRequestThreads = 4);
+    // 取消所有未完成的请求，并等待请求线程结束
+    virtual ~PricingService();
+
+    PricingService(const PricingService&) = delete;
+    PricingService& operator=(const PricingService&) = delete;
+
+    // params与Pricing::calculateResult相同（quiet被强制为true，不打印收敛过程）
+    PricingHandle submit(const PricingModel& pricingModel, const Parameters& params, const PricingRequestOptions& options = PricingRequestOptions());
+
+    static std::string status_name(PricingStatus status);
+
+private:
+    void run_requests();
+
+    std::vector<std::thread> threads_;
+    std::deque<std::function<void()>> queue_;
+    std::vector<std::weak_ptr<PricingHandle::State>> states_;   // 析构时用来取消还在运行的请求
+    std::mutex mutex_;
+    std::condition_variable available_;
+    bool stopping_ = false;
+};
+
+# endif /* PricingService_hpp */
@@ -0,0 +1,52 @@
+//
+//  RandomPipeline.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 随机数的生产者/消费者流水线：路径按时间步切成若干段（chunk），每段的dW写入一个缓存大小的槽位（slot），
+// 消费者推进完这一段路径后槽位被重新填充，随机数占用的内存只有 槽位数 x 一段 的大小，与路径长度无关。
+// Interleaved：同一个线程交替生产和消费，只用一个槽位，生产出的随机数在被使用时仍在L1/L2中。
+// Async：最多numSlots段由调度器上的任务提前生成，与当前段的路径推进重叠；消费者等待某个槽位时帮忙执行调度器中的任务，不会死锁。
+// 每段的随机数只由段序号决定（计数器型随机数发生器按段定位），两种模式得到完全相同的路径。
+
+# ifndef RandomPipeline_hpp
+# define RandomPipeline_hpp
+
+# include <atomic>
+# include <memory>
+# include <vector>
+# include <functional>
+# include <Eigen/Dense>
+
+class RandomPipeline {
+public:
+    enum class Mode { Interleaved, Async };
+
+    struct Slot {
+        Eigen::MatrixXd normals;        // rows x cols，列主序连续，各驱动按列依次排列
+        Eigen::VectorXd weights;        // 抽样策略给出的路径权重和分层
+        Eigen::VectorXi strata;
+        std::atomic<long> ready;        // 已写入的段序号，-1表示空
+    };
+    using Producer = std::function<void(long chunk, Slot& slot)>;
+    using Consumer = std::function<void(long chunk, const Slot& slot)>;
+
+    RandomPipeline(Mode mode, int numSlots);
+    virtual ~RandomPipeline() = default;
+
+    // 按顺序消费第0到numChunks - 1段，每段先由produce写入某个槽位
+    void run(long numChunks, Eigen::Index rows, Eigen::Index cols, const Producer& produce, const Consumer& consume);
+
+    Mode getMode() const;
+    // 槽位占用的字节数（随机数缓冲区的全部内存）
+    std::size_t getBufferBytes() const;
+
+private:
+    Mode mode_;
+    std::vector<std::unique_ptr<Slot>> slots_;
+
+    void reserve(Eigen::Index rows, Eigen::Index cols);
+};
+
+# endif /* RandomPipeline_hpp */
@@ -16,6 +16,11 @@ class RateModel { // 基类
 public:
     virtual ~RateModel() = default;
     virtual double getRate(const Parameters& params) const = 0;
+    // 利率路径是否与随机数无关（所有路径相同），是则定价时可以直接用曲线网格上的折现因子
+    virtual bool isDeterministic() const;
+    // 高斯模型可以精确抽样一步内的利率积分∫r ds（读取rt、rtNext和独立的dW_rateIntegral），折现时代替利率路径的左端点积分
+    virtual double getIntegratedRate(const Parameters& params) const;
+    virtual bool hasIntegratedRate() const;
 };
 
 class ConstantRateModel : public RateModel {    // 派生类
@@ -23,6 +28,33 @@ public:
     ConstantRateModel(const Parameters& params);
     virtual ~ConstantRateModel() = default;
     double getRate(const Parameters& params) const override;
+    bool isDeterministic() const override;
+};
+
+class VasicekModel : public RateModel {
+public:
+    VasicekModel(const Parameters& params);
+    virtual ~VasicekModel() = default;
+    double getRate(const Parameters& params) const override;
+    double getIntegratedRate(const Parameters& params) const override;
+    bool hasIntegratedRate() const override;
+
+private:
+    double kappa_VM_;
+    double theta_VM_;
+    double sigma_VM_;
+};
+
+class CIRModel : public RateModel {
+public:
+    CIRModel(const Parameters& params);
+    virtual ~CIRModel() = default;
+    double getRate(const Parameters& params) const override;
+
+private:
+    double kappa_CIRM_;
+    double theta_CIRM_;
+    double sigma_CIRM_;
 };
 
 class HullWhiteModel : public RateModel {    // 派生类
@@ -30,11 +62,15 @@ public:
     HullWhiteModel(const Parameters& params);
     virtual ~HullWhiteModel() = default;
     double getRate(const Parameters& params) const override;
+    double getIntegratedRate(const Parameters& params) const override;
+    bool hasIntegratedRate() const override;
 
 private:
     double a_HWM_;
     double sigma_HWM_;
-    double dt_;
+
+    double alpha(const Parameters& params, int stepIndex) const;
+    double integral_variance(double t) const;
 };
 
 # endif // RATEMODEL_HPP
@@ -4,10 +4,84 @@
 //
 //  Created by 俊延 on 2024/7/17.
 //
+// 期权组合的VaR和Expected Shortfall。情景是每个标的在持有期内的对数收益率（以及可选的隐含波动率变化），
+// 来自历史数据（重叠的h日收益率）或者蒙特卡罗（用历史日收益率的协方差生成多元正态，按sqrt(h)放大）。
+// 每个情景下对每笔交易重估：全量重估用Black-Scholes闭式价格（剩余期限减去持有期），快速模式用delta-gamma-vega近似。
+// 情景按块并行，块内逐笔交易把盈亏直接累加到该块的组合盈亏上，内存只有 情景数 x 标的数 的情景矩阵和每个情景一个组合盈亏，
+// 不会出现 情景数 x 交易数 的矩阵。
 
 #ifndef RiskAnalysis_hpp
 #define RiskAnalysis_hpp
 
-#include <stdio.h>
+#include <vector>
+#include <Eigen/Dense>
+#include "Parameters.hpp"
+#include "SensitivityAnalysis.hpp"
+
+struct RiskPosition {
+    int underlying;             // 标的序号，对应spots和情景矩阵的列
+    double quantity;            // 持仓数量，空头为负
+    bool isCall;
+    double strike;
+    double maturity;            // 剩余期限（年）
+    double volatility;          // 当前隐含波动率
+    // 非欧式交易（障碍、亚式等）没有闭式价格：给出每单位的Greeks（例如SensitivityAnalysis::computeGreeks的结果），
+    // 全量重估时该交易也使用delta-gamma-vega近似
+    bool useGreeks = false;
+    Greeks greeks = {0.0, 0.0, 0.0, 0.0};
+};
+
+enum class RevaluationMethod {
+    FullRevaluation,
+    DeltaGammaVega
+};
+
+struct RiskMeasures {
+    double valueAtRisk;                 // 损失的confidenceLevel分位数，正数表示损失
+    double expectedShortfall;           // 损失不小于VaR的最差(1 - confidenceLevel)部分情景的平均损失
+    double meanPnL;
+    long numScenarios;
+    int horizonDays;
+    std::vector<double> contributions;  // 每笔交易对ES的贡献（尾部情景中该交易的平均损失），加总等于ES
+};
+
+class RiskAnalysis {
+public:
+    // 需要的参数：rate、confidenceLevel；可选varHorizonDays（默认1，常用1和10）、seed（蒙特卡罗情景）
+    RiskAnalysis(const std::vector<RiskPosition>& positions, const Eigen::VectorXd& spots, const Parameters& params);
+    virtual ~RiskAnalysis() = default;
+
+    // dailyReturns为 天数 x 标的数 的日对数收益率（例如MarketDataSlice::log_returns按列拼接），
+    // dailyVolatilityChanges（可选，同样大小）为隐含波动率的日变化。情景为重叠的h日累计值，共 天数 - h + 1 个
+    void set_historical_scenarios(const Eigen::MatrixXd& dailyReturns, const Eigen::MatrixXd& dailyVolatilityChanges = Eigen::MatrixXd());
+    // 用日收益率（和波动率变化）的样本协方差生成numScenarios个h日情景，零均值
+    void set_monte_carlo_scenarios(const Eigen::MatrixXd& dailyReturns, long numScenarios, const Eigen::MatrixXd& dailyVolatilityChanges = Eigen::MatrixXd());
+
+    RiskMeasures calculate(RevaluationMethod method) const;
+    // 每个情景的组合盈亏，与情景的顺序一致
+    Eigen::VectorXd scenario_pnl(RevaluationMethod method) const;
+
+    int getHorizonDays() const;
+    const Eigen::MatrixXd& getSpotScenarios() const;
+
+private:
+    std::vector<RiskPosition> positions_;
+    Eigen::VectorXd spots_;
+    double rate_;
+    double confidenceLevel_;
+    int horizonDays_;
+    unsigned int seed_;
+
+    Eigen::MatrixXd spotScenarios_;         // 情景数 x 标的数，h日对数收益率
+    Eigen::MatrixXd volatilityScenarios_;   // 情景数 x 标的数，h日隐含波动率变化（没有时为0）
+    std::vector<double> basePrices_;        // 每笔交易当前的单位价格
+    std::vector<Greeks> baseGreeks_;
+
+    // 第index笔交易在一组情景下的盈亏（已乘上数量）。shockedSpots为这些情景下各标的的价格水平，每块只做一次exp
+    Eigen::MatrixXd shocked_spots(const Eigen::Ref<const Eigen::MatrixXd>& spotShocks) const;
+    void position_pnl(std::size_t index, const Eigen::Ref<const Eigen::MatrixXd>& shockedSpots, const Eigen::Ref<const Eigen::MatrixXd>& volatilityShocks,
+                      RevaluationMethod method, Eigen::Ref<Eigen::ArrayXd> pnl) const;
+    void check_scenarios() const;
+};
 
 #endif /* RiskAnalysis_hpp */
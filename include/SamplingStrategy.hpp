@@ -0,0 +1,86 @@
+//
+//  SamplingStrategy.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 标的资产驱动布朗运动的抽样方式：伪随机、对偶变量、终值分层（布朗桥补齐中间步）、拉丁超立方
+
+# ifndef SamplingStrategy_hpp
+# define SamplingStrategy_hpp
+
+# include <memory>
+# include <vector>
+# include <string>
+# include <Eigen/Dense>
+# include "RandomNumberGenerator.hpp"
+
+class Parameters;
+
+class SamplingStrategy {
+public:
+    virtual ~SamplingStrategy() = default;
+    // 向调用方分配好的numPaths x numSteps矩阵中写入标准正态随机数（用rng整块生成）。weights为每条路径的权重（加权平均仍是无偏估计），strata为路径所属的层（不分层时为-1）
+    virtual void generate(RandomNumberGenerator& rng, Eigen::Index numPaths, Eigen::Index numSteps,
+                          Eigen::Ref<Eigen::MatrixXd> normals, Eigen::Ref<Eigen::VectorXd> weights, Eigen::Ref<Eigen::VectorXi> strata) const = 0;
+    // 每一轮模拟结束后把各路径的折现payoff反馈回来，自适应的策略据此调整下一轮的分配
+    virtual void update(const Eigen::VectorXi& strata, const Eigen::VectorXd& values);
+    // 波动率和利率的驱动是否也使用对偶变量
+    virtual bool isAntithetic() const;
+    // 是否可以按时间段分别生成（每段的随机数与其他段无关），可以时模拟器用随机数流水线逐段生成
+    virtual bool supportsStreaming() const;
+    // 每层的概率（下标为strata中的层号），不分层时为空。用于计算分层估计量的标准误差
+    virtual std::vector<double> getStrataProbabilities() const;
+    virtual std::string getName() const = 0;
+
+    // 根据params中的"sampling"创建：pseudo、antithetic（默认）、stratified（numStrata）、latinHypercube（lhsDimensions）
+    static std::unique_ptr<SamplingStrategy> create(const Parameters& params);
+};
+
+class PseudoRandomSampling : public SamplingStrategy {
+public:
+    void generate(RandomNumberGenerator& rng, Eigen::Index numPaths, Eigen::Index numSteps,
+                  Eigen::Ref<Eigen::MatrixXd> normals, Eigen::Ref<Eigen::VectorXd> weights, Eigen::Ref<Eigen::VectorXi> strata) const override;
+    bool supportsStreaming() const override;
+    std::string getName() const override;
+};
+
+class AntitheticSampling : public SamplingStrategy {
+public:
+    void generate(RandomNumberGenerator& rng, Eigen::Index numPaths, Eigen::Index numSteps,
+                  Eigen::Ref<Eigen::MatrixXd> normals, Eigen::Ref<Eigen::VectorXd> weights, Eigen::Ref<Eigen::VectorXi> strata) const override;
+    bool isAntithetic() const override;
+    bool supportsStreaming() const override;
+    std::string getName() const override;
+};
+
+class StratifiedSampling : public SamplingStrategy {
+public:
+    explicit StratifiedSampling(int numStrata);
+    void generate(RandomNumberGenerator& rng, Eigen::Index numPaths, Eigen::Index numSteps,
+                  Eigen::Ref<Eigen::MatrixXd> normals, Eigen::Ref<Eigen::VectorXd> weights, Eigen::Ref<Eigen::VectorXi> strata) const override;
+    void update(const Eigen::VectorXi& strata, const Eigen::VectorXd& values) override;
+    std::vector<double> getStrataProbabilities() const override;
+    std::string getName() const override;
+    const std::vector<double>& getAllocation() const;
+
+private:
+    int numStrata_;
+    std::vector<double> allocation_;    // 每层样本占比，初始为等比例
+    std::vector<double> count_;         // 每层累计的样本数、一阶矩、二阶矩，用于估计层内标准差
+    std::vector<double> sum_;
+    std::vector<double> sum2_;
+};
+
+class LatinHypercubeSampling : public SamplingStrategy {
+public:
+    explicit LatinHypercubeSampling(int dimensions);
+    void generate(RandomNumberGenerator& rng, Eigen::Index numPaths, Eigen::Index numSteps,
+                  Eigen::Ref<Eigen::MatrixXd> normals, Eigen::Ref<Eigen::VectorXd> weights, Eigen::Ref<Eigen::VectorXi> strata) const override;
+    std::string getName() const override;
+
+private:
+    int dimensions_;
+};
+
+# endif /* SamplingStrategy_hpp */
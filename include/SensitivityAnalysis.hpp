@@ -8,19 +8,32 @@
 # ifndef SensitivityAnalysis_hpp
 # define SensitivityAnalysis_hpp
 
+# include <vector>
+# include "Parameters.hpp"
+
 class PricingModel;
+class PathBlockStore;
 class RateModel;
 class VolatilityModel;
 
+// FiniteDifference：所有bump使用同一个seed（公共随机数），差分的方差小
+// MonteCarlo：每个bump独立抽样
 enum class CalculationMethod {
     FiniteDifference,
     MonteCarlo
 };
 
+struct Greeks {
+    double price;
+    double delta;
+    double gamma;
+    double vega;
+};
+
 class SensitivityAnalysis {
 public:
-    // 构造函数，初始化定价模型和期权参数
-    SensitivityAnalysis(const PricingModel& model, double spot, double strike, double maturity, double volatility);
+    // 构造函数，初始化定价模型和期权参数。spot和volatility从params中读取
+    SensitivityAnalysis(const PricingModel& model, const Parameters& params);
 
     // 计算Delta
     double computeDelta(CalculationMethod method) const;
@@ -31,12 +44,21 @@ public:
     // 计算Vega
     double computeVega(CalculationMethod method) const;
 
+    // 一次性计算价格和全部希腊字母：价格按收敛判断决定路径数，4个bump情景用相同的路径数作为任务并行执行
+    Greeks computeGreeks(CalculationMethod method) const;
+    // 所有情景都在paths的同一组路径上重新模拟（路径数相同、随机数逐位相同），差分中没有抽样噪声的差异
+    Greeks computeGreeks(const PathBlockStore& paths) const;
+
 private:
     const PricingModel& model;
+    Parameters params;
     double spot;
-    double strike;
-    double maturity;
     double volatility;
+    double spotBump;
+    double volatilityBump;
+
+    Parameters bumped(const std::string& key, double value, CalculationMethod method, int scenario) const;
+    std::vector<double> price_scenarios(const std::vector<Parameters>& scenarios) const;
 };
 
 # endif // SENSITIVITYANALYSIS_HPP
@@ -0,0 +1,129 @@
+//
+//  StatisticsAccumulator.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 可合并的均值/方差累加器，以及与SIMD宽度、线程数无关的确定性求和；
+// 可合并的分位数草图（t-digest），用有限内存近似整个payoff分布
+
+# ifndef StatisticsAccumulator_hpp
+# define StatisticsAccumulator_hpp
+
+# include <vector>
+# include <Eigen/Dense>
+
+// 成对求和：固定的二分递归，叶子为最多8个元素的顺序累加。结果只取决于n和数据顺序，误差为O(log n)而不是O(n)
+// 注意不能用-ffast-math编译（编译器会重排浮点加法）；跨指令集比较时还需要-ffp-contract=off，避免路径演化中的乘加被合并成FMA
+template<typename Term>
+double pairwise_sum(Eigen::Index begin, Eigen::Index end, const Term& term) {
+    if (end - begin <= 8) {
+        double sum = 0.0;
+        for (Eigen::Index i = begin; i < end; ++i) {
+            sum += term(i);
+        }
+        return sum;
+    }
+    Eigen::Index middle = begin + (end - begin) / 2;
+    return pairwise_sum(begin, middle, term) + pairwise_sum(middle, end, term);
+}
+
+class MomentAccumulator {
+public:
+    MomentAccumulator();
+    // 一个路径块的矩：成对求和求均值，再对离差平方成对求和（两遍法）
+    static MomentAccumulator from_values(const Eigen::Ref<const Eigen::VectorXd>& values);
+
+    // Chan等人的并行合并公式
+    void merge(const MomentAccumulator& other);
+
+    double count() const;
+    double mean() const;
+    double variance() const;      // 样本方差（n - 1）
+    double stdev() const;
+
+private:
+    double count_;
+    double mean_;
+    double m2_;                   // 离差平方和
+};
+
+// 按块的顺序以二进制计数器的方式两两合并（第1、2块合并，第3、4块合并，两者再合并……），
+// 合并树只由块的序号决定，和哪个线程在什么时候算完无关，内存为O(log n)
+class TreeAccumulator {
+public:
+    void add(const MomentAccumulator& block);
+    MomentAccumulator result() const;
+
+private:
+    std::vector<MomentAccumulator> levels_;
+    std::vector<bool> occupied_;
+};
+
+// 分层估计量的误差：每个路径块是一个独立的分层估计量，价格为各块估计量按路径数n_b的加权平均，
+// 方差为 (1/N^2) sum_b n_b^2 sum_k p_k^2 sigma_k^2 / n_{k,b}。自适应分配下每块的n_{k,b}不同，不能把各块的层样本数加在一起。
+// sigma_k^2用所有块合并后的层内方差估计（单个块中某层可能只有一条路径），每层另外累计 sum_b n_b^2 / n_{k,b}
+class StratifiedAccumulator {
+public:
+    // probabilities为每层的概率，为空时不分层
+    explicit StratifiedAccumulator(const std::vector<double>& probabilities = {});
+    // 一个路径块每层的矩（下标为层号，见Pricing::calculate_strata_moments），按块的顺序加入
+    void add(const std::vector<MomentAccumulator>& block);
+
+    bool empty() const;
+    double standardError() const;
+
+private:
+    std::vector<double> probabilities_;
+    std::vector<TreeAccumulator> moments_;
+    std::vector<double> blockWeights_;      // sum_b n_b^2 / n_{k,b}
+    double count_;                          // N = sum_b n_b
+};
+
+// Dunning的merging t-digest：样本先进入缓冲区，满了之后与已有的质心一起排序，按尺度函数k(q) = δ/(2π) asin(2q - 1)贪心合并，
+// 分布两端的质心很小（尾部分位数的相对误差约为1/δ²），中间的质心较大。质心个数不超过约δ个，与样本数无关。
+// 每个工作线程各自累加，最后按固定顺序merge，合并顺序相同时结果相同
+class QuantileSketch {
+public:
+    explicit QuantileSketch(double compression = 200.0);
+
+    void add(double value, double weight = 1.0);
+    void add(const Eigen::Ref<const Eigen::VectorXd>& values);
+    // 带权样本，例如重要性抽样或分层抽样的路径权重。权重不为正的样本忽略
+    void add(const Eigen::Ref<const Eigen::VectorXd>& values, const Eigen::Ref<const Eigen::VectorXd>& weights);
+    void merge(const QuantileSketch& other);
+
+    double count() const;           // 总权重
+    double min() const;
+    double max() const;
+    std::size_t getNumCentroids() const;
+
+    // 质心之间线性插值的分位数函数及其反函数
+    double quantile(double q) const;
+    double cdf(double x) const;
+    // edges为递增的分箱边界，返回每个区间(edges(k), edges(k + 1)]的概率（落在边界之外的部分不计入）。cdf为P(X <= x)
+    Eigen::VectorXd histogram(const Eigen::Ref<const Eigen::VectorXd>& edges) const;
+    // 尾部条件期望：E[X | X <= Q(q)]和E[X | X >= Q(q)]。对损失分布取upper_tail_mean即为Expected Shortfall
+    double lower_tail_mean(double q) const;
+    double upper_tail_mean(double q) const;
+
+private:
+    struct Centroid {
+        double mean;
+        double weight;
+    };
+
+    double compression_;
+    // 查询时需要先把缓冲区合并进质心，对外仍是const
+    mutable std::vector<Centroid> centroids_;
+    mutable std::vector<Centroid> buffer_;
+    double count_;
+    double min_;
+    double max_;
+
+    void flush() const;
+    // 分位数函数在总权重区间[0, weight]上的积分
+    double integral(double weight) const;
+};
+
+# endif /* StatisticsAccumulator_hpp */
@@ -0,0 +1,94 @@
+//
+//  TaskScheduler.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 工作窃取（work-stealing）任务调度器：每个工作线程一个双端队列，自己从队尾取任务，空闲时从别的线程队首窃取。
+// TaskGroup提供fork/join，wait时当前线程会帮忙执行队列中的任务，所以Pricing、SensitivityAnalysis和批量接口可以任意嵌套并行而不会死锁。
+
+# ifndef TaskScheduler_hpp
+# define TaskScheduler_hpp
+
+# include <algorithm>
+# include <atomic>
+# include <condition_variable>
+# include <deque>
+# include <exception>
+# include <functional>
+# include <memory>
+# include <mutex>
+# include <thread>
+# include <vector>
+
+class TaskScheduler {
+public:
+    using Task = std::function<void()>;
+
+    explicit TaskScheduler(unsigned int numWorkers = std::thread::hardware_concurrency());
+    virtual ~TaskScheduler();
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // 全局共享的调度器，整个批次的定价任务都投到这里，保证所有核心始终有活可干
+    static TaskScheduler& instance();
+
+    void submit(Task task);
+    // 取一个任务（本线程队列或窃取）并执行，没有可执行的任务时返回false
+    bool try_run_one();
+    unsigned int getNumWorkers() const;
+
+    // 把[begin, end)按grain切块并行执行function(i)，返回时全部完成
+    template<typename Function>
+    void parallel_for(long begin, long end, long grain, const Function& function);
+
+private:
+    struct Worker {
+        std::deque<Task> tasks;
+        std::mutex mutex;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> stop_;
+    std::atomic<unsigned int> nextWorker_;     // 外部线程提交任务时轮流放入各个队列
+    long queued_;                               // 队列中尚未被取走的任务数，由sleepMutex_保护
+    std::mutex sleepMutex_;
+    std::condition_variable sleepCv_;
+
+    bool pop_task(Task& task);
+    void worker_loop(unsigned int index);
+};
+
+class TaskGroup {
+public:
+    explicit TaskGroup(TaskScheduler& scheduler = TaskScheduler::instance());
+    virtual ~TaskGroup();
+
+    void run(TaskScheduler::Task task);
+    // 等待本组所有任务完成，期间帮忙执行任务；任务中抛出的第一个异常在这里重新抛出
+    void wait();
+
+private:
+    TaskScheduler& scheduler_;
+    std::atomic<long> pending_;
+    std::exception_ptr error_;
+    std::mutex errorMutex_;
+};
+
+template<typename Function>
+void TaskScheduler::parallel_for(long begin, long end, long grain, const Function& function) {
+    TaskGroup group(*this);
+    grain = std::max(1L, grain);
+    for (long start = begin; start < end; start += grain) {
+        long stop = std::min(end, start + grain);
+        group.run([&function, start, stop]() {
+            for (long i = start; i < stop; ++i) {
+                function(i);
+            }
+        });
+    }
+    group.wait();
+}
+
+# endif /* TaskScheduler_hpp */
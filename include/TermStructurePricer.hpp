@@ -0,0 +1,54 @@
+//
+//  TermStructurePricer.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 一次模拟给出整条到期日序列：路径模拟到最后一个观察日，每个观察日t_k上把路径的前k + 1列（期初到t_k）交给payoff，
+// 并折现到t_k。路径依赖的payoff（亚式、障碍、回望）在每个到期日看到的正好是到期日为t_k时的路径，结果与单独以t_k为期限定价的分布相同。
+// 多个payoff（例如不同行权价）共享同一批路径，一次得到 行权价 x 到期日 的整张价格表。
+// 路径和收敛判断由Pricing::calculateSharedResults驱动，每个(payoff, 到期日)是一个cell，有自己的Gelman-Rubin判断；
+// params中payoffDistribution为true时每个结果另外带有payoff分布的分位数草图。
+
+# ifndef TermStructurePricer_hpp
+# define TermStructurePricer_hpp
+
+# include <vector>
+# include "Parameters.hpp"
+# include "Pricing.hpp"
+
+class PricingModel;
+class Payoff;
+
+class TermStructurePricer {
+public:
+    // 需要的参数：observationTimes（std::vector<double>，单位为年，递增）、dt、maxSimulations、confidenceLevel、tolerance，以及模型参数。
+    // 每个观察日取最近的时间步，numSteps由最后一个观察日决定（params中的numSteps被忽略）。不支持重要性抽样（漂移平移量与payoff和期限有关）
+    TermStructurePricer(const PricingModel& pathModel, const Parameters& params);
+    virtual ~TermStructurePricer() = default;
+
+    // payoffParams为该payoff自己的参数（strike等），缺省时使用构造时的params。返回该payoff的序号
+    std::size_t add_payoff(const Payoff& payoff, const Parameters& payoffParams);
+    std::size_t add_payoff(const Payoff& payoff);
+
+    const std::vector<int>& getSteps() const;
+    // 实际使用的到期日：时间步 x dt
+    std::vector<double> getMaturities() const;
+
+    // 结果[payoff序号][到期日序号]
+    std::vector<std::vector<PricingResult>> price() const;
+
+private:
+    struct PayoffEntry {
+        const Payoff* payoff;
+        Parameters params;
+    };
+
+    const PricingModel& pathModel_;
+    Parameters params_;
+    double dt_;
+    std::vector<int> steps_;
+    std::vector<PayoffEntry> payoffs_;
+};
+
+# endif /* TermStructurePricer_hpp */
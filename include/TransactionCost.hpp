@@ -8,21 +8,28 @@
 # ifndef TransactionCost_hpp
 # define TransactionCost_hpp
 
+# include <Eigen/Dense>
+
 class TransactionCost {
 public:
     virtual ~TransactionCost() = default;
     virtual double getCost(double transactionSize) const = 0;
+    // 一个时间步所有路径的交易成本，costs(i) = getCost(transactionSizes(i))，交易量为0（不调仓）的路径不收费。
+    // 默认实现逐个调用getCost
+    virtual void getCostColumn(const Eigen::Ref<const Eigen::ArrayXd>& transactionSizes, Eigen::Ref<Eigen::ArrayXd> costs) const;
 };
 
 class ZeroTransactionCost : public TransactionCost {
 public:
     double getCost(double transactionSize) const override;
+    void getCostColumn(const Eigen::Ref<const Eigen::ArrayXd>& transactionSizes, Eigen::Ref<Eigen::ArrayXd> costs) const override;
 };
 
 class FixedTransactionCost : public TransactionCost {
 public:
     explicit FixedTransactionCost(double cost);
     double getCost(double transactionSize) const override;
+    void getCostColumn(const Eigen::Ref<const Eigen::ArrayXd>& transactionSizes, Eigen::Ref<Eigen::ArrayXd> costs) const override;
 
 private:
     double cost;
@@ -11,6 +11,8 @@
 # include <iostream>              // 避免在hpp中用标准库，否则应用前向声明、guard pragma等防止重复包含
 # include <random>
 # include <cmath>
+# include <vector>
+# include <Eigen/Dense>
 
 class Parameters;
 
@@ -18,6 +20,9 @@ class VolatilityModel {
 public:
     virtual ~VolatilityModel() = default;
     virtual double getVolatility(const Parameters& params) const = 0;
+    // 波动率只依赖(S, t)的模型可以按整列路径计算：模拟器在每一步价格更新后调用一次，代替逐条路径的getVolatility
+    virtual bool supportsColumnEvaluation() const;
+    virtual void getVolatilityColumn(const Parameters& params, double t, const Eigen::Ref<const Eigen::VectorXd>& spots, Eigen::Ref<Eigen::VectorXd> volatilities) const;
 };
 
 class ConstantVolatilityModel : public VolatilityModel {
@@ -26,6 +31,28 @@ public:
     double getVolatility(const Parameters& params) const override;
 };
 
+// Dupire局部波动率：由隐含波动率网格（行为到期日impliedVolMaturities，列为行权价impliedVolStrikes）一次性构造sigma(K, T)，
+// 重新采样到均匀的行权价网格上，按到期日逐列存放（同一到期日的行权价连续）并预先算好每个区间的斜率，查表为O(1)
+class LocalVolatilityModel : public VolatilityModel {
+public:
+    LocalVolatilityModel(const Parameters& params);
+    // 单点取值sigma(St, t)，t = stepIndex * dt
+    double getVolatility(const Parameters& params) const override;
+    bool supportsColumnEvaluation() const override;
+    void getVolatilityColumn(const Parameters& params, double t, const Eigen::Ref<const Eigen::VectorXd>& spots, Eigen::Ref<Eigen::VectorXd> volatilities) const override;
+    double localVolatility(double spot, double t) const;
+
+private:
+    double strikeMin_;
+    double strikeStep_;
+    double inverseStrikeStep_;
+    std::vector<double> maturities_;
+    Eigen::MatrixXd localVol_;          // 均匀行权价节点 x 到期日
+    Eigen::MatrixXd slopes_;            // 节点j到j + 1之间对行权价的斜率
+
+    void locate_maturity(double t, Eigen::Index& lower, Eigen::Index& upper, double& weight) const;
+};
+
 class HestonModel : public VolatilityModel {
 public:
     HestonModel(const Parameters& params);
@@ -36,7 +63,6 @@ private:
     double theta_HM_;
     double xi_HM_;
     double rho_HM_;
-    double dt_;
 };
 
 class SABRModel : public VolatilityModel {
@@ -49,7 +75,6 @@ private:
     double beta_SABRM_;
     double rho_SABRM_;
     double nu_SABRM_;
-    double dt_;
 };
 
 class GARCHModel : public VolatilityModel {
@@ -61,7 +86,6 @@ private:
     double alpha0_GARCHM_;
     double alpha1_GARCHM_;
     double beta_GARCHM_;
-    double dt_;
 };
 
 class JumpDiffusionModel : public VolatilityModel {
@@ -72,7 +96,6 @@ public:
 private:
     double jumpMean_JDM_;
     double jumpVol_JDM_;
-    double dt_;
 };
 
 # endif // VOLATILITYMODEL_HPP
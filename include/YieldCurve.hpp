@@ -0,0 +1,63 @@
+//
+//  YieldCurve.hpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 利率期限结构：由存款利率和互换利率自举，折现因子做对数线性插值（分段常数的瞬时远期利率）。
+// 模拟时按(dt, numSteps)把折现因子和远期利率预先算到时间网格上，模型在每一步只按stepIndex取值，不再逐次插值。
+// 使用方法：params.set<std::shared_ptr<const YieldCurve>>("yieldCurve", curve)，MonteCarloSimulator会为自己的网格取出CurveGrid
+
+# ifndef YieldCurve_hpp
+# define YieldCurve_hpp
+
+# include <vector>
+# include <memory>
+# include <mutex>
+# include <Eigen/Dense>
+
+struct CurveQuote {
+    enum class Type { Deposit, Swap };
+    Type type;
+    double maturity;            // 年
+    double rate;                // 存款为单利，互换为平价固定利率
+    int paymentsPerYear = 1;    // 互换固定端的付息频率
+};
+
+// 时间网格t_k = k * dt上的曲线，k = 0..numSteps
+struct CurveGrid {
+    double dt;
+    Eigen::VectorXd discountFactors;    // P(0, t_k)
+    Eigen::VectorXd forwardRates;       // [t_k, t_k+1)上的连续复利远期利率，左端点积分正好还原P(0, t_k)
+};
+
+class YieldCurve {
+public:
+    // times从小到大且都大于0，P(0, 0) = 1自动加入
+    YieldCurve(const std::vector<double>& times, const std::vector<double>& discountFactors);
+    virtual ~YieldCurve() = default;
+
+    // 按到期日依次自举：存款直接给出P(0, T)，互换在已有曲线上求解最后一个节点使平价条件成立
+    static std::shared_ptr<YieldCurve> bootstrap(std::vector<CurveQuote> quotes);
+
+    double discount(double t) const;
+    double zeroRate(double t) const;
+    double forwardRate(double t1, double t2) const;
+    double instantaneousForward(double t) const;
+
+    const std::vector<double>& getTimes() const;
+
+    // 同一个网格只计算一次，之后各模拟器共享
+    std::shared_ptr<const CurveGrid> grid(double dt, int numSteps) const;
+
+private:
+    std::vector<double> times_;
+    std::vector<double> logDiscounts_;
+
+    mutable std::mutex gridMutex_;
+    mutable std::vector<std::shared_ptr<const CurveGrid>> grids_;
+
+    double log_discount(double t) const;
+};
+
+# endif /* YieldCurve_hpp */
@@ -0,0 +1,157 @@
+//
+//  Arena.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 原来generate_paths每次都在堆上分配三组随机数矩阵、三组对偶矩阵、三组dW矩阵以及每一步的临时向量，
+// BarrierPayoff每次求值还要分配筛选后的路径矩阵和内层payoff对象。这些内存的生命周期都不超过一个路径块，
+// 所以改成从线程自己的arena中顺序分配，块结束后回退指针即可。
+// Linux下可以选择用mmap + MADV_HUGEPAGE申请透明大页，减少大矩阵的TLB缺失；其他平台退化为普通的对齐分配。
+
+# include "Arena.hpp"
+# include <cstdlib>
+# include <new>
+# include <algorithm>
+# if defined(__linux__)
+# include <sys/mman.h>
+# endif
+
+namespace {
+std::size_t defaultCapacity = std::size_t(8) << 20;     // 8MB
+bool defaultHugePages = false;
+const std::size_t kHugePageSize = std::size_t(2) << 20;
+
+std::size_t align_up(std::size_t bytes, std::size_t alignment) {
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+}
+
+Arena::Arena(std::size_t capacity, bool useHugePages)
+    : buffer_(nullptr), capacity_(0), offset_(0), useHugePages_(useHugePages), mapped_(false), overflowBytes_(0), peak_(0), scopeDepth_(0) {
+    allocate_buffer(capacity);
+}
+
+Arena::~Arena() {
+    for (void* block : overflow_) {
+        std::free(block);
+    }
+    release_buffer();
+}
+
+Arena& Arena::local() {
+    thread_local Arena arena(defaultCapacity, defaultHugePages);
+    return arena;
+}
+
+void Arena::configure(std::size_t capacity, bool useHugePages) {
+    defaultCapacity = capacity;
+    defaultHugePages = useHugePages;
+}
+
+void Arena::allocate_buffer(std::size_t capacity) {
+    capacity = align_up(std::max<std::size_t>(capacity, kAlignment), kAlignment);
+# if defined(__linux__)
+    if (useHugePages_) {
+        capacity = align_up(capacity, kHugePageSize);
+        void* memory = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory != MAP_FAILED) {
+            madvise(memory, capacity, MADV_HUGEPAGE);
+            buffer_ = static_cast<char*>(memory);
+            capacity_ = capacity;
+            mapped_ = true;
+            return;
+        }
+    }
+# endif
+    void* memory = nullptr;
+    if (posix_memalign(&memory, kAlignment, capacity) != 0) {
+        throw std::bad_alloc();
+    }
+    buffer_ = static_cast<char*>(memory);
+    capacity_ = capacity;
+    mapped_ = false;
+}
+
+void Arena::release_buffer() {
+# if defined(__linux__)
+    if (mapped_) {
+        munmap(buffer_, capacity_);
+        buffer_ = nullptr;
+        return;
+    }
+# endif
+    std::free(buffer_);
+    buffer_ = nullptr;
+}
+
+void* Arena::allocate(std::size_t bytes) {
+    bytes = align_up(std::max<std::size_t>(bytes, 1), kAlignment);
+    if (offset_ + bytes <= capacity_) {
+        void* pointer = buffer_ + offset_;
+        offset_ += bytes;
+        peak_ = std::max(peak_, offset_ + overflowBytes_);
+        return pointer;
+    }
+    // 主缓冲区不够：先从堆上分配，等回退到0时再统一扩容
+    void* memory = nullptr;
+    if (posix_memalign(&memory, kAlignment, bytes) != 0) {
+        throw std::bad_alloc();
+    }
+    overflow_.push_back(memory);
+    overflowBytes_ += bytes;
+    peak_ = std::max(peak_, offset_ + overflowBytes_);
+    return memory;
+}
+
+Eigen::Map<Eigen::MatrixXd, Eigen::Aligned64> Arena::allocate_matrix(Eigen::Index rows, Eigen::Index cols) {
+    return Eigen::Map<Eigen::MatrixXd, Eigen::Aligned64>(allocate_array<double>(rows * cols), rows, cols);
+}
+
+Eigen::Map<Eigen::VectorXd, Eigen::Aligned64> Arena::allocate_vector(Eigen::Index size) {
+    return Eigen::Map<Eigen::VectorXd, Eigen::Aligned64>(allocate_array<double>(size), size);
+}
+
+std::size_t Arena::mark() const {
+    return offset_;
+}
+
+void Arena::rewind(std::size_t mark) {
+    offset_ = std::min(mark, offset_);
+    if (offset_ == 0 && scopeDepth_ == 0 && !overflow_.empty()) {
+        for (void* block : overflow_) {
+            std::free(block);
+        }
+        overflow_.clear();
+        overflowBytes_ = 0;
+        if (peak_ > capacity_) {
+            release_buffer();
+            allocate_buffer(peak_);
+        }
+    }
+}
+
+void Arena::reset() {
+    rewind(0);
+}
+
+std::size_t Arena::capacity() const {
+    return capacity_;
+}
+
+std::size_t Arena::used() const {
+    return offset_ + overflowBytes_;
+}
+
+bool Arena::usesHugePages() const {
+    return mapped_;
+}
+
+Arena::Scope::Scope(Arena& arena) : arena_(arena), mark_(arena.mark()) {
+    ++arena_.scopeDepth_;
+}
+
+Arena::Scope::~Scope() {
+    --arena_.scopeDepth_;
+    arena_.rewind(mark_);
+}
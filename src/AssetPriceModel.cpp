@@ -12,22 +12,24 @@
 
 # include "AssetPriceModel.hpp"
 # include "Parameters.hpp"
+# include <cmath>
 
 // 几何布朗运动模型实现
-GeometricBrownianMotionModel::GeometricBrownianMotionModel(const Parameters& params): dt_(params.get<double>("dt")) {}
+GeometricBrownianMotionModel::GeometricBrownianMotionModel(const Parameters& /*params*/) {}
 // dW_spot_(params.get<double>("dW_spot"))，由于随机变量都是在MonteCarloSimulator中生成的，所以dW不能进入Model的初始化列表，否则将导致无法实现相关Class的构造函数
+// dt同样不进入初始化列表，每次从params中读取。这样同一个模型可以在不同步长的网格上使用（例如多层蒙特卡罗中粗细两层共享一个模型）
 
 double GeometricBrownianMotionModel::simulatePrice(const Parameters& params) const {
-    return params.get<double>("St") * std::exp((params.get<double>("rt") - 0.5 * params.get<double>("vt") * params.get<double>("vt")) * dt_ + params.get<double>("vt") * params.get<double>("dW_spot"));          // checked，其中rate就是mu
+    return params.get<double>("St") * std::exp((params.get<double>("rt") - 0.5 * params.get<double>("vt") * params.get<double>("vt")) * params.get<double>("dt") + params.get<double>("vt") * params.get<double>("dW_spot"));          // checked，其中rate就是mu
 }
 // 这里没有更新成员变量的函数，所以这里用的都是params.get，只要增加了更新函数，那么就可以用spot_等，两种方法哪个计算效率等更高有待考量。如果这里直接用spot_，会始终用一个取值不变的spot_，而不更新。如果增加更新，则可以将spot_ volatility rate dW_spot_等都拉入成员变量中。现在的格式则不允许这么做，即便做了simulate这里也必须要到params中get最新的取值
 
 // 跳跃扩散模型实现
-JumpDiffusionPriceModel::JumpDiffusionPriceModel(const Parameters& params):  dt_(params.get<double>("dt")),  jumpMean_JDPM_(params.get<double>("jumpMean_JDPM")), jumpVol_JDPM_(params.get<double>("jumpVol_JDPM")), jumpIntensity_JDPM_(params.get<double>("jumpIntensity_JDPM")), jumpSize_JDPM_(params.get<double>("jumpSize_JDPM")) {} //, dW_spot_(params.get<double>("dW_spot"))
+JumpDiffusionPriceModel::JumpDiffusionPriceModel(const Parameters& params):  jumpMean_JDPM_(params.get<double>("jumpMean_JDPM")), jumpVol_JDPM_(params.get<double>("jumpVol_JDPM")), jumpIntensity_JDPM_(params.get<double>("jumpIntensity_JDPM")), jumpSize_JDPM_(params.get<double>("jumpSize_JDPM")) {} //, dW_spot_(params.get<double>("dW_spot"))
 
 double JumpDiffusionPriceModel::simulatePrice(const Parameters& params) const {
     double jumpComponent_ = exp(jumpMean_JDPM_ * jumpSize_JDPM_ + jumpVol_JDPM_ * sqrt(jumpSize_JDPM_) * params.get<double>("dW_spot"));
-    return params.get<double>("St") * exp((params.get<double>("rt") - 0.5 * params.get<double>("vt") * params.get<double>("vt")) * dt_ + params.get<double>("vt")) * jumpComponent_;
+    return params.get<double>("St") * exp((params.get<double>("rt") - 0.5 * params.get<double>("vt") * params.get<double>("vt")) * params.get<double>("dt") + params.get<double>("vt")) * jumpComponent_;
 }
 
 
@@ -0,0 +1,117 @@
+//
+//  BlackScholes.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 到期时（maturity <= 0）或者波动率为0时退化为内在价值（远期意义下），避免d1、d2除以0
+
+# include "BlackScholes.hpp"
+# include <cmath>
+# include <algorithm>
+
+namespace {
+const double kInvSqrt2 = 0.7071067811865475244;
+const double kInvSqrt2Pi = 0.3989422804014326779;
+
+Eigen::ArrayXd normal_cdf_array(const Eigen::ArrayXd& x) {
+    return 0.5 * (-x * kInvSqrt2).unaryExpr([](double v) { return std::erfc(v); });
+}
+}
+
+double BlackScholes::normal_cdf(double x) {
+    return 0.5 * std::erfc(-x * kInvSqrt2);
+}
+
+double BlackScholes::price(bool isCall, double spot, double strike, double rate, double volatility, double maturity) {
+    const double discount = std::exp(-rate * std::max(maturity, 0.0));
+    const double stdDev = volatility * std::sqrt(std::max(maturity, 0.0));
+    if (stdDev <= 0.0) {
+        return isCall ? std::max(spot - strike * discount, 0.0) : std::max(strike * discount - spot, 0.0);
+    }
+    const double d1 = (std::log(spot / strike) + rate * maturity) / stdDev + 0.5 * stdDev;
+    const double d2 = d1 - stdDev;
+    return isCall ? spot * normal_cdf(d1) - strike * discount * normal_cdf(d2)
+                  : strike * discount * normal_cdf(-d2) - spot * normal_cdf(-d1);
+}
+
+Greeks BlackScholes::greeks(bool isCall, double spot, double strike, double rate, double volatility, double maturity) {
+    Greeks result;
+    result.price = price(isCall, spot, strike, rate, volatility, maturity);
+    const double stdDev = volatility * std::sqrt(std::max(maturity, 0.0));
+    if (stdDev <= 0.0) {
+        const double forwardMoneyness = spot - strike * std::exp(-rate * std::max(maturity, 0.0));
+        result.delta = isCall ? (forwardMoneyness > 0.0 ? 1.0 : 0.0) : (forwardMoneyness < 0.0 ? -1.0 : 0.0);
+        result.gamma = 0.0;
+        result.vega = 0.0;
+        return result;
+    }
+    const double d1 = (std::log(spot / strike) + rate * maturity) / stdDev + 0.5 * stdDev;
+    const double density = kInvSqrt2Pi * std::exp(-0.5 * d1 * d1);
+    result.delta = isCall ? normal_cdf(d1) : normal_cdf(d1) - 1.0;
+    result.gamma = density / (spot * stdDev);
+    result.vega = spot * density * std::sqrt(maturity);
+    return result;
+}
+
+void BlackScholes::price(bool isCall, const Eigen::Ref<const Eigen::ArrayXd>& spots, double strike, double rate,
+                         const Eigen::Ref<const Eigen::ArrayXd>& volatilities, double maturity, Eigen::Ref<Eigen::ArrayXd> prices) {
+    const double discountedStrike = strike * std::exp(-rate * std::max(maturity, 0.0));
+    if (maturity <= 0.0) {
+        if (isCall) {
+            prices = (spots - discountedStrike).max(0.0);
+        } else {
+            prices = (discountedStrike - spots).max(0.0);
+        }
+        return;
+    }
+    const Eigen::ArrayXd stdDev = (volatilities * std::sqrt(maturity)).max(1e-12);
+    const Eigen::ArrayXd d1 = ((spots / strike).log() + rate * maturity) / stdDev + 0.5 * stdDev;
+    const Eigen::ArrayXd d2 = d1 - stdDev;
+    if (isCall) {
+        prices = spots * normal_cdf_array(d1) - discountedStrike * normal_cdf_array(d2);
+    } else {
+        prices = discountedStrike * normal_cdf_array(-d2) - spots * normal_cdf_array(-d1);
+    }
+}
+
+void BlackScholes::greeks(bool isCall, const Eigen::Ref<const Eigen::ArrayXd>& spots, double strike, double rate,
+                          const Eigen::Ref<const Eigen::ArrayXd>& volatilities, double maturity,
+                          Eigen::Ref<Eigen::ArrayXd> prices, Eigen::Ref<Eigen::ArrayXd> deltas, Eigen::Ref<Eigen::ArrayXd> gammas) {
+    if (maturity <= 0.0) {
+        price(isCall, spots, strike, rate, volatilities, maturity, prices);
+        delta(isCall, spots, strike, rate, volatilities, maturity, deltas);
+        gammas.setZero();
+        return;
+    }
+    const double discountedStrike = strike * std::exp(-rate * maturity);
+    const Eigen::ArrayXd stdDev = (volatilities * std::sqrt(maturity)).max(1e-12);
+    const Eigen::ArrayXd d1 = ((spots / strike).log() + rate * maturity) / stdDev + 0.5 * stdDev;
+    const Eigen::ArrayXd d2 = d1 - stdDev;
+    if (isCall) {
+        deltas = normal_cdf_array(d1);
+        prices = spots * deltas - discountedStrike * normal_cdf_array(d2);
+    } else {
+        deltas = -normal_cdf_array(-d1);
+        prices = discountedStrike * normal_cdf_array(-d2) + spots * deltas;
+    }
+    gammas = kInvSqrt2Pi * (-0.5 * d1.square()).exp() / (spots * stdDev);
+}
+
+void BlackScholes::delta(bool isCall, const Eigen::Ref<const Eigen::ArrayXd>& spots, double strike, double rate,
+                         const Eigen::Ref<const Eigen::ArrayXd>& volatilities, double maturity, Eigen::Ref<Eigen::ArrayXd> deltas) {
+    if (maturity <= 0.0) {
+        if (isCall) {
+            deltas = (spots > strike).cast<double>();
+        } else {
+            deltas = -(spots < strike).cast<double>();
+        }
+        return;
+    }
+    const Eigen::ArrayXd stdDev = (volatilities * std::sqrt(maturity)).max(1e-12);
+    const Eigen::ArrayXd d1 = ((spots / strike).log() + rate * maturity) / stdDev + 0.5 * stdDev;
+    deltas = normal_cdf_array(d1);
+    if (!isCall) {
+        deltas -= 1.0;
+    }
+}
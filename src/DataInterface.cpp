@@ -10,3 +10,463 @@
 // 需要注意的是一般delta t也是用年标识的，例如1/252，这样整个价格模型中的数据都是年化的。
 
 # include "DataInterface.hpp"
+# include <fstream>
+# include <map>
+# include <numeric>
+# include <algorithm>
+# include <cstring>
+# include <cctype>
+# include <cstdlib>
+# include <cmath>
+# include <filesystem>
+# include <stdexcept>
+# if defined(__unix__) || defined(__APPLE__)
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+# endif
+
+// 二进制文件布局（本机字节序，所有区段64字节对齐）：
+//   FileHeader | 列名（每个32字节） | 标的表（按名称排序） | date列int32[numRows] | 每个数值列double[numRows]
+// 文件由本机写出、本机读取，不做字节序转换
+namespace {
+const char kMagic[8] = {'D', 'P', 'M', 'K', 'T', 'v', '1', '\0'};
+const std::size_t kNameLength = 32;
+const std::size_t kAlignment = 64;
+
+struct FileHeader {
+    char magic[8];
+    std::uint64_t numRows;
+    std::uint32_t numColumns;
+    std::uint32_t numSymbols;
+    std::uint64_t namesOffset;
+    std::uint64_t symbolsOffset;
+    std::uint64_t datesOffset;
+    std::uint64_t columnsOffset;
+    std::uint64_t columnStride;     // 相邻两个数值列之间的字节数
+};
+
+struct SymbolRecord {
+    char name[kNameLength];
+    std::uint64_t firstRow;
+    std::uint64_t numRows;
+};
+
+std::size_t align_up(std::size_t bytes) {
+    return (bytes + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// [offset, offset + count * elementSize)是否完整落在文件内且按kAlignment对齐（不会溢出）
+bool section_fits(std::uint64_t offset, std::uint64_t count, std::uint64_t elementSize, std::uint64_t fileSize) {
+    if (offset % kAlignment != 0 || offset > fileSize) {
+        return false;
+    }
+    return elementSize == 0 || count <= (fileSize - offset) / elementSize;
+}
+
+bool valid_header(const FileHeader& header, std::uint64_t fileSize) {
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        return false;
+    }
+    if (!section_fits(header.namesOffset, header.numColumns, kNameLength, fileSize) ||
+        !section_fits(header.symbolsOffset, header.numSymbols, sizeof(SymbolRecord), fileSize) ||
+        !section_fits(header.datesOffset, header.numRows, sizeof(std::int32_t), fileSize)) {
+        return false;
+    }
+    // 每个数值列至少容纳numRows个double，所有列都在文件内
+    if (header.columnStride % kAlignment != 0 || header.numRows > header.columnStride / sizeof(double)) {
+        return false;
+    }
+    return header.columnStride == 0 ? header.numRows == 0 : section_fits(header.columnsOffset, header.numColumns, header.columnStride, fileSize);
+}
+
+std::vector<std::string> split_line(const std::string& line) {
+    std::vector<std::string> fields;
+    std::size_t start = 0;
+    while (true) {
+        std::size_t comma = line.find(',', start);
+        std::string field = line.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        // 去掉首尾空白和Windows换行
+        std::size_t first = field.find_first_not_of(" \t\r\"");
+        std::size_t last = field.find_last_not_of(" \t\r\"");
+        fields.push_back(first == std::string::npos ? std::string() : field.substr(first, last - first + 1));
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    return fields;
+}
+
+bool parse_date(const std::string& text, int& date) {
+    if (text.size() == 10 && text[4] == '-' && text[7] == '-') {
+        date = std::atoi(text.substr(0, 4).c_str()) * 10000 + std::atoi(text.substr(5, 2).c_str()) * 100 + std::atoi(text.substr(8, 2).c_str());
+        return true;
+    }
+    if (text.size() == 8 && std::all_of(text.begin(), text.end(), [](unsigned char ch) { return std::isdigit(ch) != 0; })) {
+        date = std::atoi(text.c_str());
+        return true;
+    }
+    return false;
+}
+
+double parse_value(const std::string& text, long lineNumber) {
+    int date;
+    if (text.size() == 10 && parse_date(text, date)) {
+        return date;
+    }
+    if (text == "C" || text == "c" || text == "call" || text == "Call") {
+        return 1.0;
+    }
+    if (text == "P" || text == "p" || text == "put" || text == "Put") {
+        return 0.0;
+    }
+    if (text.empty()) {
+        return std::nan("");
+    }
+    char* end = nullptr;
+    double value = std::strtod(text.c_str(), &end);
+    if (end == text.c_str() || *end != '\0') {
+        throw std::runtime_error("Invalid numeric value '" + text + "' on line " + std::to_string(lineNumber));
+    }
+    return value;
+}
+
+// 公历日期到1970-01-01的天数（Howard Hinnant的days_from_civil）
+long days_from_civil(int yyyymmdd) {
+    long y = yyyymmdd / 10000;
+    const long m = yyyymmdd / 100 % 100;
+    const long d = yyyymmdd % 100;
+    y -= m <= 2;
+    const long era = (y >= 0 ? y : y - 399) / 400;
+    const long yoe = y - era * 400;
+    const long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+}
+
+void MarketDataStore::convert_csv(const std::string& csvPath, const std::string& binaryPath) {
+    std::ifstream csv(csvPath);
+    if (!csv) {
+        throw std::runtime_error("Cannot open market data file: " + csvPath);
+    }
+    std::string line;
+    if (!std::getline(csv, line)) {
+        throw std::runtime_error("Empty market data file: " + csvPath);
+    }
+    std::vector<std::string> header = split_line(line);
+    if (header.size() < 3 || header[0] != "symbol" || header[1] != "date") {
+        throw std::runtime_error("Market data file must start with columns symbol,date and at least one value column: " + csvPath);
+    }
+    const std::size_t numColumns = header.size() - 2;
+    for (const std::string& name : header) {
+        if (name.size() >= kNameLength) {
+            throw std::runtime_error("Column name too long: " + name);
+        }
+    }
+
+    // 按列读入内存，标的名称映射为整数编号
+    std::map<std::string, std::uint32_t> symbolIds;
+    std::vector<std::string> symbolNames;
+    std::vector<std::uint32_t> symbols;
+    std::vector<std::int32_t> dates;
+    std::vector<std::vector<double>> columns(numColumns);
+    long lineNumber = 1;
+    while (std::getline(csv, line)) {
+        ++lineNumber;
+        if (line.empty() || line == "\r") {
+            continue;
+        }
+        std::vector<std::string> fields = split_line(line);
+        if (fields.size() != header.size()) {
+            throw std::runtime_error("Wrong number of fields on line " + std::to_string(lineNumber) + " of " + csvPath);
+        }
+        if (fields[0].empty() || fields[0].size() >= kNameLength) {
+            throw std::runtime_error("Invalid symbol on line " + std::to_string(lineNumber) + " of " + csvPath);
+        }
+        int date;
+        if (!parse_date(fields[1], date)) {
+            throw std::runtime_error("Invalid date '" + fields[1] + "' on line " + std::to_string(lineNumber));
+        }
+        auto inserted = symbolIds.emplace(fields[0], static_cast<std::uint32_t>(symbolNames.size()));
+        if (inserted.second) {
+            symbolNames.push_back(fields[0]);
+        }
+        symbols.push_back(inserted.first->second);
+        dates.push_back(date);
+        for (std::size_t c = 0; c < numColumns; ++c) {
+            columns[c].push_back(parse_value(fields[c + 2], lineNumber));
+        }
+    }
+    const std::size_t numRows = dates.size();
+
+    // 标的按名称排序后的序号，行按(标的, 日期, 其余各列)排序
+    std::vector<std::uint32_t> symbolRank(symbolNames.size());
+    {
+        std::uint32_t rank = 0;
+        for (const auto& entry : symbolIds) {
+            symbolRank[entry.second] = rank++;
+        }
+    }
+    std::vector<std::size_t> order(numRows);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        if (symbolRank[symbols[a]] != symbolRank[symbols[b]]) return symbolRank[symbols[a]] < symbolRank[symbols[b]];
+        if (dates[a] != dates[b]) return dates[a] < dates[b];
+        for (std::size_t c = 0; c < numColumns; ++c) {
+            // 空单元格为NaN，排在同一列所有数值之后，保证比较是严格弱序
+            const double x = columns[c][a];
+            const double y = columns[c][b];
+            if (std::isnan(x) != std::isnan(y)) return std::isnan(y);
+            if (!std::isnan(x) && x != y) return x < y;
+        }
+        return a < b;
+    });
+
+    FileHeader fileHeader = {};
+    std::memcpy(fileHeader.magic, kMagic, sizeof(kMagic));
+    fileHeader.numRows = numRows;
+    fileHeader.numColumns = static_cast<std::uint32_t>(numColumns);
+    fileHeader.numSymbols = static_cast<std::uint32_t>(symbolNames.size());
+    fileHeader.namesOffset = align_up(sizeof(FileHeader));
+    fileHeader.symbolsOffset = align_up(fileHeader.namesOffset + numColumns * kNameLength);
+    fileHeader.datesOffset = align_up(fileHeader.symbolsOffset + symbolNames.size() * sizeof(SymbolRecord));
+    fileHeader.columnsOffset = align_up(fileHeader.datesOffset + numRows * sizeof(std::int32_t));
+    fileHeader.columnStride = align_up(numRows * sizeof(double));
+
+    std::ofstream out(binaryPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot create market data file: " + binaryPath);
+    }
+    auto pad_to = [&out](std::uint64_t offset) {
+        static const char zeros[kAlignment] = {};
+        std::uint64_t position = static_cast<std::uint64_t>(out.tellp());
+        out.write(zeros, static_cast<std::streamsize>(offset - position));
+    };
+    out.write(reinterpret_cast<const char*>(&fileHeader), sizeof(FileHeader));
+
+    pad_to(fileHeader.namesOffset);
+    for (std::size_t c = 0; c < numColumns; ++c) {
+        char name[kNameLength] = {};
+        std::memcpy(name, header[c + 2].data(), header[c + 2].size());
+        out.write(name, kNameLength);
+    }
+
+    pad_to(fileHeader.symbolsOffset);
+    std::vector<SymbolRecord> records(symbolNames.size());
+    for (const auto& entry : symbolIds) {
+        SymbolRecord& record = records[symbolRank[entry.second]];
+        std::memcpy(record.name, entry.first.data(), entry.first.size());
+    }
+    for (std::size_t r = 0; r < numRows; ++r) {
+        SymbolRecord& record = records[symbolRank[symbols[order[r]]]];
+        if (record.numRows == 0) {
+            record.firstRow = r;
+        }
+        ++record.numRows;
+    }
+    out.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(SymbolRecord)));
+
+    // 分段写出排序后的列，避免再复制一份完整的数据
+    const std::size_t chunk = 1 << 16;
+    pad_to(fileHeader.datesOffset);
+    std::vector<std::int32_t> dateBuffer;
+    for (std::size_t r = 0; r < numRows; r += chunk) {
+        dateBuffer.clear();
+        for (std::size_t k = r; k < std::min(numRows, r + chunk); ++k) {
+            dateBuffer.push_back(dates[order[k]]);
+        }
+        out.write(reinterpret_cast<const char*>(dateBuffer.data()), static_cast<std::streamsize>(dateBuffer.size() * sizeof(std::int32_t)));
+    }
+    std::vector<double> valueBuffer;
+    for (std::size_t c = 0; c < numColumns; ++c) {
+        pad_to(fileHeader.columnsOffset + c * fileHeader.columnStride);
+        for (std::size_t r = 0; r < numRows; r += chunk) {
+            valueBuffer.clear();
+            for (std::size_t k = r; k < std::min(numRows, r + chunk); ++k) {
+                valueBuffer.push_back(columns[c][order[k]]);
+            }
+            out.write(reinterpret_cast<const char*>(valueBuffer.data()), static_cast<std::streamsize>(valueBuffer.size() * sizeof(double)));
+        }
+    }
+    pad_to(fileHeader.columnsOffset + numColumns * fileHeader.columnStride);
+    if (!out) {
+        throw std::runtime_error("Failed writing market data file: " + binaryPath);
+    }
+}
+
+MarketDataStore MarketDataStore::open_csv(const std::string& csvPath, const std::string& binaryPath) {
+    namespace fs = std::filesystem;
+    if (!fs::exists(binaryPath) || fs::last_write_time(binaryPath) < fs::last_write_time(csvPath)) {
+        convert_csv(csvPath, binaryPath);
+    }
+    return MarketDataStore(binaryPath);
+}
+
+MarketDataStore::MarketDataStore(const std::string& binaryPath)
+    : mapping_(nullptr), mappingSize_(0), mapped_(false), numRows_(0), dates_(nullptr) {
+# if defined(__unix__) || defined(__APPLE__)
+    int fd = ::open(binaryPath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open market data file: " + binaryPath);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+        ::close(fd);
+        throw std::runtime_error("Invalid market data file: " + binaryPath);
+    }
+    mappingSize_ = static_cast<std::size_t>(info.st_size);
+    void* memory = mmap(nullptr, mappingSize_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("Cannot map market data file: " + binaryPath);
+    }
+    mapping_ = memory;
+    mapped_ = true;
+# else
+    // 没有mmap的平台整个读入一块64字节对齐的内存，接口不变
+    std::ifstream in(binaryPath, std::ios::binary | std::ios::ate);
+    if (!in) {
+        throw std::runtime_error("Cannot open market data file: " + binaryPath);
+    }
+    mappingSize_ = static_cast<std::size_t>(in.tellg());
+    mapping_ = ::operator new(mappingSize_, std::align_val_t(kAlignment));
+    in.seekg(0);
+    in.read(static_cast<char*>(mapping_), static_cast<std::streamsize>(mappingSize_));
+# endif
+
+    const char* base = static_cast<const char*>(mapping_);
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(FileHeader));
+    if (!valid_header(header, mappingSize_)) {
+        release();
+        throw std::runtime_error("Invalid or truncated market data file: " + binaryPath);
+    }
+
+    numRows_ = header.numRows;
+    for (std::uint32_t c = 0; c < header.numColumns; ++c) {
+        const char* name = base + header.namesOffset + c * kNameLength;
+        columnNames_.emplace_back(name, strnlen(name, kNameLength));
+        columns_.push_back(reinterpret_cast<const double*>(base + header.columnsOffset + c * header.columnStride));
+    }
+    const SymbolRecord* records = reinterpret_cast<const SymbolRecord*>(base + header.symbolsOffset);
+    for (std::uint32_t s = 0; s < header.numSymbols; ++s) {
+        if (records[s].firstRow > header.numRows || records[s].numRows > header.numRows - records[s].firstRow) {
+            release();
+            throw std::runtime_error("Invalid symbol table in market data file: " + binaryPath);
+        }
+        symbols_.push_back({std::string(records[s].name, strnlen(records[s].name, kNameLength)),
+                            static_cast<std::size_t>(records[s].firstRow), static_cast<std::size_t>(records[s].numRows)});
+    }
+    dates_ = reinterpret_cast<const std::int32_t*>(base + header.datesOffset);
+}
+
+MarketDataStore::MarketDataStore(MarketDataStore&& other) noexcept
+    : mapping_(other.mapping_), mappingSize_(other.mappingSize_), mapped_(other.mapped_), numRows_(other.numRows_),
+      columnNames_(std::move(other.columnNames_)), symbols_(std::move(other.symbols_)), dates_(other.dates_), columns_(std::move(other.columns_)) {
+    other.mapping_ = nullptr;
+    other.mappingSize_ = 0;
+}
+
+MarketDataStore::~MarketDataStore() {
+    release();
+}
+
+void MarketDataStore::release() {
+    if (mapping_ == nullptr) {
+        return;
+    }
+# if defined(__unix__) || defined(__APPLE__)
+    munmap(mapping_, mappingSize_);
+# else
+    ::operator delete(mapping_, std::align_val_t(kAlignment));
+# endif
+    mapping_ = nullptr;
+}
+
+std::size_t MarketDataStore::getNumRows() const {
+    return numRows_;
+}
+
+const std::vector<std::string>& MarketDataStore::getColumnNames() const {
+    return columnNames_;
+}
+
+std::vector<std::string> MarketDataStore::getSymbols() const {
+    std::vector<std::string> names;
+    for (const SymbolEntry& entry : symbols_) {
+        names.push_back(entry.name);
+    }
+    return names;
+}
+
+std::size_t MarketDataStore::column_index(const std::string& name) const {
+    auto it = std::find(columnNames_.begin(), columnNames_.end(), name);
+    if (it == columnNames_.end()) {
+        throw std::runtime_error("Market data column not found: " + name);
+    }
+    return static_cast<std::size_t>(it - columnNames_.begin());
+}
+
+const MarketDataStore::SymbolEntry& MarketDataStore::find_symbol(const std::string& symbol) const {
+    auto it = std::lower_bound(symbols_.begin(), symbols_.end(), symbol, [](const SymbolEntry& entry, const std::string& name) {
+        return entry.name < name;
+    });
+    if (it == symbols_.end() || it->name != symbol) {
+        throw std::runtime_error("Symbol not found in market data: " + symbol);
+    }
+    return *it;
+}
+
+MarketDataSlice MarketDataStore::slice(const std::string& symbol, int fromDate, int toDate) const {
+    const SymbolEntry& entry = find_symbol(symbol);
+    const std::int32_t* first = dates_ + entry.firstRow;
+    const std::int32_t* last = first + entry.numRows;
+    const std::int32_t* begin = std::lower_bound(first, last, fromDate);
+    const std::int32_t* end = std::upper_bound(begin, last, toDate);
+    return MarketDataSlice(*this, static_cast<std::size_t>(begin - dates_), static_cast<std::size_t>(end - dates_));
+}
+
+MarketDataSlice MarketDataStore::slice(const std::string& symbol) const {
+    const SymbolEntry& entry = find_symbol(symbol);
+    return MarketDataSlice(*this, entry.firstRow, entry.firstRow + entry.numRows);
+}
+
+long MarketDataStore::days_between(int a, int b) {
+    return days_from_civil(b) - days_from_civil(a);
+}
+
+MarketDataSlice::MarketDataSlice(const MarketDataStore& store, std::size_t begin, std::size_t end)
+    : store_(&store), begin_(begin), end_(end) {}
+
+Eigen::Index MarketDataSlice::size() const {
+    return static_cast<Eigen::Index>(end_ - begin_);
+}
+
+Eigen::Map<const Eigen::VectorXi> MarketDataSlice::dates() const {
+    return Eigen::Map<const Eigen::VectorXi>(store_->dates_ + begin_, size());
+}
+
+Eigen::Map<const Eigen::VectorXd> MarketDataSlice::column(const std::string& name) const {
+    return Eigen::Map<const Eigen::VectorXd>(store_->columns_[store_->column_index(name)] + begin_, size());
+}
+
+Eigen::Map<const Eigen::ArrayXd> MarketDataSlice::array(const std::string& name) const {
+    return Eigen::Map<const Eigen::ArrayXd>(store_->columns_[store_->column_index(name)] + begin_, size());
+}
+
+MarketDataSlice MarketDataSlice::equal_range(const std::string& name, double value) const {
+    const double* data = store_->columns_[store_->column_index(name)];
+    auto range = std::equal_range(data + begin_, data + end_, value);
+    return MarketDataSlice(*store_, static_cast<std::size_t>(range.first - data), static_cast<std::size_t>(range.second - data));
+}
+
+Eigen::VectorXd MarketDataSlice::log_returns(const std::string& name) const {
+    if (size() < 2) {
+        return Eigen::VectorXd();
+    }
+    Eigen::Map<const Eigen::ArrayXd> prices = array(name);
+    return (prices.tail(size() - 1) / prices.head(size() - 1)).log().matrix();
+}
@@ -0,0 +1,126 @@
+//
+//  FloatPathValidation.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 两次模拟的路径块划分和块种子相同，MonteCarloSimulator在两种模式下抽取的随机数序列也相同，所以第i条路径在两次模拟中是同一条路径。
+// 计时为整次模拟的墙钟时间（路径生成、payoff和折现）。payoff和折现在两次模拟中完全相同，耗时的差别来自路径生成。
+
+# include "FloatPathValidation.hpp"
+# include "MonteCarloSimulator.hpp"
+# include "PricingModel.hpp"
+# include "Payoff.hpp"
+# include "Pricing.hpp"
+# include "TaskScheduler.hpp"
+# include <random>
+# include <chrono>
+# include <cmath>
+# include <algorithm>
+# include <stdexcept>
+
+FloatPathValidation::FloatPathValidation(const PricingModel& pricingModel, const Parameters& params)
+    : pricingModel_(pricingModel), params_(params),
+      numPaths_(params.contains("floatValidationPaths") ? params.get<int>("floatValidationPaths") : 100000),
+      tolerance_(params.contains("floatValidationTolerance") ? params.get<double>("floatValidationTolerance") : 0.1) {
+    if (numPaths_ < 2) {
+        throw std::runtime_error("FloatPathValidation requires floatValidationPaths >= 2");
+    }
+    if (!params_.contains("seed")) {
+        std::random_device rd;
+        params_.set<int>("seed", static_cast<int>(rd() >> 1));
+    }
+    // 标准payoff中的向下敲出看涨
+    params_.set<std::string>("payoff", "EuropeanCallPayoff");
+    params_.set<bool>("isUpIn", false);
+    params_.set<bool>("isUpOut", false);
+    params_.set<bool>("isDownIn", false);
+    params_.set<bool>("isDownOut", true);
+    if (!params_.contains("barrier")) {
+        params_.set<double>("barrier", 0.8 * params_.get<double>("spot"));
+    }
+}
+
+double FloatPathValidation::simulate(bool floatPaths, const std::vector<const Payoff*>& payoffs, Eigen::MatrixXd& discounted, Eigen::VectorXd& terminal) const {
+    const long numBlocks = (numPaths_ + MonteCarloSimulator::kBlockPaths - 1) / MonteCarloSimulator::kBlockPaths;
+    const double dt = params_.get<double>("dt");
+    discounted.resize(numPaths_, payoffs.size());
+    terminal.resize(numPaths_);
+
+    std::vector<unsigned int> blockSeeds(numBlocks);
+    std::seed_seq seq{static_cast<unsigned int>(params_.get<int>("seed"))};
+    seq.generate(blockSeeds.begin(), blockSeeds.end());
+
+    Parameters runParams = params_;
+    runParams.set<bool>("floatPaths", floatPaths);
+    const auto start = std::chrono::steady_clock::now();
+    TaskScheduler::instance().parallel_for(0, numBlocks, 1, [&](long b) {
+        Parameters blockParams = runParams;
+        blockParams.set<int>("seed", static_cast<int>(blockSeeds[b] >> 1));
+        MonteCarloSimulator simulator(blockParams, pricingModel_);
+        simulator.generate_paths();
+        // 最后一个路径块只取前面需要的路径数
+        const long size = std::min(MonteCarloSimulator::kBlockPaths, numPaths_ - b * MonteCarloSimulator::kBlockPaths);
+        const auto paths = simulator.get_price_paths().topRows(size);
+        const Eigen::VectorXd discountFactors = Pricing::calculate_discount_factors(simulator, pricingModel_.getRateModel(), dt);
+        const Eigen::VectorXd weights = simulator.get_path_weights().cwiseProduct(discountFactors).head(size);
+        for (std::size_t p = 0; p < payoffs.size(); ++p) {
+            auto column = discounted.col(p).segment(b * MonteCarloSimulator::kBlockPaths, size);
+            payoffs[p]->evaluate(blockParams, paths, column);
+            column.array() *= weights.array();
+        }
+        terminal.segment(b * MonteCarloSimulator::kBlockPaths, size) = paths.col(paths.cols() - 1);
+    });
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+FloatPathReport FloatPathValidation::run() const {
+    const EuropeanCallPayoff call;
+    const EuropeanPutPayoff put;
+    const AsianPayoff asian;
+    const LookbackPayoff lookback;
+    const BarrierPayoff barrier;
+    return run({&call, &put, &asian, &lookback, &barrier});
+}
+
+FloatPathReport FloatPathValidation::run(const std::vector<const Payoff*>& payoffs) const {
+    Eigen::MatrixXd doubleValues, floatValues;
+    Eigen::VectorXd doubleTerminal, floatTerminal;
+
+    FloatPathReport report;
+    report.numPaths = numPaths_;
+    report.doubleSeconds = simulate(false, payoffs, doubleValues, doubleTerminal);
+    report.floatSeconds = simulate(true, payoffs, floatValues, floatTerminal);
+    report.maxTerminalRelativeError = ((floatTerminal - doubleTerminal).array().abs() / doubleTerminal.array().abs()).maxCoeff();
+    report.passed = true;
+
+    const double n = static_cast<double>(numPaths_);
+    for (std::size_t p = 0; p < payoffs.size(); ++p) {
+        const Eigen::VectorXd differences = floatValues.col(p) - doubleValues.col(p);
+        FloatPathComparison comparison;
+        comparison.payoff = payoffs[p]->getName();
+        comparison.doublePrice = Pricing::calculate_mean(doubleValues.col(p));
+        comparison.floatPrice = Pricing::calculate_mean(floatValues.col(p));
+        comparison.difference = Pricing::calculate_mean(differences);
+        comparison.differenceStandardError = Pricing::calculate_stdev(differences, comparison.difference) / std::sqrt(n);
+        comparison.standardError = Pricing::calculate_stdev(doubleValues.col(p), comparison.doublePrice) / std::sqrt(n);
+        comparison.relativeDifference = comparison.doublePrice != 0.0 ? std::abs(comparison.difference) / std::abs(comparison.doublePrice) : std::abs(comparison.difference);
+        comparison.passed = std::abs(comparison.difference) <= tolerance_ * comparison.standardError;
+        report.passed = report.passed && comparison.passed;
+        report.comparisons.push_back(comparison);
+    }
+    return report;
+}
+
+void FloatPathValidation::print(const FloatPathReport& report, std::ostream& out) {
+    out << "Float path validation (" << report.numPaths << " paths)" << std::endl;
+    for (const FloatPathComparison& c : report.comparisons) {
+        out << c.payoff << ": double " << c.doublePrice << ", float " << c.floatPrice
+            << ", difference " << c.difference << " (+/- " << c.differenceStandardError << ")"
+            << ", MC standard error " << c.standardError << ", relative " << c.relativeDifference
+            << (c.passed ? "  PASS" : "  FAIL") << std::endl;
+    }
+    out << "Max terminal price relative error: " << report.maxTerminalRelativeError << std::endl;
+    out << "Simulation (paths + payoff + discount): double " << report.doubleSeconds << " s, float " << report.floatSeconds << " s" << std::endl;
+    out << (report.passed ? "PASS" : "FAIL") << std::endl;
+}
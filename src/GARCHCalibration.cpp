@@ -0,0 +1,196 @@
+//
+//  GARCHCalibration.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 对数似然 L = -1/2 * sum(ln 2pi + ln h_t + e_t^2 / h_t)，
+// 梯度 dL/dtheta = -1/2 * sum((1 / h_t - e_t^2 / h_t^2) * dh_t/dtheta)，dh_t/dtheta = (1, e_{t-1}^2, h_{t-1}) + beta * dh_{t-1}/dtheta。
+// 方差递推本身是一阶IIR滤波，在时间方向上只能顺序计算，所以核函数在一次遍历中同时推进h和dh/dtheta并累加似然，不分配内存；
+// 并行度来自于序列之间。
+// 约束alpha0 > 0、alpha1, beta >= 0、alpha1 + beta < 1通过重新参数化处理：alpha0 = e^u0，持续性p = s(u1)，
+// alpha1 = p * s(u2)，beta = p * (1 - s(u2))，s为logistic函数，在u空间中做无约束的BFGS。
+
+# include "GARCHCalibration.hpp"
+# include "TaskScheduler.hpp"
+# include <cmath>
+# include <stdexcept>
+
+namespace {
+const double kPi = 3.14159265358979323846;
+const double kLogTwoPi = std::log(2.0 * kPi);
+
+double logistic(double x) {
+    return 1.0 / (1.0 + std::exp(-x));
+}
+
+struct Transformed {
+    Eigen::Vector3d theta;      // (alpha0, alpha1, beta)
+    Eigen::Matrix3d jacobian;   // dtheta / du
+};
+
+Transformed transform(const Eigen::Vector3d& u) {
+    const double p = logistic(u(1));
+    const double q = logistic(u(2));
+    const double dp = p * (1.0 - p);
+    const double dq = q * (1.0 - q);
+    Transformed result;
+    result.theta << std::exp(u(0)), p * q, p * (1.0 - q);
+    result.jacobian << result.theta(0), 0.0, 0.0,
+                       0.0, q * dp, p * dq,
+                       0.0, (1.0 - q) * dp, -p * dq;
+    return result;
+}
+}
+
+GARCHCalibrator::GARCHCalibrator(const Parameters& params)
+    : maxIterations_(params.contains("garchMaxIterations") ? params.get<int>("garchMaxIterations") : 200),
+      tolerance_(params.contains("garchTolerance") ? params.get<double>("garchTolerance") : 1e-8) {}
+
+double GARCHCalibrator::log_likelihood(const Eigen::Ref<const Eigen::VectorXd>& squaredResiduals, double alpha0, double alpha1, double beta, Eigen::Vector3d& gradient) {
+    const Eigen::Index n = squaredResiduals.size();
+    const double* e2 = squaredResiduals.data();
+    double h = squaredResiduals.mean();
+    double dh0 = 0.0, dh1 = 0.0, dh2 = 0.0;
+    double sum = 0.0;
+    double g0 = 0.0, g1 = 0.0, g2 = 0.0;
+    for (Eigen::Index t = 0; t < n; ++t) {
+        if (t > 0) {
+            // 先更新导数（用到h_{t-1}），再更新h
+            dh0 = 1.0 + beta * dh0;
+            dh1 = e2[t - 1] + beta * dh1;
+            dh2 = h + beta * dh2;
+            h = alpha0 + alpha1 * e2[t - 1] + beta * h;
+        }
+        const double inverse = 1.0 / h;
+        const double weight = inverse - e2[t] * inverse * inverse;
+        sum += std::log(h) + e2[t] * inverse;
+        g0 += weight * dh0;
+        g1 += weight * dh1;
+        g2 += weight * dh2;
+    }
+    gradient << -0.5 * g0, -0.5 * g1, -0.5 * g2;
+    return -0.5 * (n * kLogTwoPi + sum);
+}
+
+GARCHFit GARCHCalibrator::fit(const Eigen::Ref<const Eigen::VectorXd>& returns) const {
+    const Eigen::Index n = returns.size();
+    if (n < 10) {
+        throw std::runtime_error("GARCH calibration requires at least 10 returns");
+    }
+    const Eigen::VectorXd squaredResiduals = (returns.array() - returns.mean()).square().matrix();
+    const double sampleVariance = squaredResiduals.mean();
+    if (!(sampleVariance > 0.0)) {
+        throw std::runtime_error("GARCH calibration requires a series with positive variance");
+    }
+
+    // 目标函数为平均负对数似然（与样本长度无关的尺度），初值alpha1 = 0.05、beta = 0.9、alpha0由无条件方差给出
+    auto objective = [&](const Eigen::Vector3d& u, Eigen::Vector3d& gradientU) {
+        Transformed tr = transform(u);
+        Eigen::Vector3d gradientTheta;
+        double value = -log_likelihood(squaredResiduals, tr.theta(0), tr.theta(1), tr.theta(2), gradientTheta) / n;
+        gradientU = -tr.jacobian.transpose() * gradientTheta / n;
+        return value;
+    };
+    Eigen::Vector3d u(std::log(sampleVariance * 0.05), std::log(0.95 / 0.05), std::log(0.05 / 0.9));
+    Eigen::Vector3d gradient;
+    double value = objective(u, gradient);
+    Eigen::Matrix3d inverseHessian = Eigen::Matrix3d::Identity();
+
+    GARCHFit result;
+    result.converged = false;
+    int iteration = 0;
+    for (; iteration < maxIterations_; ++iteration) {
+        if (gradient.norm() < tolerance_) {
+            result.converged = true;
+            break;
+        }
+        Eigen::Vector3d direction = -inverseHessian * gradient;
+        if (direction.dot(gradient) >= 0.0) {     // 不是下降方向时退回最速下降
+            inverseHessian.setIdentity();
+            direction = -gradient;
+        }
+
+        // 回溯线搜索（Armijo条件）
+        double step = 1.0;
+        Eigen::Vector3d nextU, nextGradient;
+        double nextValue = 0.0;
+        bool accepted = false;
+        for (int k = 0; k < 40; ++k) {
+            nextU = u + step * direction;
+            nextValue = objective(nextU, nextGradient);
+            if (std::isfinite(nextValue) && nextValue <= value + 1e-4 * step * direction.dot(gradient)) {
+                accepted = true;
+                break;
+            }
+            step *= 0.5;
+        }
+        if (!accepted) {
+            result.converged = gradient.norm() < std::sqrt(tolerance_);
+            break;
+        }
+
+        // BFGS更新
+        const Eigen::Vector3d s = nextU - u;
+        const Eigen::Vector3d y = nextGradient - gradient;
+        const double sy = s.dot(y);
+        if (sy > 1e-12) {
+            if (iteration == 0) {      // 第一步之后按曲率重新缩放初始的单位阵（Shanno-Phua）
+                inverseHessian *= sy / y.squaredNorm();
+            }
+            const double rho = 1.0 / sy;
+            const Eigen::Matrix3d I = Eigen::Matrix3d::Identity();
+            inverseHessian = (I - rho * s * y.transpose()) * inverseHessian * (I - rho * y * s.transpose()) + rho * s * s.transpose();
+        }
+        const bool stalled = std::abs(value - nextValue) <= 1e-15 * (1.0 + std::abs(value));
+        u = nextU;
+        value = nextValue;
+        gradient = nextGradient;
+        if (stalled) {     // 目标函数的变化已经到了双精度的舍入水平
+            result.converged = true;
+            ++iteration;
+            break;
+        }
+    }
+
+    Transformed tr = transform(u);
+    result.alpha0 = tr.theta(0);
+    result.alpha1 = tr.theta(1);
+    result.beta = tr.theta(2);
+    result.logLikelihood = -value * n;
+    result.iterations = iteration;
+
+    // 样本末尾之后一期的条件方差
+    double h = sampleVariance;
+    for (Eigen::Index t = 1; t <= n; ++t) {
+        h = result.alpha0 + result.alpha1 * squaredResiduals(t - 1) + result.beta * h;
+    }
+    result.nextVolatility = std::sqrt(h);
+    return result;
+}
+
+void GARCHCalibrator::fit_all(const std::vector<std::string>& names, const std::vector<Eigen::VectorXd>& returns, std::unordered_map<std::string, Parameters>& results) const {
+    if (names.size() != returns.size()) {
+        throw std::runtime_error("GARCHCalibrator::fit_all: names and return series differ in length");
+    }
+    // 先在主线程建立所有条目，并行阶段每个任务只写自己的Parameters，map本身不再改变
+    std::vector<Parameters*> targets(names.size());
+    std::unordered_map<std::string, size_t> seen;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (!seen.emplace(names[i], i).second) {
+            throw std::runtime_error("GARCHCalibrator::fit_all: duplicate name " + names[i]);
+        }
+        targets[i] = &results[names[i]];
+    }
+
+    TaskScheduler::instance().parallel_for(0, static_cast<long>(names.size()), 1, [&](long i) {
+        GARCHFit fitted = fit(returns[i]);
+        Parameters& target = *targets[i];
+        target.set<double>("alpha0_GARCHM", fitted.alpha0);
+        target.set<double>("alpha1_GARCHM", fitted.alpha1);
+        target.set<double>("beta_GARCHM", fitted.beta);
+        target.set<double>("volatility", fitted.nextVolatility);
+        target.set<double>("garchLogLikelihood", fitted.logLikelihood);
+        target.set<bool>("garchConverged", fitted.converged);
+    });
+}
@@ -25,23 +25,55 @@
 
 # include "HedgeStrategy.hpp"
 
+void HedgeStrategy::hedgeColumn(const Eigen::Ref<const Eigen::ArrayXd>& spots, const Eigen::Ref<const Eigen::ArrayXd>& optionPrices,
+                                const Eigen::Ref<const Eigen::ArrayXd>& deltas, const Eigen::Ref<const Eigen::ArrayXd>& gammas,
+                                Eigen::Ref<Eigen::ArrayXd> hedges) const {
+    for (Eigen::Index i = 0; i < spots.size(); ++i) {
+        hedges(i) = hedge(spots(i), optionPrices(i), deltas(i), gammas(i));
+    }
+}
+
 // Delta对冲策略的实现
 double DeltaHedge::hedge(double spotPrice, double optionPrice, double delta, double gamma) const {
     return -delta * spotPrice;
 }
 
+void DeltaHedge::hedgeColumn(const Eigen::Ref<const Eigen::ArrayXd>& spots, const Eigen::Ref<const Eigen::ArrayXd>& /*optionPrices*/,
+                             const Eigen::Ref<const Eigen::ArrayXd>& deltas, const Eigen::Ref<const Eigen::ArrayXd>& /*gammas*/,
+                             Eigen::Ref<Eigen::ArrayXd> hedges) const {
+    hedges = -deltas * spots;
+}
+
 // Delta-Gamma对冲策略的实现
 double DeltaGammaHedge::hedge(double spotPrice, double optionPrice, double delta, double gamma) const {
     return -delta * spotPrice - 0.5 * gamma * spotPrice * spotPrice;
 }
 
+void DeltaGammaHedge::hedgeColumn(const Eigen::Ref<const Eigen::ArrayXd>& spots, const Eigen::Ref<const Eigen::ArrayXd>& /*optionPrices*/,
+                                  const Eigen::Ref<const Eigen::ArrayXd>& deltas, const Eigen::Ref<const Eigen::ArrayXd>& gammas,
+                                  Eigen::Ref<Eigen::ArrayXd> hedges) const {
+    hedges = -deltas * spots - 0.5 * gammas * spots.square();
+}
+
 // 本地对冲策略的实现
 double LocalHedge::hedge(double spotPrice, double optionPrice, double delta, double gamma) const {
     return -delta * spotPrice - gamma * spotPrice * spotPrice;
 }
 
+void LocalHedge::hedgeColumn(const Eigen::Ref<const Eigen::ArrayXd>& spots, const Eigen::Ref<const Eigen::ArrayXd>& /*optionPrices*/,
+                             const Eigen::Ref<const Eigen::ArrayXd>& deltas, const Eigen::Ref<const Eigen::ArrayXd>& gammas,
+                             Eigen::Ref<Eigen::ArrayXd> hedges) const {
+    hedges = -deltas * spots - gammas * spots.square();
+}
+
 // 动态对冲策略的实现
 double DynamicHedge::hedge(double spotPrice, double optionPrice, double delta, double gamma) const {
     // 这里我们可以实现更加复杂的动态对冲策略
     return -delta * spotPrice - 0.5 * gamma * spotPrice * spotPrice + 0.1 * (optionPrice - spotPrice);
 }
+
+void DynamicHedge::hedgeColumn(const Eigen::Ref<const Eigen::ArrayXd>& spots, const Eigen::Ref<const Eigen::ArrayXd>& optionPrices,
+                               const Eigen::Ref<const Eigen::ArrayXd>& deltas, const Eigen::Ref<const Eigen::ArrayXd>& gammas,
+                               Eigen::Ref<Eigen::ArrayXd> hedges) const {
+    hedges = -deltas * spots - 0.5 * gammas * spots.square() + 0.1 * (optionPrices - spots);
+}
@@ -0,0 +1,145 @@
+//
+//  HedgingBacktest.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 对冲组合 = optionPosition份期权 + shares份标的 + cash。HedgeStrategy::hedge给出每单位多头期权对应的标的头寸价值，
+// 目标持股数 = optionPosition * hedge / S。交易量按金额（持股变化 * S）传给TransactionCost。
+// 对冲者用Black-Scholes计算价格和Greeks，利率为参数rate，波动率为hedgeVolatility或者当前路径上的波动率；
+// 现金按模拟的短期利率路径计息，所以随机利率、随机波动率模型下的盈亏包含模型误差。
+
+# include "HedgingBacktest.hpp"
+# include "HedgeStrategy.hpp"
+# include "MonteCarloSimulator.hpp"
+# include "PricingModel.hpp"
+# include "Payoff.hpp"
+# include "TransactionCost.hpp"
+# include "BlackScholes.hpp"
+# include "TaskScheduler.hpp"
+# include <random>
+# include <cmath>
+# include <algorithm>
+# include <stdexcept>
+
+namespace {
+const double kQuantileLevels[] = {0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99};
+}
+
+HedgingBacktest::HedgingBacktest(const PricingModel& pricingModel, const HedgeStrategy& strategy, const Parameters& params)
+    : pricingModel_(pricingModel), strategy_(strategy), params_(params),
+      numPaths_(params.contains("hedgePaths") ? params.get<int>("hedgePaths") : 10000),
+      hedgeInterval_(params.contains("hedgeInterval") ? params.get<int>("hedgeInterval") : 1),
+      hedgeThreshold_(params.contains("hedgeThreshold") ? params.get<double>("hedgeThreshold") : 0.0),
+      optionPosition_(params.contains("hedgeOptionPosition") ? params.get<double>("hedgeOptionPosition") : -1.0) {
+    const Payoff& payoff = pricingModel.getPayoff();
+    if (dynamic_cast<const EuropeanCallPayoff*>(&payoff) != nullptr) {
+        isCall_ = true;
+    } else if (dynamic_cast<const EuropeanPutPayoff*>(&payoff) != nullptr) {
+        isCall_ = false;
+    } else {
+        throw std::runtime_error("HedgingBacktest needs closed-form Greeks: payoff must be EuropeanCallPayoff or EuropeanPutPayoff");
+    }
+    if (numPaths_ < 1 || hedgeInterval_ < 1) {
+        throw std::runtime_error("HedgingBacktest requires hedgePaths >= 1 and hedgeInterval >= 1");
+    }
+    if (!params_.contains("seed")) {
+        std::random_device rd;
+        params_.set<int>("seed", static_cast<int>(rd() >> 1));
+    }
+}
+
+void HedgingBacktest::backtest_block(unsigned int blockSeed, Eigen::Ref<Eigen::VectorXd> pnl, Eigen::Ref<Eigen::VectorXd> rebalances, Eigen::Ref<Eigen::VectorXd> costs) const {
+    Parameters blockParams = params_;
+    blockParams.set<int>("seed", static_cast<int>(blockSeed >> 1));
+    MonteCarloSimulator simulator(blockParams, pricingModel_);
+    simulator.generate_paths();
+    const Eigen::MatrixXd& spots = simulator.get_price_paths();
+    const Eigen::MatrixXd& rates = simulator.get_rate_paths();
+    const Eigen::MatrixXd& volatilities = simulator.get_volatility_paths();
+
+    const long numPaths = spots.rows();
+    const int numSteps = static_cast<int>(spots.cols()) - 1;
+    const double dt = params_.get<double>("dt");
+    const double strike = params_.get<double>("strike");
+    const double hedgeRate = params_.get<double>("rate");
+    const bool fixedVolatility = params_.contains("hedgeVolatility");
+    const Eigen::ArrayXd hedgeVolatility = Eigen::ArrayXd::Constant(numPaths, fixedVolatility ? params_.get<double>("hedgeVolatility") : 0.0);
+    const TransactionCost& transactionCost = pricingModel_.getTransactionCost();
+
+    Eigen::ArrayXd prices(numPaths), deltas(numPaths), gammas(numPaths), hedges(numPaths), trades(numPaths), stepCosts(numPaths);
+    Eigen::ArrayXd shares = Eigen::ArrayXd::Zero(numPaths);
+    Eigen::ArrayXd cash = Eigen::ArrayXd::Zero(numPaths);
+    Eigen::ArrayXd totalCosts = Eigen::ArrayXd::Zero(numPaths);
+    Eigen::ArrayXd numRebalances = Eigen::ArrayXd::Zero(numPaths);
+
+    for (int j = 0; j < numSteps; ++j) {
+        if (j % hedgeInterval_ == 0) {
+            const auto S = spots.col(j).array();
+            const double remaining = (numSteps - j) * dt;
+            if (fixedVolatility) {
+                BlackScholes::greeks(isCall_, S, strike, hedgeRate, hedgeVolatility, remaining, prices, deltas, gammas);
+            } else {
+                BlackScholes::greeks(isCall_, S, strike, hedgeRate, volatilities.col(j).array(), remaining, prices, deltas, gammas);
+            }
+            if (j == 0) {
+                cash = -optionPosition_ * prices;   // 期初按模型价格买入（optionPosition < 0时为卖出收到权利金）
+            }
+            strategy_.hedgeColumn(S, prices, deltas, gammas, hedges);
+            trades = optionPosition_ * hedges / S - shares;
+            if (hedgeThreshold_ > 0.0) {
+                trades = (trades.abs() > hedgeThreshold_).select(trades, 0.0);
+            }
+            transactionCost.getCostColumn(trades * S, stepCosts);
+            cash -= trades * S + stepCosts;
+            shares += trades;
+            totalCosts += stepCosts;
+            numRebalances += (trades != 0.0).cast<double>();
+        }
+        cash *= (rates.col(j).array() * dt).exp();
+    }
+
+    Eigen::VectorXd payoffs(numPaths);
+    pricingModel_.getPayoff().evaluate(blockParams, spots, payoffs);
+    // 最后一个路径块只取前面需要的路径数
+    const Eigen::Index used = pnl.size();
+    pnl = (cash + shares * spots.col(numSteps).array() + optionPosition_ * payoffs.array()).head(used).matrix();
+    rebalances = numRebalances.head(used).matrix();
+    costs = totalCosts.head(used).matrix();
+}
+
+HedgingReport HedgingBacktest::run() const {
+    const long numBlocks = (numPaths_ + MonteCarloSimulator::kBlockPaths - 1) / MonteCarloSimulator::kBlockPaths;
+    const long totalPaths = numPaths_;
+    Eigen::VectorXd pnl(totalPaths), rebalances(totalPaths), costs(totalPaths);
+
+    // 块的种子由(seed, 块序号)确定，结果与线程数无关
+    std::vector<unsigned int> blockSeeds(numBlocks);
+    std::seed_seq seq{static_cast<unsigned int>(params_.get<int>("seed"))};
+    seq.generate(blockSeeds.begin(), blockSeeds.end());
+
+    TaskScheduler::instance().parallel_for(0, numBlocks, 1, [&](long b) {
+        const long size = std::min(MonteCarloSimulator::kBlockPaths, totalPaths - b * MonteCarloSimulator::kBlockPaths);
+        backtest_block(blockSeeds[b], pnl.segment(b * MonteCarloSimulator::kBlockPaths, size), rebalances.segment(b * MonteCarloSimulator::kBlockPaths, size), costs.segment(b * MonteCarloSimulator::kBlockPaths, size));
+    });
+
+    HedgingReport report;
+    report.numPaths = totalPaths;
+    report.premium = BlackScholes::price(isCall_, params_.get<double>("spot"), params_.get<double>("strike"), params_.get<double>("rate"),
+                                         params_.contains("hedgeVolatility") ? params_.get<double>("hedgeVolatility") : params_.get<double>("volatility"),
+                                         params_.get<double>("numSteps") * params_.get<double>("dt"));
+    report.mean = pnl.mean();
+    report.stdev = std::sqrt((pnl.array() - report.mean).square().sum() / (totalPaths - 1));
+    report.averageRebalances = rebalances.mean();
+    report.averageCost = costs.mean();
+
+    std::vector<double> sorted(pnl.data(), pnl.data() + totalPaths);
+    std::sort(sorted.begin(), sorted.end());
+    for (double level : kQuantileLevels) {
+        // 经验分位数取第ceil(p * N)个样本
+        long index = std::min(totalPaths - 1, std::max(0L, static_cast<long>(std::ceil(level * totalPaths)) - 1));
+        report.quantiles.emplace_back(level, sorted[index]);
+    }
+    report.pnl = pnl;
+    return report;
+}
@@ -10,6 +10,135 @@
 // 由于虚值期权的成本较低，期权价格对St敏感性（Delta的绝对值低于实值期权）一般更低，杠杆效应高。同时，虚值期权对IV更加敏感（Vega更高），
 
 #include "ImpliedVolatility.hpp"
+#include "Parameters.hpp"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+// SABR：dF = alpha_t * F^beta dW1，d alpha = nu * alpha dW2，dW1 dW2 = rho dt。
+// Hagan: sigma(K) = alpha / ((FK)^((1-beta)/2) * (1 + (1-beta)^2/24 l^2 + (1-beta)^4/1920 l^4)) * z / x(z) * (1 + corr * T)，
+//   l = ln(F/K)，z = nu / alpha * (FK)^((1-beta)/2) * l，x(z) = ln((sqrt(1 - 2 rho z + z^2) + z - rho) / (1 - rho))，
+//   corr = (1-beta)^2/24 * alpha^2 / (FK)^(1-beta) + rho * beta * nu * alpha / (4 (FK)^((1-beta)/2)) + (2 - 3 rho^2) / 24 * nu^2
+// Obloj: 首项换成 nu * l / x(z)，z = nu / alpha * (F^(1-beta) - K^(1-beta)) / (1-beta)，修正项不变。
+// 整个切片用Eigen数组表达式计算，log、exp、sqrt都走SIMD；平值附近的0/0用select换成级数展开，没有逐个元素的分支
+namespace {
+const double kAtmThreshold = 1e-6;
+
+// z / x(z)，|z|很小时用1 - rho * z / 2
+Eigen::ArrayXd z_over_x(const Eigen::ArrayXd& z, double rho) {
+    const Eigen::ArrayXd x = (((1.0 - 2.0 * rho * z + z.square()).sqrt() + z - rho) / (1.0 - rho)).log();
+    return (z.abs() < kAtmThreshold).select(1.0 - 0.5 * rho * z, z / x);
+}
+}
+
+void SABRImpliedVolatility::implied_volatility(double forward, double maturity, const Parameters& params, const Eigen::Ref<const Eigen::ArrayXd>& strikes, Eigen::Ref<Eigen::ArrayXd> volatilities, SABRExpansion expansion) {
+    implied_volatility(forward, maturity, params.get<double>("alpha_SABRM"), params.get<double>("beta_SABRM"), params.get<double>("rho_SABRM"), params.get<double>("nu_SABRM"), strikes, volatilities, expansion);
+}
+
+void SABRImpliedVolatility::implied_volatility(double forward, double maturity, double alpha, double beta, double rho, double nu, const Eigen::Ref<const Eigen::ArrayXd>& strikes, Eigen::Ref<Eigen::ArrayXd> volatilities, SABRExpansion expansion) {
+    const double oneMinusBeta = 1.0 - beta;
+    const Eigen::ArrayXd logMoneyness = (forward / strikes).log();
+    const Eigen::ArrayXd logFK = std::log(forward) + strikes.log();
+    const Eigen::ArrayXd fkHalf = (0.5 * oneMinusBeta * logFK).exp();                   // (FK)^((1-beta)/2)
+    const Eigen::ArrayXd l2 = logMoneyness.square();
+    const Eigen::ArrayXd haganDenominator = fkHalf * (1.0 + oneMinusBeta * oneMinusBeta / 24.0 * l2 + std::pow(oneMinusBeta, 4) / 1920.0 * l2.square());
+
+    const Eigen::ArrayXd correction = 1.0 + maturity * (oneMinusBeta * oneMinusBeta / 24.0 * alpha * alpha / fkHalf.square()
+                                                        + 0.25 * rho * beta * nu * alpha / fkHalf
+                                                        + (2.0 - 3.0 * rho * rho) / 24.0 * nu * nu);
+
+    if (expansion == SABRExpansion::Hagan) {
+        const Eigen::ArrayXd z = nu / alpha * fkHalf * logMoneyness;
+        volatilities = alpha / haganDenominator * z_over_x(z, rho) * correction;
+        return;
+    }
+
+    // Obloj：nu * l / x(z) = (nu * l / z) * (z / x(z))，其中nu * l / z = alpha * l * (1-beta) / (F^(1-beta) - K^(1-beta))，
+    // 平值附近它的极限正好是Hagan的alpha / haganDenominator
+    Eigen::ArrayXd z;
+    Eigen::ArrayXd leading;
+    if (std::abs(oneMinusBeta) < 1e-12) {
+        z = nu / alpha * logMoneyness;
+        leading = Eigen::ArrayXd::Constant(strikes.size(), alpha);
+    } else {
+        const Eigen::ArrayXd difference = std::pow(forward, oneMinusBeta) - (oneMinusBeta * strikes.log()).exp();
+        z = nu / alpha * difference / oneMinusBeta;
+        leading = (logMoneyness.abs() < kAtmThreshold).select(alpha / haganDenominator, alpha * logMoneyness * oneMinusBeta / difference);
+    }
+    volatilities = leading * z_over_x(z, rho) * correction;
+}
+
+// 参数变换 alpha = e^a、rho = tanh(b)、nu = e^c 去掉约束；雅可比矩阵用前向差分，每列只需要一次整切片的批量计算
+double SABRImpliedVolatility::calibrate(double forward, double maturity, const Eigen::Ref<const Eigen::ArrayXd>& strikes, const Eigen::Ref<const Eigen::ArrayXd>& marketVolatilities, Parameters& params, SABRExpansion expansion) {
+    const Eigen::Index n = strikes.size();
+    if (n < 3 || marketVolatilities.size() != n) {
+        throw std::runtime_error("SABR calibration requires at least 3 strikes with matching volatilities");
+    }
+    const double beta = params.get<double>("beta_SABRM");
+
+    // 初值：params中已有的参数（例如上一次的校准结果），否则由最接近平值的波动率给出alpha
+    Eigen::Vector3d u;
+    if (params.contains("alpha_SABRM") && params.contains("rho_SABRM") && params.contains("nu_SABRM")) {
+        u << std::log(params.get<double>("alpha_SABRM")), std::atanh(std::max(-0.99, std::min(0.99, params.get<double>("rho_SABRM")))), std::log(params.get<double>("nu_SABRM"));
+    } else {
+        Eigen::Index atm;
+        (strikes / forward).log().abs().minCoeff(&atm);
+        u << std::log(marketVolatilities(atm) * std::pow(forward, 1.0 - beta)), 0.0, std::log(0.5);
+    }
+
+    Eigen::ArrayXd model(n), shifted(n);
+    auto residuals = [&](const Eigen::Vector3d& v, Eigen::ArrayXd& out) {
+        implied_volatility(forward, maturity, std::exp(v(0)), beta, std::tanh(v(1)), std::exp(v(2)), strikes, out, expansion);
+        out -= marketVolatilities;
+        return out.matrix().squaredNorm();
+    };
+
+    double cost = residuals(u, model);
+    double lambda = 1e-3;
+    Eigen::MatrixXd jacobian(n, 3);
+    for (int iteration = 0; iteration < 100; ++iteration) {
+        for (int k = 0; k < 3; ++k) {
+            Eigen::Vector3d bumped = u;
+            const double h = 1e-7 * std::max(1.0, std::abs(u(k)));
+            bumped(k) += h;
+            residuals(bumped, shifted);
+            jacobian.col(k) = ((shifted - model) / h).matrix();
+        }
+        const Eigen::Matrix3d JtJ = jacobian.transpose() * jacobian;
+        const Eigen::Vector3d gradient = jacobian.transpose() * model.matrix();
+        if (gradient.lpNorm<Eigen::Infinity>() < 1e-14) {
+            break;
+        }
+
+        bool improved = false;
+        while (lambda < 1e10) {
+            Eigen::Matrix3d damped = JtJ;
+            damped.diagonal() += lambda * JtJ.diagonal().cwiseMax(1e-12);
+            const Eigen::Vector3d step = damped.ldlt().solve(-gradient);
+            Eigen::Vector3d candidate = u + step;
+            candidate(1) = std::max(-5.0, std::min(5.0, candidate(1)));       // |rho| < 0.9999
+            const double candidateCost = residuals(candidate, shifted);
+            if (std::isfinite(candidateCost) && candidateCost < cost) {
+                const bool small = cost - candidateCost <= 1e-12 * cost;
+                u = candidate;
+                cost = candidateCost;
+                model.swap(shifted);
+                lambda = std::max(lambda * 0.3, 1e-12);
+                improved = !small;
+                break;
+            }
+            lambda *= 10.0;
+        }
+        if (!improved) {
+            break;
+        }
+    }
+
+    params.set<double>("alpha_SABRM", std::exp(u(0)));
+    params.set<double>("rho_SABRM", std::tanh(u(1)));
+    params.set<double>("nu_SABRM", std::exp(u(2)));
+    return std::sqrt(cost / n);
+}
 
 
 
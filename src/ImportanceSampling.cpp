@@ -0,0 +1,108 @@
+//
+//  ImportanceSampling.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// Girsanov：模拟时令dW' = dW + theta * dt，等价于在测度Q下采样，W_T' ~ N(theta * T, T)。
+// 每条路径乘上似然比 L = dP/dQ = exp(-theta * W_T' + 0.5 * theta^2 * T)，估计量仍然无偏。
+// theta的选择：估计量的二阶矩 m(theta) = E_P[f^2 * L_theta] 是theta的凸函数。在theta0下试算得到样本(f_i, x_i = W_T')，
+// 换测度后 m(theta) ≈ mean(f_i^2 * L_theta0(x_i) * exp(-theta * x_i + 0.5 * theta^2 * T))。
+// 对log m求导：d/dtheta = theta * T - E_p[x]，二阶导 = T + Var_p[x]，其中p_i正比于f_i^2 * L_theta0 * exp(-theta * x_i)，牛顿法几步即可收敛。
+// 可选参数：isPilotPaths（试算路径数，默认2000）
+
+# include "ImportanceSampling.hpp"
+# include "MonteCarloSimulator.hpp"
+# include "PricingModel.hpp"
+# include "Payoff.hpp"
+# include "Parameters.hpp"
+# include "Pricing.hpp"
+# include <cmath>
+# include <vector>
+# include <string>
+# include <limits>
+# include <algorithm>
+
+namespace {
+// 敲入障碍期权中离spot最近的障碍：单障碍为barrier，双障碍取upperBarrier和lowerBarrier中对数距离较近的一个，
+// 分段障碍取第一段的水平（最先起作用的障碍）
+double nearest_barrier(const Parameters& params) {
+    const double spot = params.get<double>("spot");
+    const bool hasSchedule = params.contains("barrierScheduleTimes");
+    if (params.contains("upperBarrier") || params.contains("upperBarrierScheduleLevels")) {
+        double upper = hasSchedule ? params.getRef<std::vector<double>>("upperBarrierScheduleLevels").at(0) : params.get<double>("upperBarrier");
+        double lower = hasSchedule ? params.getRef<std::vector<double>>("lowerBarrierScheduleLevels").at(0) : params.get<double>("lowerBarrier");
+        return std::abs(std::log(upper / spot)) <= std::abs(std::log(lower / spot)) ? upper : lower;
+    }
+    return hasSchedule ? params.getRef<std::vector<double>>("barrierScheduleLevels").at(0) : params.get<double>("barrier");
+}
+}
+
+double ImportanceSampling::initial_drift(const PricingModel& pricingModel, const Parameters& params) {
+    double target = params.get<double>("strike");
+    if (pricingModel.getPayoff().getName() == "BarrierPayoff") {
+        bool isKnockIn = (params.contains("isUpIn") && params.get<bool>("isUpIn")) || (params.contains("isDownIn") && params.get<bool>("isDownIn"));
+        if (isKnockIn) {
+            target = nearest_barrier(params);
+        }
+    }
+    double sigma = params.get<double>("volatility");
+    double maturity = params.get<double>("numSteps") * params.get<double>("dt");
+    double drift = (params.get<double>("rate") - 0.5 * sigma * sigma) * maturity;
+    // 令 log(S0) + drift + sigma * theta * T = log(target)
+    return (std::log(target / params.get<double>("spot")) - drift) / (sigma * maturity);
+}
+
+double ImportanceSampling::optimal_drift(const PricingModel& pricingModel, const Parameters& params) {
+    const double theta0 = initial_drift(pricingModel, params);
+    const int pilotPaths = params.contains("isPilotPaths") ? params.get<int>("isPilotPaths") : 2000;
+    const double maturity = params.get<double>("numSteps") * params.get<double>("dt");
+
+    // 试算：保存每条路径的log(f^2 * L_theta0)与W_T'
+    std::vector<double> logWeights;
+    std::vector<double> terminal;
+    Parameters local_params = params;
+    MonteCarloSimulator simulator(local_params, pricingModel);
+    simulator.set_drift_shift(theta0);
+    for (int done = 0; done < pilotPaths; ) {
+        simulator.generate_paths();
+        Eigen::VectorXd payoffs = pricingModel.getPayoff()(local_params, simulator.get_price_paths());
+        payoffs = payoffs.array() * Pricing::calculate_discount_factors(simulator, pricingModel.getRateModel(), local_params.get<double>("dt")).array();
+        const Eigen::VectorXd& ratios = simulator.get_likelihood_ratios();
+        const Eigen::VectorXd& brownian = simulator.get_terminal_brownian();
+        for (Eigen::Index i = 0; i < payoffs.size(); ++i) {
+            if (payoffs(i) != 0.0) {
+                logWeights.push_back(2.0 * std::log(std::abs(payoffs(i))) + std::log(ratios(i)));
+                terminal.push_back(brownian(i));
+            }
+        }
+        done += static_cast<int>(payoffs.size());
+    }
+    if (terminal.size() < 2) {
+        return theta0;      // 试算中几乎没有支付，无法估计二阶矩，直接使用起点
+    }
+
+    double theta = theta0;
+    for (int iter = 0; iter < 50; ++iter) {
+        // p_i正比于exp(logWeights_i - theta * x_i)，先减去最大值避免溢出
+        double maxLog = -std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < terminal.size(); ++i) {
+            maxLog = std::max(maxLog, logWeights[i] - theta * terminal[i]);
+        }
+        double sumP = 0.0, sumPX = 0.0, sumPX2 = 0.0;
+        for (size_t i = 0; i < terminal.size(); ++i) {
+            double p = std::exp(logWeights[i] - theta * terminal[i] - maxLog);
+            sumP += p;
+            sumPX += p * terminal[i];
+            sumPX2 += p * terminal[i] * terminal[i];
+        }
+        double meanX = sumPX / sumP;
+        double varX = std::max(0.0, sumPX2 / sumP - meanX * meanX);
+        double step = (theta * maturity - meanX) / (maturity + varX);
+        theta -= step;
+        if (std::abs(step) < 1e-8) {
+            break;
+        }
+    }
+    return theta;
+}
@@ -22,13 +22,24 @@ void ModelParams::initialize() {
     // 增加每个名称对应什么模型以及每个变量代表什么的注释
     modelParams["ConstantRateModel"] = {"rate"};
     modelParams["HullWhiteModel"] = {"rate", "a_HWM", "sigma_HWM", "dt"};
+    modelParams["VasicekModel"] = {"rate", "kappa_VM", "theta_VM", "sigma_VM", "dt"};
+    modelParams["CIRModel"] = {"rate", "kappa_CIRM", "theta_CIRM", "sigma_CIRM", "dt"};
     modelParams["GeometricBrownianMotionModel"] = {"spot", "dt"};
     modelParams["JumpDiffusionPriceModel"] = {"spot", "dt", "jumpVol_JDPM", "jumpMean_JDPM"};
     modelParams["ConstantVolatilityModel"] = {"volatility"};
+    modelParams["LocalVolatilityModel"] = {"spot", "rate", "impliedVolStrikes", "impliedVolMaturities", "impliedVolGrid", "dt"};
     modelParams["HestonModel"] = {"volatility", "kappa_HM", "theta_HM", "xi_HM", "rho_HM", "dt"};
     modelParams["SABRModel"] = {"alpha_SABRM", "beta_SABRM", "rho_SABRM", "nu_SABRM","dt"};
     modelParams["GARCHModel"] = {"alpha0_GARCHM", "alpha1_GARCHM", "beta_GARCHM", "volatility", "dt"};
     modelParams["JumpDiffusionModel"] = {"volatility", "jumpMean_JDM", "jumpVol_JDM", "dt"};
+    // Payoff需要的参数。BarrierPayoff的payoff为内层的普通期权类型（EuropeanCallPayoff或EuropeanPutPayoff）
+    modelParams["EuropeanCallPayoff"] = {"strike"};
+    modelParams["EuropeanPutPayoff"] = {"strike"};
+    // 障碍水平可以是barrier、upperBarrier/lowerBarrier或者分段常数的schedule，由BarrierPayoff自己检查。
+    // dt和volatility只有布朗桥修正才需要，在checkParams中按barrierDiscrete、barrierVolatility检查
+    modelParams["BarrierPayoff"] = {"payoff", "isUpIn", "isDownOut", "isUpOut", "isDownIn", "strike"};
+    modelParams["AsianPayoff"] = {"strike"};
+    modelParams["LookbackPayoff"] = {"strike"};
 }
 
 std::vector<std::string> ModelParams::getAvailableModels() const {
@@ -59,5 +70,15 @@ std::vector<std::string> ModelParams::checkParams(const std::string& modelName,
             missingParams.push_back(param);
         }
     }
+    if (modelName == "BarrierPayoff") {
+        // 连续监测时用布朗桥修正，需要dt和波动率（barrierVolatility优先）；分段障碍按dt定位时间段
+        const bool discrete = params.contains("barrierDiscrete") && params.get<bool>("barrierDiscrete");
+        if ((!discrete || params.contains("barrierScheduleTimes")) && !params.contains("dt")) {
+            missingParams.push_back("dt");
+        }
+        if (!discrete && !params.contains("barrierVolatility") && !params.contains("volatility")) {
+            missingParams.push_back("volatility");
+        }
+    }
     return missingParams;
 }
@@ -29,85 +29,277 @@
 # include "VolatilityModel.hpp"
 # include "AssetPriceModel.hpp"
 # include "Parameters.hpp"
+# include "SamplingStrategy.hpp"
+# include "Arena.hpp"
+# include "YieldCurve.hpp"
+# include "RandomPipeline.hpp"
 # include <random>
 # include <iostream>
 # include <functional>
 # include <algorithm>
 
 MonteCarloSimulator::MonteCarloSimulator(const Parameters& params, const PricingModel& pricingModel)
-    : params_(params), pricingModel_(pricingModel), numSteps_(params.get<double>("numSteps")) {
-    pricePaths_.resize(200, numSteps_ + 1);
-    ratePaths_.resize(200, numSteps_ + 1);
-    volatilityPaths_.resize(200, numSteps_ + 1);
+    : params_(params), pricingModel_(pricingModel), numSteps_(params.get<double>("numSteps")), driftShift_(0.0), samplingStrategy_(nullptr),
+      rng_(params.contains("seed") ? static_cast<std::uint32_t>(params.get<int>("seed")) : std::random_device()()),
+      floatPaths_(params.contains("floatPaths") && params.get<bool>("floatPaths")) {
+    // 随机数流水线：rngPipeline为interleaved（默认）、async或off；rngChunkSteps为每段的时间步数，默认让一个槽位约64KB
+    const std::string pipeline = params.contains("rngPipeline") ? params.get<std::string>("rngPipeline") : "interleaved";
+    if (pipeline == "interleaved") {
+        pipeline_ = std::make_unique<RandomPipeline>(RandomPipeline::Mode::Interleaved, 1);
+    } else if (pipeline == "async") {
+        pipeline_ = std::make_unique<RandomPipeline>(RandomPipeline::Mode::Async, 3);
+    } else if (pipeline != "off") {
+        throw std::runtime_error("Unknown rngPipeline: " + pipeline);
+    }
+    const int numDrivers = pricingModel.getRateModel().hasIntegratedRate() ? 4 : 3;
+    chunkSteps_ = params.contains("rngChunkSteps") ? params.get<int>("rngChunkSteps") : std::max(1, static_cast<int>(8192 / (kBlockPaths * numDrivers)));
+    if (chunkSteps_ < 1) {
+        throw std::runtime_error("rngChunkSteps must be positive");
+    }
+    // 单精度模式只用于有闭式对数步长的模型，其他模型仍逐元素调用各自的模型
+    if (floatPaths_ && (dynamic_cast<const GeometricBrownianMotionModel*>(&pricingModel.getAssetPriceModel()) == nullptr
+                        || dynamic_cast<const ConstantVolatilityModel*>(&pricingModel.getVolatilityModel()) == nullptr
+                        || !pricingModel.getRateModel().isDeterministic() || pricingModel.getRateModel().hasIntegratedRate())) {
+        throw std::runtime_error("floatPaths requires GeometricBrownianMotionModel, ConstantVolatilityModel and a deterministic rate model");
+    }
+    pricePaths_.resize(kBlockPaths, numSteps_ + 1);
+    ratePaths_.resize(kBlockPaths, numSteps_ + 1);
+    volatilityPaths_.resize(kBlockPaths, numSteps_ + 1);
+    // 曲线网格在构造时取一次，之后利率模型每一步按stepIndex查表
+    if (params_.contains("yieldCurve")) {
+        curveGrid_ = params_.get<std::shared_ptr<const YieldCurve>>("yieldCurve")->grid(params_.get<double>("dt"), numSteps_);
+        params_.set<const CurveGrid*>("curveGrid", curveGrid_.get());
+    }
 }
 
-double MonteCarloSimulator::get_random_number() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::normal_distribution<> dis(0.0, 1.0);
-    return dis(gen);
+MonteCarloSimulator::~MonteCarloSimulator() = default;
+
+void MonteCarloSimulator::fill_increments(Eigen::Ref<Eigen::MatrixXd> dw, double sqrt_dt) {
+    rng_.fill_normal(dw);
+    dw *= sqrt_dt;
 }
 
+// dW等临时矩阵都从当前线程的arena中分配，函数返回时整体回退，稳态下每个路径块不再有堆分配。
+// 抽样策略可以逐段生成时（伪随机、对偶变量）走随机数流水线，随机数缓冲区只有几个槽位；分层、拉丁超立方需要整条路径的随机数，仍一次生成
 void MonteCarloSimulator::generate_paths() {
+    static const AntitheticSampling defaultSampling;
+    const SamplingStrategy& sampling = samplingStrategy_ ? *samplingStrategy_ : defaultSampling;
+    if (pipeline_ && sampling.supportsStreaming()) {
+        generate_pipelined_paths(sampling);
+        return;
+    }
+
+    const Eigen::Index numPaths = kBlockPaths;
     double sqrt_dt = std::sqrt(params_.get<double>("dt"));
-    Eigen::MatrixXd random_numbers1 = Eigen::MatrixXd::NullaryExpr(100, numSteps_, [&]() { return get_random_number(); });
-    Eigen::MatrixXd antithetic_numbers1 = -random_numbers1;
-    Eigen::MatrixXd dw_spot(200, numSteps_);
-    dw_spot << sqrt_dt * random_numbers1, sqrt_dt * antithetic_numbers1;
-
-    Eigen::MatrixXd random_numbers2 = Eigen::MatrixXd::NullaryExpr(100, numSteps_, [&]() { return get_random_number(); });
-    Eigen::MatrixXd antithetic_numbers2 = -random_numbers2;
-    Eigen::MatrixXd dw_volatility(200, numSteps_);
-    dw_volatility << sqrt_dt * random_numbers2, sqrt_dt * antithetic_numbers2;
-    
-    Eigen::MatrixXd random_numbers3 = Eigen::MatrixXd::NullaryExpr(100, numSteps_, [&]() { return get_random_number(); });
-    Eigen::MatrixXd antithetic_numbers3 = -random_numbers3;
-    Eigen::MatrixXd dw_rate(200, numSteps_);
-    dw_rate << sqrt_dt * random_numbers3, sqrt_dt * antithetic_numbers3;
-    
-    params_.set<double>("St", params_.get<double>("spot"));
-    params_.set<double>("rt", params_.get<double>("rate"));
-    params_.set<double>("vt", params_.get<double>("volatility"));
-
-    pricePaths_.col(0).setConstant(params_.get<double>("St"));
-    ratePaths_.col(0).setConstant(params_.get<double>("rt"));
-    volatilityPaths_.col(0).setConstant(params_.get<double>("vt"));
-    
-    // 使用矩阵运算更新params_并计算路径
-    for (int col = 1; col <= numSteps_; ++col) {
-        // 获取矩阵的第 col 列和 resultMatrix 的第 col-1 列
-        Eigen::VectorXd prev_price = pricePaths_.col(col - 1);
-        Eigen::VectorXd current_dwprice = dw_spot.col(col - 1);
-
-        // 使用 std::transform 和 lambda 函数计算 simulatePrice 结果并直接存储到结果矩阵中
-        std::transform(prev_price.data(), prev_price.data() + prev_price.size(), current_dwprice.data(), pricePaths_.col(col).data(), [this](double prevspot, double currentspot) {
-            params_.set<double>("St", prevspot); // spot
-            params_.set<double>("dW_spot", currentspot);
-            return pricingModel_.getAssetPriceModel().simulatePrice(params_);
-        });
-
-        Eigen::VectorXd prev_rate = ratePaths_.col(col - 1);
-        Eigen::VectorXd current_dwrate = dw_rate.col(col - 1);
-
-        // 使用 std::transform 和 lambda 函数计算 simulatePrice 结果并直接存储到结果矩阵中
-        std::transform(prev_rate.data(), prev_rate.data() + prev_rate.size(), current_dwrate.data(), ratePaths_.col(col).data(), [this](double prevrate, double currentrate) {
-            params_.set<double>("rt", prevrate); // rate
-            params_.set<double>("dW_rate", currentrate);
-            return pricingModel_.getRateModel().getRate(params_);
-        });
-        
-        Eigen::VectorXd prev_volatility = volatilityPaths_.col(col - 1);
-        Eigen::VectorXd current_dwvolatility = dw_volatility.col(col - 1);
-
-        // 使用 std::transform 和 lambda 函数计算 simulatePrice 结果并直接存储到结果矩阵中
-        std::transform(prev_volatility.data(), prev_volatility.data() + prev_volatility.size(), current_dwvolatility.data(), volatilityPaths_.col(col).data(), [this](double prevvolatility, double currentvolatility) {
-            params_.set<double>("vt", prevvolatility); // volatility
-            params_.set<double>("dW_volatility", currentvolatility);
-            return pricingModel_.getVolatilityModel().getVolatility(params_);
-        });
+
+    Arena& arena = Arena::local();
+    Arena::Scope scope(arena);
+    auto dw_spot = arena.allocate_matrix(numPaths, numSteps_);
+    auto dw_volatility = arena.allocate_matrix(numPaths, numSteps_);
+    auto dw_rate = arena.allocate_matrix(numPaths, numSteps_);
+    samplingWeights_.resize(numPaths);
+    strata_.resize(numPaths);
+
+    sampling.generate(rng_, numPaths, numSteps_, dw_spot, samplingWeights_, strata_);
+    dw_spot *= sqrt_dt;
+    fill_other_drivers(rng_, sampling, dw_volatility, sqrt_dt);
+    fill_other_drivers(rng_, sampling, dw_rate, sqrt_dt);
+
+    generate_paths(dw_spot, dw_volatility, dw_rate);
+    pathWeights_ = samplingWeights_.cwiseProduct(likelihoodRatios_);
+}
+
+// 波动率和利率的驱动不参与分层，只在对偶变量策略下同样取相反数
+void MonteCarloSimulator::fill_other_drivers(RandomNumberGenerator& rng, const SamplingStrategy& sampling, Eigen::Ref<Eigen::MatrixXd> dw, double sqrt_dt) {
+    if (sampling.isAntithetic()) {
+        const Eigen::Index half = dw.rows() / 2;
+        rng.fill_normal(dw.topRows(half));
+        dw.topRows(half) *= sqrt_dt;
+        dw.bottomRows(half) = -dw.topRows(half);
+    } else {
+        rng.fill_normal(dw);
+        dw *= sqrt_dt;
     }
 }
 
+// 每段的随机数来自rng_的一份拷贝，计数器定位到 本块起点 + 段序号 * 每段计数器数，所以生产任务之间互不依赖，结果与流水线模式无关。
+// 槽位中的列依次为：dW_spot、dW_volatility、dW_rate，利率模型需要时再加上dW_rateIntegral，每个驱动chunkSteps_列
+void MonteCarloSimulator::generate_pipelined_paths(const SamplingStrategy& sampling) {
+    const Eigen::Index numPaths = kBlockPaths;
+    const double sqrt_dt = std::sqrt(params_.get<double>("dt"));
+    const bool integrated = pricingModel_.getRateModel().hasIntegratedRate();
+    const Eigen::Index numDrivers = integrated ? 4 : 3;
+    const Eigen::Index chunkSteps = std::min<Eigen::Index>(chunkSteps_, numSteps_);
+    const long numChunks = static_cast<long>((numSteps_ + chunkSteps - 1) / chunkSteps);
+    const std::uint64_t countersPerChunk = numDrivers * RandomNumberGenerator::counters_for(static_cast<std::size_t>(numPaths * chunkSteps));
+    const std::uint64_t base = rng_.getCounter();
+
+    begin_paths(numPaths, numSteps_);
+    auto produce = [&](long chunk, RandomPipeline::Slot& slot) {
+        const Eigen::Index steps = std::min<Eigen::Index>(chunkSteps, numSteps_ - chunk * chunkSteps);
+        RandomNumberGenerator rng = rng_;
+        rng.setCounter(base + chunk * countersPerChunk);
+        auto dw_spot = slot.normals.middleCols(0, steps);
+        sampling.generate(rng, numPaths, steps, dw_spot, slot.weights, slot.strata);
+        dw_spot *= sqrt_dt;
+        for (Eigen::Index driver = 1; driver < numDrivers; ++driver) {
+            auto dw = slot.normals.middleCols(driver * chunkSteps, steps);
+            if (driver == 3) {
+                rng.fill_normal(dw);        // 利率积分的驱动与其他驱动独立，不取对偶
+                dw *= sqrt_dt;
+            } else {
+                fill_other_drivers(rng, sampling, dw, sqrt_dt);
+            }
+        }
+    };
+    auto consume = [&](long chunk, const RandomPipeline::Slot& slot) {
+        const Eigen::Index steps = std::min<Eigen::Index>(chunkSteps, numSteps_ - chunk * chunkSteps);
+        if (chunk == 0) {
+            samplingWeights_ = slot.weights;
+            strata_ = slot.strata;
+        }
+        advance(chunk * chunkSteps, slot.normals.middleCols(0, steps), slot.normals.middleCols(chunkSteps, steps),
+                slot.normals.middleCols(2 * chunkSteps, steps), integrated ? slot.normals.middleCols(3 * chunkSteps, steps) : slot.normals.middleCols(0, 0));
+    };
+    pipeline_->run(numChunks, numPaths, numDrivers * chunkSteps, produce, consume);
+    rng_.setCounter(base + numChunks * countersPerChunk);
+
+    finish_paths(numSteps_);
+    pathWeights_ = samplingWeights_.cwiseProduct(likelihoodRatios_);
+}
+
+void MonteCarloSimulator::generate_paths(const Eigen::Ref<const Eigen::MatrixXd>& dw_spot, const Eigen::Ref<const Eigen::MatrixXd>& dw_volatility, const Eigen::Ref<const Eigen::MatrixXd>& dw_rate) {
+    const Eigen::Index numPaths = dw_spot.rows();
+    const Eigen::Index numSteps = dw_spot.cols();
+    begin_paths(numPaths, numSteps);
+
+    // 利率积分需要一组与dW_rate独立的正态数，由本模拟器的随机数引擎生成（多层蒙特卡罗的粗细路径之间这一项不耦合）
+    const bool integrated = pricingModel_.getRateModel().hasIntegratedRate();
+    Arena& arena = Arena::local();
+    Arena::Scope scope(arena);
+    auto dw_rateIntegral = arena.allocate_matrix(integrated ? numPaths : 0, integrated ? numSteps : 0);
+    if (integrated) {
+        fill_increments(dw_rateIntegral, std::sqrt(params_.get<double>("dt")));
+    }
+
+    advance(0, dw_spot, dw_volatility, dw_rate, dw_rateIntegral);
+    finish_paths(numSteps);
+}
+
+void MonteCarloSimulator::begin_paths(Eigen::Index numPaths, Eigen::Index numSteps) {
+    pricePaths_.resize(numPaths, numSteps + 1);
+    ratePaths_.resize(numPaths, numSteps + 1);
+    volatilityPaths_.resize(numPaths, numSteps + 1);
+
+    pricePaths_.col(0).setConstant(params_.get<double>("spot"));
+    if (curveGrid_ && numSteps > numSteps_) {
+        throw std::runtime_error("Yield curve grid is shorter than the simulated paths");
+    }
+    ratePaths_.col(0).setConstant(curveGrid_ ? curveGrid_->forwardRates(0) : params_.get<double>("rate"));
+    if (pricingModel_.getVolatilityModel().supportsColumnEvaluation()) {
+        pricingModel_.getVolatilityModel().getVolatilityColumn(params_, 0.0, pricePaths_.col(0), volatilityPaths_.col(0));
+    } else {
+        volatilityPaths_.col(0).setConstant(params_.get<double>("volatility"));
+    }
+
+    terminalBrownian_.setZero(numPaths);
+    if (pricingModel_.getRateModel().hasIntegratedRate()) {
+        integratedRatePaths_.resize(numPaths, numSteps);
+    } else {
+        integratedRatePaths_.resize(0, 0);
+    }
+    if (floatPaths_) {
+        logPaths_.resize(numPaths, numSteps + 1);
+        logPaths_.col(0).setZero();
+    }
+}
+
+// 推进第firstStep + 1到firstStep + dw_spot.cols()列，dW的第j列对应第firstStep + j步
+void MonteCarloSimulator::advance(Eigen::Index firstStep, const Eigen::Ref<const Eigen::MatrixXd>& dw_spot, const Eigen::Ref<const Eigen::MatrixXd>& dw_volatility,
+                                  const Eigen::Ref<const Eigen::MatrixXd>& dw_rate, const Eigen::Ref<const Eigen::MatrixXd>& dw_rateIntegral) {
+    const Eigen::Index numPaths = dw_spot.rows();
+    const double shift = driftShift_ * params_.get<double>("dt");
+    terminalBrownian_ += dw_spot.rowwise().sum();
+
+    if (floatPaths_) {
+        advance_float(firstStep, dw_spot, shift);
+        return;
+    }
+
+    const AssetPriceModel& assetModel = pricingModel_.getAssetPriceModel();
+    const RateModel& rateModel = pricingModel_.getRateModel();
+    const VolatilityModel& volModel = pricingModel_.getVolatilityModel();
+    const bool integrated = rateModel.hasIntegratedRate();
+    const bool columnVolatility = volModel.supportsColumnEvaluation();
+
+    // 逐列推进。每条路径的价格一步必须使用该路径自己上一期的rt和vt，否则随机利率、随机波动率模型的路径之间会互相串扰
+    for (Eigen::Index j = 0; j < dw_spot.cols(); ++j) {
+        const Eigen::Index col = firstStep + j + 1;
+        params_.set<int>("stepIndex", static_cast<int>(col - 1));
+        for (Eigen::Index row = 0; row < numPaths; ++row) {
+            params_.set<double>("St", pricePaths_(row, col - 1));
+            params_.set<double>("rt", ratePaths_(row, col - 1));
+            params_.set<double>("vt", volatilityPaths_(row, col - 1));
+            params_.set<double>("dW_spot", dw_spot(row, j) + shift);
+            pricePaths_(row, col) = assetModel.simulatePrice(params_);
+
+            params_.set<double>("dW_rate", dw_rate(row, j));
+            ratePaths_(row, col) = rateModel.getRate(params_);
+            if (integrated) {
+                params_.set<double>("rtNext", ratePaths_(row, col));
+                params_.set<double>("dW_rateIntegral", dw_rateIntegral(row, j));
+                integratedRatePaths_(row, col - 1) = rateModel.getIntegratedRate(params_);
+            }
+
+            if (!columnVolatility) {
+                params_.set<double>("dW_volatility", dw_volatility(row, j));
+                volatilityPaths_(row, col) = volModel.getVolatility(params_);
+            }
+        }
+        // 局部波动率等只依赖(S, t)的模型在整列价格更新后一次算出下一步的波动率
+        if (columnVolatility) {
+            volModel.getVolatilityColumn(params_, col * params_.get<double>("dt"), pricePaths_.col(col), volatilityPaths_.col(col));
+        }
+    }
+}
+
+// 平移后的W_T = sum(dW + theta * dt)，似然比 dP/dQ = exp(-theta * W_T + 0.5 * theta^2 * T)
+void MonteCarloSimulator::finish_paths(Eigen::Index numSteps) {
+    const double shift = driftShift_ * params_.get<double>("dt");
+    const double maturity = numSteps * params_.get<double>("dt");
+    terminalBrownian_.array() += shift * numSteps;
+    likelihoodRatios_ = (-driftShift_ * terminalBrownian_.array() + 0.5 * driftShift_ * driftShift_ * maturity).exp().matrix();
+    pathWeights_ = likelihoodRatios_;
+    if (floatPaths_) {
+        pricePaths_ = params_.get<double>("spot") * logPaths_.array().exp().cast<double>().matrix();
+    }
+}
+
+// 从ln(S / S0) = 0开始累加，而不是ln S：数值量级小，单精度的相对误差也小；每一步的漂移和sigma在双精度下算好后再转为float。
+// 确定性利率对所有路径相同，每列只调用一次利率模型
+void MonteCarloSimulator::advance_float(Eigen::Index firstStep, const Eigen::Ref<const Eigen::MatrixXd>& dw_spot, double shift) {
+    const double dt = params_.get<double>("dt");
+    const double sigma = volatilityPaths_(0, 0);
+    const RateModel& rateModel = pricingModel_.getRateModel();
+    for (Eigen::Index j = 0; j < dw_spot.cols(); ++j) {
+        const Eigen::Index col = firstStep + j + 1;
+        const double rate = ratePaths_(0, col - 1);
+        const float drift = static_cast<float>((rate - 0.5 * sigma * sigma) * dt + sigma * shift);
+        const float volatility = static_cast<float>(sigma);
+        logPaths_.col(col) = (logPaths_.col(col - 1).array() + volatility * dw_spot.col(j).cast<float>().array() + drift).matrix();
+
+        params_.set<int>("stepIndex", static_cast<int>(col - 1));
+        params_.set<double>("rt", rate);
+        params_.set<double>("dW_rate", 0.0);
+        ratePaths_.col(col).setConstant(rateModel.getRate(params_));
+        volatilityPaths_.col(col).setConstant(sigma);
+    }
+}
+
+bool MonteCarloSimulator::uses_float_paths() const {
+    return floatPaths_;
+}
+
 const Eigen::MatrixXd& MonteCarloSimulator::get_price_paths() const {
     return pricePaths_;
 }
@@ -120,6 +312,42 @@ const Eigen::MatrixXd& MonteCarloSimulator::get_volatility_paths() const {
     return volatilityPaths_;
 }
 
+const Eigen::MatrixXd& MonteCarloSimulator::get_integrated_rate_paths() const {
+    return integratedRatePaths_;
+}
+
+void MonteCarloSimulator::set_drift_shift(double theta) {
+    driftShift_ = theta;
+}
+
+const Eigen::VectorXd& MonteCarloSimulator::get_likelihood_ratios() const {
+    return likelihoodRatios_;
+}
+
+const Eigen::VectorXd& MonteCarloSimulator::get_terminal_brownian() const {
+    return terminalBrownian_;
+}
+
+void MonteCarloSimulator::set_sampling_strategy(const SamplingStrategy* strategy) {
+    samplingStrategy_ = strategy;
+}
+
+const Eigen::VectorXd& MonteCarloSimulator::get_path_weights() const {
+    return pathWeights_;
+}
+
+const Eigen::VectorXi& MonteCarloSimulator::get_strata() const {
+    return strata_;
+}
+
+void MonteCarloSimulator::set_random_stream(std::uint64_t seed, std::uint32_t stream) {
+    rng_ = RandomNumberGenerator(seed, stream, rng_.getSimdLevel());
+}
+
+const CurveGrid* MonteCarloSimulator::get_curve_grid() const {
+    return curveGrid_.get();
+}
+
 /*
 
 1. Variance Reduction Techniques
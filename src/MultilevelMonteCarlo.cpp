@@ -0,0 +1,214 @@
+//
+//  MultilevelMonteCarlo.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 思路：E[P_L] = E[P_0] + sum_{l=1..L} E[P_l - P_{l-1}]，其中P_l是时间步数为baseSteps * M^l的离散化定价。
+// 同一层的细路径和粗路径用同一组布朗增量（粗路径的dW是细路径相邻M个dW之和），所以P_l - P_{l-1}的方差随层级迅速变小，
+// 高层只需要很少的样本。目标精度为eps时，成本从标准蒙特卡罗的O(eps^-3)降到接近O(eps^-2)。
+// 每层样本数按照 N_l = 2 / eps^2 * sqrt(V_l / C_l) * sum_k sqrt(V_k * C_k) 分配（V为方差，C为单样本成本）。
+// 偏差用最高层修正量估计（欧拉格式弱收敛阶为1）：|E[Y_L]| / (M - 1) < eps / sqrt(2) 时停止增加层数。
+// 需要的参数：numSteps和dt（共同确定到期时间T）、mlmcTargetRMSE、mlmcBaseSteps、mlmcRefinement、mlmcMaxLevels、mlmcInitialSamples，可选seed和quiet
+
+# include "MultilevelMonteCarlo.hpp"
+# include "MonteCarloSimulator.hpp"
+# include "PricingModel.hpp"
+# include "Payoff.hpp"
+# include "Pricing.hpp"
+# include "TaskScheduler.hpp"
+# include "RandomNumberGenerator.hpp"
+# include <random>
+# include <cmath>
+# include <algorithm>
+# include <iostream>
+
+MultilevelMonteCarlo::MultilevelMonteCarlo(const PricingModel& pricingModel, const Parameters& params)
+    : pricingModel_(pricingModel), params_(params),
+      maturity_(params.get<double>("numSteps") * params.get<double>("dt")),
+      baseSteps_(params.get<int>("mlmcBaseSteps")),
+      refinement_(params.get<int>("mlmcRefinement")),
+      maxLevels_(params.get<int>("mlmcMaxLevels")),
+      initialSamples_(params.get<int>("mlmcInitialSamples")),
+      targetRMSE_(params.get<double>("mlmcTargetRMSE")) {
+    if (refinement_ < 2 || baseSteps_ < 1 || maxLevels_ < 2) {
+        throw std::runtime_error("MLMC requires mlmcRefinement >= 2, mlmcBaseSteps >= 1 and mlmcMaxLevels >= 2");
+    }
+    if (!params_.contains("seed")) {
+        std::random_device rd;
+        params_.set<int>("seed", static_cast<int>(rd() >> 1));
+    }
+}
+
+int MultilevelMonteCarlo::levelSteps(int level) const {
+    int steps = baseSteps_;
+    for (int l = 0; l < level; ++l) {
+        steps *= refinement_;
+    }
+    return steps;
+}
+
+// 单个样本的成本按需要推进的时间步数计算（细路径加粗路径）
+double MultilevelMonteCarlo::levelCost(int level) const {
+    return level == 0 ? levelSteps(0) : levelSteps(level) + levelSteps(level - 1);
+}
+
+void MultilevelMonteCarlo::add_level() {
+    samples_.push_back(0);
+    moments_.emplace_back();
+}
+
+int MultilevelMonteCarlo::getNumLevels() const {
+    return static_cast<int>(samples_.size());
+}
+
+const std::vector<long>& MultilevelMonteCarlo::getLevelSamples() const {
+    return samples_;
+}
+
+double MultilevelMonteCarlo::getLevelMean(int level) const {
+    return moments_[level].result().mean();
+}
+
+double MultilevelMonteCarlo::getLevelVariance(int level) const {
+    return moments_[level].result().variance();
+}
+
+// 一个路径块：生成细网格上的布朗增量，粗网格增量由相邻refinement_个细增量求和得到，两层分别模拟、定价、折现。
+// 模拟器自己抽取的随机数（如利率模型的∫r ds）取自blockSeed的另外两个流，否则所有块都会用params_中同一个seed
+MomentAccumulator MultilevelMonteCarlo::sample_block(int level, long numPaths, unsigned int blockSeed) const {
+    RandomNumberGenerator rng(blockSeed);
+
+    const int fineSteps = levelSteps(level);
+    const double fineDt = maturity_ / fineSteps;
+    const double sqrtDt = std::sqrt(fineDt);
+
+    Eigen::MatrixXd dw_spot(numPaths, fineSteps), dw_volatility(numPaths, fineSteps), dw_rate(numPaths, fineSteps);
+    for (Eigen::MatrixXd* dw : {&dw_spot, &dw_volatility, &dw_rate}) {
+        rng.fill_normal(*dw);
+        *dw *= sqrtDt;
+    }
+
+    Parameters fineParams = params_;
+    fineParams.set<double>("dt", fineDt);
+    fineParams.set<double>("numSteps", fineSteps);
+    MonteCarloSimulator fineSimulator(fineParams, pricingModel_);
+    fineSimulator.set_random_stream(blockSeed, 1);
+    fineSimulator.generate_paths(dw_spot, dw_volatility, dw_rate);
+
+    Eigen::VectorXd fine = pricingModel_.getPayoff()(fineParams, fineSimulator.get_price_paths());
+    fine = fine.array() * Pricing::calculate_discount_factors(fineSimulator, pricingModel_.getRateModel(), fineDt).array();
+
+    Eigen::VectorXd Y = fine;
+    if (level > 0) {
+        const int coarseSteps = fineSteps / refinement_;
+        const double coarseDt = maturity_ / coarseSteps;
+        Eigen::MatrixXd coarse_spot = Eigen::MatrixXd::Zero(numPaths, coarseSteps);
+        Eigen::MatrixXd coarse_volatility = Eigen::MatrixXd::Zero(numPaths, coarseSteps);
+        Eigen::MatrixXd coarse_rate = Eigen::MatrixXd::Zero(numPaths, coarseSteps);
+        for (int j = 0; j < coarseSteps; ++j) {
+            coarse_spot.col(j) = dw_spot.middleCols(j * refinement_, refinement_).rowwise().sum();
+            coarse_volatility.col(j) = dw_volatility.middleCols(j * refinement_, refinement_).rowwise().sum();
+            coarse_rate.col(j) = dw_rate.middleCols(j * refinement_, refinement_).rowwise().sum();
+        }
+
+        Parameters coarseParams = params_;
+        coarseParams.set<double>("dt", coarseDt);
+        coarseParams.set<double>("numSteps", coarseSteps);
+        MonteCarloSimulator coarseSimulator(coarseParams, pricingModel_);
+        coarseSimulator.set_random_stream(blockSeed, 2);
+        coarseSimulator.generate_paths(coarse_spot, coarse_volatility, coarse_rate);
+
+        Eigen::VectorXd coarse = pricingModel_.getPayoff()(coarseParams, coarseSimulator.get_price_paths());
+        coarse = coarse.array() * Pricing::calculate_discount_factors(coarseSimulator, pricingModel_.getRateModel(), coarseDt).array();
+        Y -= coarse;
+    }
+
+    return MomentAccumulator::from_values(Y);
+}
+
+// 把numSamples个样本切成路径块，交给调度器并行生成后在主线程按块序号合并到该层的矩
+void MultilevelMonteCarlo::sample_level(int level, long numSamples) {
+    const long numBlocks = (numSamples + MonteCarloSimulator::kBlockPaths - 1) / MonteCarloSimulator::kBlockPaths;
+    std::vector<MomentAccumulator> blockMoments(numBlocks);
+
+    // 块的种子由(seed, level, 该层已有样本数, 块序号)确定，结果与线程数无关
+    std::vector<unsigned int> blockSeeds(numBlocks);
+    std::seed_seq seq{static_cast<unsigned int>(params_.get<int>("seed")), static_cast<unsigned int>(level), static_cast<unsigned int>(samples_[level])};
+    seq.generate(blockSeeds.begin(), blockSeeds.end());
+
+    TaskScheduler::instance().parallel_for(0, numBlocks, 1, [&](long b) {
+        long numPaths = std::min(MonteCarloSimulator::kBlockPaths, numSamples - b * MonteCarloSimulator::kBlockPaths);
+        blockMoments[b] = sample_block(level, numPaths, blockSeeds[b]);
+    });
+
+    for (long b = 0; b < numBlocks; ++b) {
+        moments_[level].add(blockMoments[b]);
+    }
+    samples_[level] += numSamples;
+}
+
+double MultilevelMonteCarlo::calculatePrice() {
+    const bool verbose = !(params_.contains("quiet") && params_.get<bool>("quiet"));
+    samples_.clear();
+    moments_.clear();
+
+    const double eps2 = targetRMSE_ * targetRMSE_;
+    for (int l = 0; l < std::min(3, maxLevels_); ++l) {    // 至少从三层开始，保证偏差估计有意义
+        add_level();
+    }
+    std::vector<long> extraSamples(samples_.size(), initialSamples_);
+
+    while (true) {
+        for (int l = 0; l < getNumLevels(); ++l) {
+            if (extraSamples[l] > 0) {
+                sample_level(l, extraSamples[l]);
+            }
+        }
+
+        // 按照方差和成本重新分配每层的最优样本数
+        double sumSqrtVC = 0.0;
+        for (int l = 0; l < getNumLevels(); ++l) {
+            sumSqrtVC += std::sqrt(getLevelVariance(l) * levelCost(l));
+        }
+        bool needMore = false;
+        for (int l = 0; l < getNumLevels(); ++l) {
+            double optimal = std::ceil(2.0 / eps2 * std::sqrt(getLevelVariance(l) / levelCost(l)) * sumSqrtVC);
+            extraSamples[l] = std::max(0L, static_cast<long>(optimal) - samples_[l]);
+            needMore = needMore || extraSamples[l] > 0;
+        }
+        if (needMore) {
+            continue;
+        }
+
+        // 方差部分已经达标，再检查离散化偏差
+        int L = getNumLevels() - 1;
+        double bias = std::max(std::abs(getLevelMean(L)), std::abs(getLevelMean(L - 1)) / refinement_) / (refinement_ - 1);
+        if (bias < targetRMSE_ / std::sqrt(2.0)) {
+            break;
+        }
+        if (getNumLevels() >= maxLevels_) {
+            if (verbose) {
+                std::cout << "MLMC reached mlmcMaxLevels without meeting the bias target." << std::endl;
+            }
+            break;
+        }
+        add_level();
+        extraSamples.push_back(initialSamples_);
+    }
+
+    double price = 0.0;
+    double estimatorVariance = 0.0;
+    for (int l = 0; l < getNumLevels(); ++l) {
+        price += getLevelMean(l);
+        estimatorVariance += getLevelVariance(l) / samples_[l];
+        if (verbose) {
+            std::cout << "Level " << l << " (numSteps " << levelSteps(l) << "): N = " << samples_[l]
+                      << ", mean = " << getLevelMean(l) << ", variance = " << getLevelVariance(l) << std::endl;
+        }
+    }
+    if (verbose) {
+        std::cout << "MLMC Price: " << price << " (standard error " << std::sqrt(estimatorVariance) << ")" << std::endl;
+    }
+    return price;
+}
@@ -13,6 +13,26 @@
 
 # include "Parameters.hpp"
 # include <stdexcept>
+# include <vector>
+# include <algorithm>
+# include <cstring>
+# include <Eigen/Dense>
+
+namespace {
+// FNV-1a
+void hash_bytes(std::uint64_t& hash, const void* data, std::size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+}
+
+template<typename T>
+void hash_value(std::uint64_t& hash, char tag, const T& value) {
+    hash_bytes(hash, &tag, 1);
+    hash_bytes(hash, &value, sizeof(T));
+}
+}
 
 Parameters::Parameters() = default;
 
@@ -20,6 +40,47 @@ bool Parameters::contains(const std::string& key) const {
     return data_.find(key) != data_.end();
 }
 
+bool Parameters::fingerprint(std::uint64_t& hash, const std::set<std::string>& ignoredKeys) const {
+    std::vector<std::string> keys;
+    for (const auto& entry : data_) {
+        if (!ignoredKeys.count(entry.first)) {
+            keys.push_back(entry.first);
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+
+    hash = 0xCBF29CE484222325ull;
+    for (const std::string& key : keys) {
+        hash_bytes(hash, key.data(), key.size() + 1);
+        const std::any& value = data_.at(key);
+        if (value.type() == typeid(double)) {
+            hash_value(hash, 'd', std::any_cast<double>(value));
+        } else if (value.type() == typeid(int)) {
+            hash_value(hash, 'i', static_cast<long long>(std::any_cast<int>(value)));
+        } else if (value.type() == typeid(long)) {
+            hash_value(hash, 'i', static_cast<long long>(std::any_cast<long>(value)));
+        } else if (value.type() == typeid(bool)) {
+            hash_value(hash, 'b', std::any_cast<bool>(value));
+        } else if (value.type() == typeid(std::string)) {
+            const std::string& text = std::any_cast<const std::string&>(value);
+            hash_value(hash, 's', text.size());
+            hash_bytes(hash, text.data(), text.size());
+        } else if (value.type() == typeid(std::vector<double>)) {
+            const std::vector<double>& values = std::any_cast<const std::vector<double>&>(value);
+            hash_value(hash, 'v', values.size());
+            hash_bytes(hash, values.data(), values.size() * sizeof(double));
+        } else if (value.type() == typeid(Eigen::MatrixXd)) {
+            const Eigen::MatrixXd& matrix = std::any_cast<const Eigen::MatrixXd&>(value);
+            hash_value(hash, 'm', static_cast<long long>(matrix.rows()));
+            hash_value(hash, 'm', static_cast<long long>(matrix.cols()));
+            hash_bytes(hash, matrix.data(), matrix.size() * sizeof(double));
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
 // 需要在这里定义模板函数的实例化，否则链接时可能会出现未定义的引用错误
 template void Parameters::set<double>(const std::string&, const double&);
 template void Parameters::set<bool>(const std::string&, const bool&);
@@ -0,0 +1,186 @@
+//
+//  PathBlockStore.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+
+# include "PathBlockStore.hpp"
+# include "PathCache.hpp"
+# include "MonteCarloSimulator.hpp"
+# include "PricingModel.hpp"
+# include "SamplingStrategy.hpp"
+# include "Payoff.hpp"
+# include "TaskScheduler.hpp"
+# include "StatisticsAccumulator.hpp"
+# include <random>
+# include <vector>
+# include <cmath>
+# include <stdexcept>
+
+namespace {
+const double kDefaultCacheBytes = 4e9;
+}
+
+PathBlockStore::PathBlockStore(const PricingModel& pricingModel, const Parameters& params, long numPaths)
+    : pricingModel_(pricingModel), params_(params), numBlocks_((numPaths + MonteCarloSimulator::kBlockPaths - 1) / MonteCarloSimulator::kBlockPaths),
+      seed_(params.contains("seed") ? static_cast<std::uint32_t>(params.get<int>("seed")) : std::random_device()()),
+      driftShift_(0.0), sampling_(SamplingStrategy::create(params)) {
+    if (numPaths < 1) {
+        throw std::runtime_error("PathBlockStore requires numPaths >= 1");
+    }
+    if (params.contains("pathCache")) {
+        if (!params.contains("seed")) {
+            throw std::runtime_error("PathBlockStore with pathCache requires a seed");
+        }
+        // 参数无法哈希（例如带有yieldCurve）时不缓存，路径照常按需生成
+        std::uint64_t key = 0;
+        if (!PathCache::cache_key(pricingModel_, params_, numBlocks_, seed_, key)) {
+            return;
+        }
+        const std::string& directory = params.getRef<std::string>("pathCache");
+        const long numColumns = static_cast<long>(params.get<double>("numSteps")) + 1;
+        const std::string path = PathCache::file_path(directory, key);
+        cache_ = PathCache::open(path, key, numBlocks_, MonteCarloSimulator::kBlockPaths, numColumns);
+        if (!cache_) {
+            const double maxBytes = params.contains("pathCacheMaxBytes") ? params.get<double>("pathCacheMaxBytes") : kDefaultCacheBytes;
+            build_cache(directory, path, key, numColumns, static_cast<std::uint64_t>(maxBytes));
+        }
+    }
+}
+
+void PathBlockStore::build_cache(const std::string& directory, const std::string& path, std::uint64_t key, long numColumns, std::uint64_t maxBytes) {
+    // 超过大小上限，或者缓存目录不能创建、写入（权限、磁盘已满等）时不缓存，路径照常按需重新生成。
+    // 只有文件操作的错误被忽略，生成路径本身的错误照常抛出
+    std::unique_ptr<PathCache::Writer> writer;
+    try {
+        if (!PathCache::make_room(directory, PathCache::file_size(numBlocks_, MonteCarloSimulator::kBlockPaths, numColumns), maxBytes)) {
+            return;
+        }
+        writer = std::make_unique<PathCache::Writer>(path, key, numBlocks_, MonteCarloSimulator::kBlockPaths, numColumns);
+    } catch (const std::runtime_error&) {
+        return;
+    }
+    for_each_block_view(params_, [&writer](long block, const PathBlockView& view) {
+        writer->write_block(block, view.pricePaths, view.discountFactors, view.pathWeights, view.likelihoodRatios, view.strata);
+    });
+    try {
+        writer->commit();
+    } catch (const std::runtime_error&) {
+        return;
+    }
+    cache_ = PathCache::open(path, key, numBlocks_, MonteCarloSimulator::kBlockPaths, numColumns);
+}
+
+PathBlockStore::~PathBlockStore() = default;
+
+long PathBlockStore::getNumPaths() const {
+    return numBlocks_ * MonteCarloSimulator::kBlockPaths;
+}
+
+long PathBlockStore::getNumBlocks() const {
+    return numBlocks_;
+}
+
+std::uint64_t PathBlockStore::getSeed() const {
+    return seed_;
+}
+
+bool PathBlockStore::is_cached() const {
+    return cache_ != nullptr;
+}
+
+void PathBlockStore::set_drift_shift(double theta) {
+    driftShift_ = theta;
+}
+
+void PathBlockStore::generate_block(long block, MonteCarloSimulator& simulator) const {
+    if (block < 0 || block >= numBlocks_) {
+        throw std::runtime_error("PathBlockStore block index out of range");
+    }
+    simulator.set_sampling_strategy(sampling_.get());
+    simulator.set_drift_shift(driftShift_);
+    simulator.set_random_stream(seed_, static_cast<std::uint32_t>(block));
+    simulator.generate_paths();
+}
+
+void PathBlockStore::for_each_block(const std::function<void(long block, const MonteCarloSimulator& simulator)>& visit) const {
+    for_each_block(params_, visit);
+}
+
+void PathBlockStore::for_each_block(const Parameters& scenario, const std::function<void(long block, const MonteCarloSimulator& simulator)>& visit) const {
+    TaskScheduler::instance().parallel_for(0, numBlocks_, 1, [&](long block) {
+        MonteCarloSimulator simulator(scenario, pricingModel_);
+        generate_block(block, simulator);
+        visit(block, simulator);
+    });
+}
+
+PricingResult PathBlockStore::price() const {
+    return price(params_);
+}
+
+bool PathBlockStore::uses_cache(const Parameters& scenario) const {
+    // 缓存的路径没有漂移平移；bump过的情景参数不同，键也不同
+    std::uint64_t key = 0;
+    return cache_ && driftShift_ == 0.0 && PathCache::cache_key(pricingModel_, scenario, numBlocks_, seed_, key) && key == cache_->getKey();
+}
+
+void PathBlockStore::for_each_block_view(const Parameters& scenario, const std::function<void(long block, const PathBlockView& view)>& visit) const {
+    if (uses_cache(scenario)) {
+        TaskScheduler::instance().parallel_for(0, numBlocks_, 1, [&](long block) {
+            visit(block, cache_->block(block));
+        });
+        return;
+    }
+    const double dt = scenario.get<double>("dt");
+    for_each_block(scenario, [&](long block, const MonteCarloSimulator& simulator) {
+        const Eigen::MatrixXd& paths = simulator.get_price_paths();
+        Eigen::VectorXd discountFactors(paths.rows());
+        Pricing::calculate_discount_factors(simulator, pricingModel_.getRateModel(), dt, discountFactors);
+        const Eigen::VectorXd& weights = simulator.get_path_weights();
+        const Eigen::VectorXd& likelihoodRatios = simulator.get_likelihood_ratios();
+        const Eigen::VectorXi& strata = simulator.get_strata();
+        visit(block, PathBlockView{Eigen::Map<const Eigen::MatrixXd>(paths.data(), paths.rows(), paths.cols()),
+                                   Eigen::Map<const Eigen::VectorXd>(discountFactors.data(), discountFactors.size()),
+                                   Eigen::Map<const Eigen::VectorXd>(weights.data(), weights.size()),
+                                   Eigen::Map<const Eigen::VectorXd>(likelihoodRatios.data(), likelihoodRatios.size()),
+                                   Eigen::Map<const Eigen::VectorXi>(strata.data(), strata.size())});
+    });
+}
+
+PricingResult PathBlockStore::price(const Parameters& scenario) const {
+    // 分层抽样时每块再按层分组累积矩（折现payoff乘似然比，不含抽样权重），标准误差用分层估计量的公式
+    const std::vector<double> strataProbabilities = sampling_->getStrataProbabilities();
+    std::vector<MomentAccumulator> blockMoments(numBlocks_);
+    std::vector<std::vector<MomentAccumulator>> strataBlocks(strataProbabilities.empty() ? 0 : numBlocks_, std::vector<MomentAccumulator>(strataProbabilities.size()));
+    for_each_block_view(scenario, [&](long block, const PathBlockView& view) {
+        Eigen::VectorXd values(view.pricePaths.rows());
+        pricingModel_.getPayoff().evaluate(scenario, view.pricePaths, values);
+        values.array() *= view.discountFactors.array();
+        if (!strataProbabilities.empty()) {
+            Pricing::calculate_strata_moments(view.strata, values, view.likelihoodRatios, strataBlocks[block]);
+        }
+        values.array() *= view.pathWeights.array();
+        blockMoments[block] = MomentAccumulator::from_values(values);
+    });
+
+    TreeAccumulator total;
+    for (const MomentAccumulator& moments : blockMoments) {
+        total.add(moments);
+    }
+    StratifiedAccumulator strataMoments(strataProbabilities);
+    for (const std::vector<MomentAccumulator>& blockStrata : strataBlocks) {
+        strataMoments.add(blockStrata);
+    }
+    const MomentAccumulator result = total.result();
+    const double confidenceLevel = scenario.contains("confidenceLevel") ? scenario.get<double>("confidenceLevel") : 0.95;
+    PricingResult pricing;
+    pricing.price = result.mean();
+    pricing.standardError = strataMoments.empty() ? result.stdev() / std::sqrt(result.count()) : strataMoments.standardError();
+    pricing.lowerBound = pricing.price - Pricing::get_z_value(confidenceLevel) * pricing.standardError;
+    pricing.upperBound = pricing.price + Pricing::get_z_value(confidenceLevel) * pricing.standardError;
+    pricing.numSimulations = getNumPaths();
+    pricing.converged = true;
+    return pricing;
+}
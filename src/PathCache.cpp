@@ -0,0 +1,371 @@
+//
+//  PathCache.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+
+# include "PathCache.hpp"
+# include "Parameters.hpp"
+# include "PricingModel.hpp"
+# include "RateModel.hpp"
+# include "VolatilityModel.hpp"
+# include "AssetPriceModel.hpp"
+# include "Payoff.hpp"
+# include "TaskScheduler.hpp"
+# include <fstream>
+# include <mutex>
+# include <atomic>
+# include <random>
+# include <algorithm>
+# include <typeinfo>
+# include <cstring>
+# include <cstdio>
+# include <filesystem>
+# include <system_error>
+# include <stdexcept>
+# if defined(__unix__) || defined(__APPLE__)
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+# endif
+
+// 文件布局（本机字节序，所有区段64字节对齐，与MarketDataStore相同）：
+//   FileHeader | 每块的校验和uint64[numBlocks] | 块0 | 块1 | ...
+// 每块依次为价格路径double[blockSize * numColumns]（列主序）、折现因子double[blockSize]、路径权重double[blockSize]、
+// 似然比double[blockSize]、分层号int32[blockSize]
+namespace {
+const char kMagic[8] = {'D', 'P', 'P', 'A', 'T', 'H', '2', '\0'};
+const std::size_t kAlignment = 64;
+const char kExtension[] = ".paths";
+// 键中忽略的参数：只影响payoff的参数（Payoff::getPayoffKeys），加上定价控制和缓存自身的设置
+const std::set<std::string>& ignored_keys() {
+    static const std::set<std::string> keys = [] {
+        std::set<std::string> ignored = Payoff::getPayoffKeys();
+        ignored.insert({"confidenceLevel", "tolerance", "maxSimulations", "quiet", "pathCache", "pathCacheMaxBytes"});
+        return ignored;
+    }();
+    return keys;
+}
+
+struct FileHeader {
+    char magic[8];
+    std::uint64_t key;
+    std::uint64_t numBlocks;
+    std::uint64_t blockSize;
+    std::uint64_t numColumns;
+    std::uint64_t checksumsOffset;
+    std::uint64_t dataOffset;
+    std::uint64_t blockStride;
+};
+
+std::size_t align_up(std::size_t bytes) {
+    return (bytes + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+std::size_t block_stride(long blockSize, long numColumns) {
+    return align_up(static_cast<std::size_t>(blockSize) * (static_cast<std::size_t>(numColumns + 3) * sizeof(double) + sizeof(std::int32_t)));
+}
+
+std::size_t data_offset(long numBlocks) {
+    return align_up(align_up(sizeof(FileHeader)) + static_cast<std::size_t>(numBlocks) * sizeof(std::uint64_t));
+}
+
+// 四路交错的乘法哈希，按64位字处理，每块只需要一次顺序读取
+std::uint64_t checksum(const std::uint64_t* words, std::size_t count) {
+    std::uint64_t lanes[4] = {0x243F6A8885A308D3ull, 0x13198A2E03707344ull, 0xA4093822299F31D0ull, 0x082EFA98EC4E6C89ull};
+    auto mix = [](std::uint64_t h, std::uint64_t word) {
+        h ^= word;
+        h = (h << 29) | (h >> 35);
+        return h * 0x9E3779B97F4A7C15ull;
+    };
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        lanes[0] = mix(lanes[0], words[i]);
+        lanes[1] = mix(lanes[1], words[i + 1]);
+        lanes[2] = mix(lanes[2], words[i + 2]);
+        lanes[3] = mix(lanes[3], words[i + 3]);
+    }
+    for (; i < count; ++i) {
+        lanes[0] = mix(lanes[0], words[i]);
+    }
+    std::uint64_t hash = count;
+    for (std::uint64_t lane : lanes) {
+        hash = mix(hash, lane);
+    }
+    return hash ^ (hash >> 32);
+}
+
+std::uint64_t hash_text(std::uint64_t hash, const std::string& text) {
+    for (unsigned char ch : text) {
+        hash = (hash ^ ch) * 0x100000001B3ull;
+    }
+    return (hash ^ 0xFF) * 0x100000001B3ull;
+}
+}
+
+bool PathCache::cache_key(const PricingModel& pricingModel, const Parameters& params, long numBlocks, std::uint64_t seed, std::uint64_t& key) {
+    std::uint64_t fingerprint = 0;
+    if (!params.fingerprint(fingerprint, ignored_keys())) {
+        return false;
+    }
+    std::uint64_t hash = 0xCBF29CE484222325ull;
+    hash = hash_text(hash, std::string(kMagic));
+    hash = hash_text(hash, typeid(pricingModel.getRateModel()).name());
+    hash = hash_text(hash, typeid(pricingModel.getVolatilityModel()).name());
+    hash = hash_text(hash, typeid(pricingModel.getAssetPriceModel()).name());
+    hash = hash_text(hash, std::to_string(fingerprint));
+    hash = hash_text(hash, std::to_string(numBlocks));
+    hash = hash_text(hash, std::to_string(seed));
+    key = hash;
+    return true;
+}
+
+std::string PathCache::file_path(const std::string& directory, std::uint64_t key) {
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(directory) / (std::string(name) + kExtension)).string();
+}
+
+std::uint64_t PathCache::file_size(long numBlocks, long blockSize, long numColumns) {
+    return data_offset(numBlocks) + static_cast<std::uint64_t>(numBlocks) * block_stride(blockSize, numColumns);
+}
+
+bool PathCache::make_room(const std::string& directory, std::uint64_t numBytes, std::uint64_t maxBytes) {
+    namespace fs = std::filesystem;
+    if (numBytes > maxBytes) {
+        return false;
+    }
+    fs::create_directories(directory);
+
+    struct Entry {
+        fs::file_time_type lastUsed;
+        std::uint64_t size;
+        fs::path path;
+    };
+    std::vector<Entry> entries;
+    std::uint64_t total = 0;
+    for (const fs::directory_entry& file : fs::directory_iterator(directory)) {
+        std::error_code error;
+        if (!file.is_regular_file(error) || file.path().extension() != kExtension) {
+            continue;
+        }
+        Entry entry = {file.last_write_time(error), file.file_size(error), file.path()};
+        if (!error) {
+            total += entry.size;
+            entries.push_back(entry);
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+    for (const Entry& entry : entries) {
+        if (total + numBytes <= maxBytes) {
+            break;
+        }
+        std::error_code error;
+        if (fs::remove(entry.path, error)) {
+            total -= entry.size;
+        }
+    }
+    return total + numBytes <= maxBytes;
+}
+
+PathCache::PathCache()
+    : mapping_(nullptr), mappingSize_(0), key_(0), numBlocks_(0), blockSize_(0), numColumns_(0), dataOffset_(0), blockStride_(0) {}
+
+std::unique_ptr<PathCache> PathCache::open(const std::string& path, std::uint64_t key, long numBlocks, long blockSize, long numColumns) {
+    std::unique_ptr<PathCache> cache(new PathCache());
+# if defined(__unix__) || defined(__APPLE__)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+        ::close(fd);
+        return nullptr;
+    }
+    cache->mappingSize_ = static_cast<std::size_t>(info.st_size);
+    void* memory = mmap(nullptr, cache->mappingSize_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    cache->mapping_ = memory;
+# else
+    // 没有mmap的平台整个读入一块64字节对齐的内存，接口不变
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return nullptr;
+    }
+    cache->mappingSize_ = static_cast<std::size_t>(in.tellg());
+    if (cache->mappingSize_ < sizeof(FileHeader)) {
+        return nullptr;
+    }
+    cache->mapping_ = ::operator new(cache->mappingSize_, std::align_val_t(kAlignment));
+    in.seekg(0);
+    in.read(static_cast<char*>(cache->mapping_), static_cast<std::streamsize>(cache->mappingSize_));
+    if (!in) {
+        return nullptr;
+    }
+# endif
+
+    const char* base = static_cast<const char*>(cache->mapping_);
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(FileHeader));
+    const std::size_t stride = block_stride(blockSize, numColumns);
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.key != key || header.numBlocks != static_cast<std::uint64_t>(numBlocks) ||
+        header.blockSize != static_cast<std::uint64_t>(blockSize) || header.numColumns != static_cast<std::uint64_t>(numColumns) ||
+        header.checksumsOffset != align_up(sizeof(FileHeader)) || header.dataOffset != data_offset(numBlocks) || header.blockStride != stride || cache->mappingSize_ < file_size(numBlocks, blockSize, numColumns)) {
+        return nullptr;
+    }
+    cache->key_ = key;
+    cache->numBlocks_ = numBlocks;
+    cache->blockSize_ = blockSize;
+    cache->numColumns_ = numColumns;
+    cache->dataOffset_ = header.dataOffset;
+    cache->blockStride_ = stride;
+
+    // 全部块校验一遍（一次顺序读，远比重新模拟便宜），任何一块不符都视为文件无效
+    const std::uint64_t* checksums = reinterpret_cast<const std::uint64_t*>(base + align_up(sizeof(FileHeader)));
+    std::atomic<bool> valid(true);
+    TaskScheduler::instance().parallel_for(0, numBlocks, 1, [&](long b) {
+        const std::uint64_t* words = reinterpret_cast<const std::uint64_t*>(base + cache->dataOffset_ + b * cache->blockStride_);
+        if (checksum(words, cache->blockStride_ / sizeof(std::uint64_t)) != checksums[b]) {
+            valid.store(false, std::memory_order_relaxed);
+        }
+    });
+    if (!valid.load()) {
+        return nullptr;
+    }
+
+    // 作为最近使用时间，make_room淘汰时保留常用的文件
+    std::error_code error;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+    return cache;
+}
+
+PathCache::~PathCache() {
+    release();
+}
+
+void PathCache::release() {
+    if (mapping_ == nullptr) {
+        return;
+    }
+# if defined(__unix__) || defined(__APPLE__)
+    munmap(mapping_, mappingSize_);
+# else
+    ::operator delete(mapping_, std::align_val_t(kAlignment));
+# endif
+    mapping_ = nullptr;
+}
+
+long PathCache::getNumBlocks() const {
+    return numBlocks_;
+}
+
+std::uint64_t PathCache::getKey() const {
+    return key_;
+}
+
+PathBlockView PathCache::block(long index) const {
+    if (index < 0 || index >= numBlocks_) {
+        throw std::runtime_error("PathCache block index out of range");
+    }
+    const double* data = reinterpret_cast<const double*>(static_cast<const char*>(mapping_) + dataOffset_ + index * blockStride_);
+    return PathBlockView{Eigen::Map<const Eigen::MatrixXd>(data, blockSize_, numColumns_),
+                         Eigen::Map<const Eigen::VectorXd>(data + blockSize_ * numColumns_, blockSize_),
+                         Eigen::Map<const Eigen::VectorXd>(data + blockSize_ * (numColumns_ + 1), blockSize_),
+                         Eigen::Map<const Eigen::VectorXd>(data + blockSize_ * (numColumns_ + 2), blockSize_),
+                         Eigen::Map<const Eigen::VectorXi>(reinterpret_cast<const int*>(data + blockSize_ * (numColumns_ + 3)), blockSize_)};
+}
+
+struct PathCache::Writer::Impl {
+    std::string path;
+    std::string temporaryPath;
+    FileHeader header;
+    std::ofstream out;
+    std::mutex mutex;
+    std::vector<std::uint64_t> checksums;
+    std::vector<char> written;
+    bool committed;
+};
+
+PathCache::Writer::Writer(const std::string& path, std::uint64_t key, long numBlocks, long blockSize, long numColumns)
+    : impl_(new Impl()) {
+    impl_->path = path;
+    impl_->temporaryPath = path + ".tmp" + std::to_string(std::random_device()());
+    impl_->header = {};
+    std::memcpy(impl_->header.magic, kMagic, sizeof(kMagic));
+    impl_->header.key = key;
+    impl_->header.numBlocks = static_cast<std::uint64_t>(numBlocks);
+    impl_->header.blockSize = static_cast<std::uint64_t>(blockSize);
+    impl_->header.numColumns = static_cast<std::uint64_t>(numColumns);
+    impl_->header.checksumsOffset = align_up(sizeof(FileHeader));
+    impl_->header.dataOffset = data_offset(numBlocks);
+    impl_->header.blockStride = block_stride(blockSize, numColumns);
+    impl_->checksums.assign(static_cast<std::size_t>(numBlocks), 0);
+    impl_->written.assign(static_cast<std::size_t>(numBlocks), 0);
+    impl_->committed = false;
+    impl_->out.open(impl_->temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!impl_->out) {
+        throw std::runtime_error("Cannot create path cache file: " + impl_->temporaryPath);
+    }
+}
+
+PathCache::Writer::~Writer() {
+    if (!impl_->committed) {
+        impl_->out.close();
+        std::error_code error;
+        std::filesystem::remove(impl_->temporaryPath, error);
+    }
+}
+
+void PathCache::Writer::write_block(long index, const Eigen::Ref<const Eigen::MatrixXd>& pricePaths, const Eigen::Ref<const Eigen::VectorXd>& discountFactors,
+                                    const Eigen::Ref<const Eigen::VectorXd>& pathWeights, const Eigen::Ref<const Eigen::VectorXd>& likelihoodRatios,
+                                    const Eigen::Ref<const Eigen::VectorXi>& strata) {
+    const FileHeader& header = impl_->header;
+    const Eigen::Index rows = static_cast<Eigen::Index>(header.blockSize);
+    const Eigen::Index cols = static_cast<Eigen::Index>(header.numColumns);
+    if (index < 0 || static_cast<std::uint64_t>(index) >= header.numBlocks) {
+        throw std::runtime_error("PathCache block index out of range");
+    }
+    if (pricePaths.rows() != rows || pricePaths.cols() != cols || discountFactors.size() != rows || pathWeights.size() != rows ||
+        likelihoodRatios.size() != rows || strata.size() != rows) {
+        throw std::runtime_error("PathCache block has the wrong shape");
+    }
+
+    // 在本线程内拼出整块（包括对齐的填充）并计算校验和，只有写文件时加锁
+    std::vector<std::uint64_t> buffer(header.blockStride / sizeof(std::uint64_t), 0);
+    double* data = reinterpret_cast<double*>(buffer.data());
+    Eigen::Map<Eigen::MatrixXd>(data, rows, cols) = pricePaths;
+    Eigen::Map<Eigen::VectorXd>(data + rows * cols, rows) = discountFactors;
+    Eigen::Map<Eigen::VectorXd>(data + rows * (cols + 1), rows) = pathWeights;
+    Eigen::Map<Eigen::VectorXd>(data + rows * (cols + 2), rows) = likelihoodRatios;
+    Eigen::Map<Eigen::VectorXi>(reinterpret_cast<int*>(data + rows * (cols + 3)), rows) = strata;
+    const std::uint64_t sum = checksum(buffer.data(), buffer.size());
+
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->out.seekp(static_cast<std::streamoff>(header.dataOffset + index * header.blockStride));
+    impl_->out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(header.blockStride));
+    impl_->checksums[index] = sum;
+    impl_->written[index] = 1;
+}
+
+void PathCache::Writer::commit() {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    if (std::find(impl_->written.begin(), impl_->written.end(), 0) != impl_->written.end()) {
+        throw std::runtime_error("PathCache commit before all blocks were written: " + impl_->path);
+    }
+    impl_->out.seekp(0);
+    impl_->out.write(reinterpret_cast<const char*>(&impl_->header), sizeof(FileHeader));
+    impl_->out.seekp(static_cast<std::streamoff>(impl_->header.checksumsOffset));
+    impl_->out.write(reinterpret_cast<const char*>(impl_->checksums.data()), static_cast<std::streamsize>(impl_->checksums.size() * sizeof(std::uint64_t)));
+    impl_->out.close();
+    if (impl_->out.fail()) {
+        throw std::runtime_error("Failed writing path cache file: " + impl_->temporaryPath);
+    }
+    std::filesystem::rename(impl_->temporaryPath, impl_->path);
+    impl_->committed = true;
+}
@@ -18,13 +18,24 @@
 # include <numeric>
 # include <cfloat>
 
+Eigen::VectorXd Payoff::operator()(const Parameters& params, const Eigen::MatrixXd& paths) const {
+    Eigen::VectorXd payoffs(paths.rows());
+    evaluate(params, paths, payoffs);
+    return payoffs;
+}
+
+const std::set<std::string>& Payoff::getPayoffKeys() {
+    static const std::set<std::string> keys = {"payoff", "strike", "barrier", "upperBarrier", "lowerBarrier", "rebate", "barrierVolatility", "barrierDiscrete",
+                                               "isUpIn", "isDownOut", "isUpOut", "isDownIn", "barrierScheduleTimes", "barrierScheduleLevels",
+                                               "upperBarrierScheduleLevels", "lowerBarrierScheduleLevels"};
+    return keys;
+}
+
 // 欧式看涨期权
 EuropeanCallPayoff::EuropeanCallPayoff() {}
 
-Eigen::VectorXd EuropeanCallPayoff::operator()(const Parameters& params, const Eigen::MatrixXd& paths) const {
-    Eigen::VectorXd finalPrices = paths.col(paths.cols() - 1);
-    Eigen::VectorXd payoffs = (finalPrices.array() - params.get<double>("strike")).max(0.0);
-    return payoffs;
+void EuropeanCallPayoff::evaluate(const Parameters& params, const Eigen::Ref<const Eigen::MatrixXd>& paths, Eigen::Ref<Eigen::VectorXd> payoffs) const {
+    payoffs = (paths.col(paths.cols() - 1).array() - params.get<double>("strike")).max(0.0).matrix();
 }
 
 std::string EuropeanCallPayoff::getName() const {
@@ -34,10 +45,8 @@ std::string EuropeanCallPayoff::getName() const {
 // 欧式看跌期权
 EuropeanPutPayoff::EuropeanPutPayoff() {}
 
-Eigen::VectorXd EuropeanPutPayoff::operator()(const Parameters& params, const Eigen::MatrixXd& paths) const {
-    Eigen::VectorXd finalPrices = paths.col(paths.cols() - 1);
-    Eigen::VectorXd payoffs = (params.get<double>("strike") - finalPrices.array()).max(0.0);
-    return payoffs;
+void EuropeanPutPayoff::evaluate(const Parameters& params, const Eigen::Ref<const Eigen::MatrixXd>& paths, Eigen::Ref<Eigen::VectorXd> payoffs) const {
+    payoffs = (params.get<double>("strike") - paths.col(paths.cols() - 1).array()).max(0.0).matrix();
 }
 
 std::string EuropeanPutPayoff::getName() const {
@@ -50,74 +59,122 @@ std::string EuropeanPutPayoff::getName() const {
 // BarrierPayoff 构造函数
 BarrierPayoff::BarrierPayoff() {}
 
-// operator() 函数
-Eigen::VectorXd BarrierPayoff::operator()(const Parameters& params, const Eigen::MatrixXd& paths) const {
-    std::string payoffType = params.get<std::string>("payoff");
-    double barrier = params.get<double>("barrier");
-    bool isUpIn = params.get<bool>("isUpIn");
-    bool isDownOut = params.get<bool>("isDownOut");
-    bool isUpOut = params.get<bool>("isUpOut");
-    bool isDownIn = params.get<bool>("isDownIn");
-
-    // 根据payoff类型创建对应的对象
-    std::unique_ptr<Payoff> payoffTypeObj;
+namespace {
+// 超过短字符串优化长度的key：contains/getRef接受const std::string&，直接传字面量每次调用都会在堆上构造临时字符串
+const std::string kBarrierScheduleTimes = "barrierScheduleTimes";
+const std::string kBarrierScheduleLevels = "barrierScheduleLevels";
+const std::string kUpperBarrierScheduleLevels = "upperBarrierScheduleLevels";
+const std::string kLowerBarrierScheduleLevels = "lowerBarrierScheduleLevels";
+const std::string kBarrierVolatility = "barrierVolatility";
+
+// 第step个时间区间(t_step, t_step+1]所在的分段
+std::size_t schedule_segment(const std::vector<double>& times, double t, std::size_t segment) {
+    while (segment + 1 < times.size() && times[segment] < t - 1e-12) {
+        ++segment;
+    }
+    return segment;
+}
+}
+
+// 单次遍历：payoffs先存放每条路径到目前为止未触及障碍的概率（离散触及时为0），逐列推进，最后原地换成最终的payoff。
+// 障碍水平在每个区间只查一次，整个过程不分配内存、不复制路径。
+// 布朗桥：log S在[t_j, t_j+1]上以端点为条件，不穿过上障碍B的概率为1 - exp(-2 ln(B/S_j) ln(B/S_j+1) / (sigma^2 dt))，下障碍同理；
+// 双障碍时两个穿越概率相加作为一阶近似（dt较小时两者几乎不会同时发生）
+void BarrierPayoff::evaluate(const Parameters& params, const Eigen::Ref<const Eigen::MatrixXd>& paths, Eigen::Ref<Eigen::VectorXd> payoffs) const {
+    const std::string& payoffType = params.getRef<std::string>("payoff");
+    const bool isUpIn = params.get<bool>("isUpIn");
+    const bool isDownOut = params.get<bool>("isDownOut");
+    const bool isUpOut = params.get<bool>("isUpOut");
+    const bool isDownIn = params.get<bool>("isDownIn");
+    const double strike = params.get<double>("strike");
+    const double rebate = params.contains("rebate") ? params.get<double>("rebate") : 0.0;
+    const bool discrete = params.contains("barrierDiscrete") && params.get<bool>("barrierDiscrete");
+
+    // 根据payoff类型确定内层为看涨还是看跌
+    bool isCall;
     if (payoffType == "EuropeanCallPayoff") {
-        payoffTypeObj = std::make_unique<EuropeanCallPayoff>();
+        isCall = true;
     } else if (payoffType == "EuropeanPutPayoff") {
-        payoffTypeObj = std::make_unique<EuropeanPutPayoff>();
+        isCall = false;
     } else {
         throw std::runtime_error("Unknown payoff type");
     }
 
-    // 确定每条路径是否满足障碍条件
-    Eigen::Array<bool, Eigen::Dynamic, 1> barrierBreached;
-    if (isUpIn || isUpOut) {
-        barrierBreached = (paths.rowwise().maxCoeff().array() >= barrier);
-    } else if (isDownIn || isDownOut) {
-        barrierBreached = (paths.rowwise().minCoeff().array() <= barrier);
-    }
-
-    // 创建一个条件掩码，选择符合条件的路径
-    Eigen::Array<bool, Eigen::Dynamic, 1> conditionsMet(paths.rows());
-    if (isUpIn) {
-        conditionsMet = barrierBreached;
-    } else if (isDownOut) {
-        conditionsMet = !barrierBreached;
-    } else if (isUpOut) {
-        conditionsMet = !barrierBreached;
-    } else if (isDownIn) {
-        conditionsMet = barrierBreached;
-    }
-
-    // 过滤符合条件的路径
-    Eigen::MatrixXd selectedPaths(paths.rows(), paths.cols());
-    long selectedCount = (conditionsMet == true).count();
-    Eigen::MatrixXd filteredPaths(selectedCount, paths.cols());
-    int index = 0;
-    for (int i = 0; i < paths.rows(); ++i) {
-        if (conditionsMet(i)) {
-            filteredPaths.row(index++) = paths.row(i);
+    // 障碍：上障碍、下障碍或者二者都有，各自可以是常数或分段常数
+    const bool isDouble = params.contains("upperBarrier") || params.contains(kUpperBarrierScheduleLevels);
+    const bool hasUpper = isDouble || isUpIn || isUpOut;
+    const bool hasLower = isDouble || isDownIn || isDownOut;
+    const bool isKnockIn = isUpIn || isDownIn;
+    const bool hasSchedule = params.contains(kBarrierScheduleTimes);
+    // 只有布朗桥修正和分段障碍的时间定位需要dt
+    const double dt = (!discrete || hasSchedule) ? params.get<double>("dt") : 0.0;
+    const std::vector<double>* times = hasSchedule ? &params.getRef<std::vector<double>>(kBarrierScheduleTimes) : nullptr;
+    const std::vector<double>* upperLevels = nullptr;
+    const std::vector<double>* lowerLevels = nullptr;
+    double upper = 0.0;
+    double lower = 0.0;
+    if (hasSchedule) {
+        upperLevels = hasUpper ? &params.getRef<std::vector<double>>(isDouble ? kUpperBarrierScheduleLevels : kBarrierScheduleLevels) : nullptr;
+        lowerLevels = hasLower ? &params.getRef<std::vector<double>>(isDouble ? kLowerBarrierScheduleLevels : kBarrierScheduleLevels) : nullptr;
+        if (times->empty() || (upperLevels && upperLevels->size() != times->size()) || (lowerLevels && lowerLevels->size() != times->size())) {
+            throw std::runtime_error("Barrier schedule times and levels must be non-empty and of equal length");
         }
+    } else if (isDouble) {
+        upper = params.get<double>("upperBarrier");
+        lower = params.get<double>("lowerBarrier");
+    } else {
+        upper = lower = params.get<double>("barrier");
     }
 
-    // 计算符合条件的路径的payoff
-    Eigen::VectorXd payoffValues(paths.rows());
-    Eigen::VectorXd selectedPayoffs = Eigen::VectorXd::Zero(selectedCount);
-    if (selectedCount > 0) {
-        selectedPayoffs = (*payoffTypeObj)(params, filteredPaths);
+    double bridgeScale = 0.0;       // 2 / (sigma^2 dt)
+    if (!discrete) {
+        const double sigma = params.contains(kBarrierVolatility) ? params.get<double>(kBarrierVolatility) : params.get<double>("volatility");
+        bridgeScale = 2.0 / (sigma * sigma * dt);
     }
 
-    // 使用条件掩码恢复payoffValues
-    int payoffsIndex = 0;
-    for (int i = 0; i < paths.rows(); ++i) {
-        if (conditionsMet(i)) {
-            payoffValues(i) = selectedPayoffs(payoffsIndex++);
+    payoffs.setOnes();
+    std::size_t segment = 0;
+    for (Eigen::Index col = 0; col + 1 < paths.cols(); ++col) {
+        if (hasSchedule) {
+            segment = schedule_segment(*times, (col + 1) * dt, segment);
+            if (upperLevels) upper = (*upperLevels)[segment];
+            if (lowerLevels) lower = (*lowerLevels)[segment];
+        }
+        const auto s0 = paths.col(col).array();
+        const auto s1 = paths.col(col + 1).array();
+        if (discrete) {
+            if (hasUpper) {
+                payoffs.array() *= (s0 < upper && s1 < upper).cast<double>();
+            }
+            if (hasLower) {
+                payoffs.array() *= (s0 > lower && s1 > lower).cast<double>();
+            }
+        } else if (hasUpper && hasLower) {
+            const double logUpper = std::log(upper);
+            const double logLower = std::log(lower);
+            payoffs.array() *= (s0 < upper && s1 < upper && s0 > lower && s1 > lower).select(
+                (1.0 - (-bridgeScale * (logUpper - s0.log()) * (logUpper - s1.log())).exp()
+                     - (-bridgeScale * (s0.log() - logLower) * (s1.log() - logLower)).exp()).max(0.0), 0.0);
+        } else if (hasUpper) {
+            const double logUpper = std::log(upper);
+            payoffs.array() *= (s0 < upper && s1 < upper).select(
+                1.0 - (-bridgeScale * (logUpper - s0.log()) * (logUpper - s1.log())).exp(), 0.0);
         } else {
-            payoffValues(i) = 0.0;
+            const double logLower = std::log(lower);
+            payoffs.array() *= (s0 > lower && s1 > lower).select(
+                1.0 - (-bridgeScale * (s0.log() - logLower) * (s1.log() - logLower)).exp(), 0.0);
         }
     }
 
-    return payoffValues;
+    // payoffs中为未触及概率q：敲出 = q * vanilla + (1 - q) * rebate，敲入 = (1 - q) * vanilla + q * rebate
+    const auto terminal = paths.col(paths.cols() - 1).array();
+    const double sign = isCall ? 1.0 : -1.0;
+    const auto vanilla = (sign * (terminal - strike)).max(0.0);
+    if (isKnockIn) {
+        payoffs = ((1.0 - payoffs.array()) * vanilla + payoffs.array() * rebate).matrix();
+    } else {
+        payoffs = (payoffs.array() * vanilla + (1.0 - payoffs.array()) * rebate).matrix();
+    }
 }
 
 // getName() 函数
@@ -139,11 +196,10 @@ std::string BarrierPayoff::getName() const {
 // 亚式期权：强路径依赖
 AsianPayoff::AsianPayoff() {}
 
-Eigen::VectorXd AsianPayoff::operator()(const Parameters& params, const Eigen::MatrixXd& paths) const {
+void AsianPayoff::evaluate(const Parameters& params, const Eigen::Ref<const Eigen::MatrixXd>& paths, Eigen::Ref<Eigen::VectorXd> payoffs) const {
     // 这里的计算转移到MCS中double avgSpot = std::accumulate(spots_.begin(), spots_.end(), 0.0) / spots_.size();
-    Eigen::VectorXd avgSpots = paths.rowwise().mean();
-    Eigen::VectorXd payoffs = (avgSpots.array() - params.get<double>("strike")).max(0.0);
-    return payoffs;
+    payoffs = paths.rowwise().mean();
+    payoffs = (payoffs.array() - params.get<double>("strike")).max(0.0).matrix();
 }
 
 std::string AsianPayoff::getName() const {
@@ -153,10 +209,9 @@ std::string AsianPayoff::getName() const {
 // 回溯期权
 LookbackPayoff::LookbackPayoff() {} // : minSpot_(DBL_MAX), maxSpot_(DBL_MIN)
 
-Eigen::VectorXd LookbackPayoff::operator()(const Parameters& params, const Eigen::MatrixXd& paths) const {
-    Eigen::VectorXd maxSpots = paths.rowwise().maxCoeff();
-    Eigen::VectorXd payoffs = (maxSpots.array() - params.get<double>("strike")).max(0.0);
-    return payoffs;
+void LookbackPayoff::evaluate(const Parameters& params, const Eigen::Ref<const Eigen::MatrixXd>& paths, Eigen::Ref<Eigen::VectorXd> payoffs) const {
+    payoffs = paths.rowwise().maxCoeff();
+    payoffs = (payoffs.array() - params.get<double>("strike")).max(0.0).matrix();
 }
 
 std::string LookbackPayoff::getName() const {
@@ -0,0 +1,373 @@
+//
+//  PayoffExpression.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 编译：后序遍历表达式树生成栈式指令。常数子树在编译时折叠；二元运算的一侧为常数或参数时生成带立即数的指令，
+// 只有两侧都依赖路径时才占用第二个栈位置，所以常见的多腿结构只需要两三列临时数组。
+// 执行：路径矩阵按列存储，逐列读一次即可同时得到平均值、最大值、最小值；期末、期初和某一步的价格直接引用对应的列。
+
+# include "PayoffExpression.hpp"
+# include "Parameters.hpp"
+# include "Arena.hpp"
+# include <algorithm>
+# include <stdexcept>
+
+PayoffExpression::PayoffExpression(std::shared_ptr<const Node> node) : node_(std::move(node)) {}
+
+PayoffExpression PayoffExpression::leaf(Kind kind) {
+    auto node = std::make_shared<Node>();
+    node->kind = kind;
+    node->value = 0.0;
+    node->step = 0;
+    return PayoffExpression(node);
+}
+
+PayoffExpression PayoffExpression::binary(Kind kind, const PayoffExpression& a, const PayoffExpression& b) {
+    auto node = std::make_shared<Node>();
+    node->kind = kind;
+    node->value = 0.0;
+    node->step = 0;
+    node->left = a.node_;
+    node->right = b.node_;
+    return PayoffExpression(node);
+}
+
+PayoffExpression PayoffExpression::terminal() { return leaf(Kind::Terminal); }
+PayoffExpression PayoffExpression::initial() { return leaf(Kind::Initial); }
+PayoffExpression PayoffExpression::average() { return leaf(Kind::Average); }
+PayoffExpression PayoffExpression::path_maximum() { return leaf(Kind::Maximum); }
+PayoffExpression PayoffExpression::path_minimum() { return leaf(Kind::Minimum); }
+
+PayoffExpression PayoffExpression::at_step(int step) {
+    if (step < 0) {
+        throw std::runtime_error("PayoffExpression::at_step requires a non-negative step");
+    }
+    auto node = std::make_shared<Node>();
+    node->kind = Kind::Step;
+    node->value = 0.0;
+    node->step = step;
+    return PayoffExpression(node);
+}
+
+PayoffExpression PayoffExpression::constant(double value) {
+    auto node = std::make_shared<Node>();
+    node->kind = Kind::Constant;
+    node->value = value;
+    node->step = 0;
+    return PayoffExpression(node);
+}
+
+PayoffExpression PayoffExpression::parameter(const std::string& key) {
+    auto node = std::make_shared<Node>();
+    node->kind = Kind::Parameter;
+    node->value = 0.0;
+    node->step = 0;
+    node->key = key;
+    return PayoffExpression(node);
+}
+
+PayoffExpression PayoffExpression::maximum(const PayoffExpression& a, const PayoffExpression& b) { return binary(Kind::Max, a, b); }
+PayoffExpression PayoffExpression::minimum(const PayoffExpression& a, const PayoffExpression& b) { return binary(Kind::Min, a, b); }
+PayoffExpression PayoffExpression::indicator(const PayoffExpression& a, const PayoffExpression& b) { return binary(Kind::Greater, a, b); }
+
+PayoffExpression PayoffExpression::call(const PayoffExpression& underlying, double strike) {
+    return maximum(underlying - strike, constant(0.0));
+}
+
+PayoffExpression PayoffExpression::put(const PayoffExpression& underlying, double strike) {
+    return maximum(strike - underlying, constant(0.0));
+}
+
+// 以下组合结构的说明见HedgeStrategy.cpp
+PayoffExpression PayoffExpression::bull_spread(double lowStrike, double highStrike) {
+    return call(terminal(), lowStrike) - call(terminal(), highStrike);
+}
+
+PayoffExpression PayoffExpression::bear_spread(double lowStrike, double highStrike) {
+    return put(terminal(), highStrike) - put(terminal(), lowStrike);
+}
+
+PayoffExpression PayoffExpression::straddle(double strike) {
+    return call(terminal(), strike) + put(terminal(), strike);
+}
+
+PayoffExpression PayoffExpression::strangle(double putStrike, double callStrike) {
+    return put(terminal(), putStrike) + call(terminal(), callStrike);
+}
+
+PayoffExpression PayoffExpression::butterfly(double lowStrike, double midStrike, double highStrike) {
+    return call(terminal(), lowStrike) - 2.0 * call(terminal(), midStrike) + call(terminal(), highStrike);
+}
+
+PayoffExpression PayoffExpression::condor(double strike1, double strike2, double strike3, double strike4) {
+    return call(terminal(), strike1) - call(terminal(), strike2) - call(terminal(), strike3) + call(terminal(), strike4);
+}
+
+PayoffExpression::Kind PayoffExpression::getKind() const {
+    return node_->kind;
+}
+
+PayoffExpression operator+(const PayoffExpression& a, const PayoffExpression& b) { return PayoffExpression::binary(PayoffExpression::Kind::Add, a, b); }
+PayoffExpression operator-(const PayoffExpression& a, const PayoffExpression& b) { return PayoffExpression::binary(PayoffExpression::Kind::Sub, a, b); }
+PayoffExpression operator*(const PayoffExpression& a, const PayoffExpression& b) { return PayoffExpression::binary(PayoffExpression::Kind::Mul, a, b); }
+PayoffExpression operator+(const PayoffExpression& a, double b) { return a + PayoffExpression::constant(b); }
+PayoffExpression operator+(double a, const PayoffExpression& b) { return PayoffExpression::constant(a) + b; }
+PayoffExpression operator-(const PayoffExpression& a, double b) { return a - PayoffExpression::constant(b); }
+PayoffExpression operator-(double a, const PayoffExpression& b) { return PayoffExpression::constant(a) - b; }
+PayoffExpression operator*(const PayoffExpression& a, double b) { return a * PayoffExpression::constant(b); }
+PayoffExpression operator*(double a, const PayoffExpression& b) { return PayoffExpression::constant(a) * b; }
+
+PayoffExpression operator-(const PayoffExpression& a) {
+    auto node = std::make_shared<PayoffExpression::Node>();
+    node->kind = PayoffExpression::Kind::Neg;
+    node->value = 0.0;
+    node->step = 0;
+    node->left = a.node_;
+    return PayoffExpression(node);
+}
+
+CompiledPayoff::CompiledPayoff(const PayoffExpression& expression, const std::string& name)
+    : name_(name), maxDepth_(1), needAverage_(false), needMaximum_(false), needMinimum_(false), maxStep_(0) {
+    Instruction immediate{Op::Immediate, Feature::Terminal, 0, 0.0, -1};
+    if (compile(*expression.node_, 0, immediate)) {
+        immediate.op = Op::Immediate;
+        program_.push_back(immediate);
+    }
+    fuse();
+}
+
+// Load f, SubImm K, MaxImm 0 -> LoadCall；Load f, RSubImm K, MaxImm 0 -> LoadPut；MulImm c, Add/Sub -> AddScaled ±c。
+// 多腿结构中每条腿只剩一条指令，每个栈元素只写一次
+void CompiledPayoff::fuse() {
+    auto is_zero = [](const Instruction& instruction) {
+        return instruction.op == Op::MaxImm && instruction.parameter < 0 && instruction.constant == 0.0;
+    };
+    std::vector<Instruction> fused;
+    for (std::size_t i = 0; i < program_.size(); ++i) {
+        const Instruction& instruction = program_[i];
+        if (instruction.op == Op::Load && i + 2 < program_.size() && is_zero(program_[i + 2])
+            && (program_[i + 1].op == Op::SubImm || program_[i + 1].op == Op::RSubImm)) {
+            Instruction ramp = program_[i + 1];
+            ramp.op = program_[i + 1].op == Op::SubImm ? Op::LoadCall : Op::LoadPut;
+            ramp.feature = instruction.feature;
+            ramp.step = instruction.step;
+            fused.push_back(ramp);
+            i += 2;
+        } else if (instruction.op == Op::MulImm && instruction.parameter < 0 && i + 1 < program_.size()
+                   && (program_[i + 1].op == Op::Add || program_[i + 1].op == Op::Sub)) {
+            Instruction axpy = instruction;
+            axpy.op = Op::AddScaled;
+            axpy.constant = program_[i + 1].op == Op::Add ? instruction.constant : -instruction.constant;
+            fused.push_back(axpy);
+            i += 1;
+        } else if ((instruction.op == Op::Add || instruction.op == Op::Sub) && !fused.empty()
+                   && (fused.back().op == Op::LoadCall || fused.back().op == Op::LoadPut)) {
+            // 栈顶刚由融合指令得到时，加减同样用AddScaled完成
+            fused.push_back({Op::AddScaled, Feature::Terminal, 0, instruction.op == Op::Add ? 1.0 : -1.0, -1});
+        } else {
+            fused.push_back(instruction);
+        }
+    }
+    program_.swap(fused);
+}
+
+int CompiledPayoff::parameter_index(const std::string& key) {
+    auto it = std::find(parameterKeys_.begin(), parameterKeys_.end(), key);
+    if (it != parameterKeys_.end()) {
+        return static_cast<int>(it - parameterKeys_.begin());
+    }
+    parameterKeys_.push_back(key);
+    return static_cast<int>(parameterKeys_.size()) - 1;
+}
+
+bool CompiledPayoff::compile(const PayoffExpression::Node& node, int depth, Instruction& immediate) {
+    using Kind = PayoffExpression::Kind;
+    maxDepth_ = std::max(maxDepth_, depth + 1);
+
+    auto load = [this](Feature feature, int step) {
+        program_.push_back({Op::Load, feature, step, 0.0, -1});
+        return false;
+    };
+    switch (node.kind) {
+        case Kind::Terminal: return load(Feature::Terminal, 0);
+        case Kind::Initial: return load(Feature::Initial, 0);
+        case Kind::Average: needAverage_ = true; return load(Feature::Average, 0);
+        case Kind::Maximum: needMaximum_ = true; return load(Feature::Maximum, 0);
+        case Kind::Minimum: needMinimum_ = true; return load(Feature::Minimum, 0);
+        case Kind::Step: maxStep_ = std::max(maxStep_, node.step); return load(Feature::Step, node.step);
+        case Kind::Constant:
+            immediate = {Op::Immediate, Feature::Terminal, 0, node.value, -1};
+            return true;
+        case Kind::Parameter:
+            immediate = {Op::Immediate, Feature::Terminal, 0, 0.0, parameter_index(node.key)};
+            return true;
+        case Kind::Neg: {
+            Instruction child{Op::Immediate, Feature::Terminal, 0, 0.0, -1};
+            if (compile(*node.left, depth, child)) {
+                if (child.parameter < 0) {
+                    immediate = child;
+                    immediate.constant = -child.constant;
+                    return true;
+                }
+                program_.push_back(child);
+            }
+            program_.push_back({Op::Neg, Feature::Terminal, 0, 0.0, -1});
+            return false;
+        }
+        default:
+            break;
+    }
+
+    // 二元运算
+    Instruction left{Op::Immediate, Feature::Terminal, 0, 0.0, -1};
+    Instruction right{Op::Immediate, Feature::Terminal, 0, 0.0, -1};
+    const bool leftImmediate = compile(*node.left, depth, left);
+    const bool rightImmediate = compile(*node.right, leftImmediate ? depth : depth + 1, right);
+
+    if (leftImmediate && rightImmediate && left.parameter < 0 && right.parameter < 0) {
+        double a = left.constant;
+        double b = right.constant;
+        double value = 0.0;
+        switch (node.kind) {
+            case Kind::Add: value = a + b; break;
+            case Kind::Sub: value = a - b; break;
+            case Kind::Mul: value = a * b; break;
+            case Kind::Max: value = std::max(a, b); break;
+            case Kind::Min: value = std::min(a, b); break;
+            case Kind::Greater: value = a > b ? 1.0 : 0.0; break;
+            default: break;
+        }
+        immediate = {Op::Immediate, Feature::Terminal, 0, value, -1};
+        return true;
+    }
+
+    auto with_immediate = [this](Op op, const Instruction& operand) {
+        program_.push_back({op, Feature::Terminal, 0, operand.constant, operand.parameter});
+    };
+    if (leftImmediate && rightImmediate) {
+        // 含参数，无法折叠：左侧整列填充后按带立即数的指令处理
+        program_.push_back(left);
+    }
+    if (rightImmediate) {
+        // 左侧在栈顶，x op c
+        switch (node.kind) {
+            case Kind::Add: with_immediate(Op::AddImm, right); break;
+            case Kind::Sub: with_immediate(Op::SubImm, right); break;
+            case Kind::Mul: with_immediate(Op::MulImm, right); break;
+            case Kind::Max: with_immediate(Op::MaxImm, right); break;
+            case Kind::Min: with_immediate(Op::MinImm, right); break;
+            case Kind::Greater: with_immediate(Op::GreaterImm, right); break;
+            default: break;
+        }
+    } else if (leftImmediate) {
+        // 右侧在栈顶，c op x
+        switch (node.kind) {
+            case Kind::Add: with_immediate(Op::AddImm, left); break;
+            case Kind::Sub: with_immediate(Op::RSubImm, left); break;
+            case Kind::Mul: with_immediate(Op::MulImm, left); break;
+            case Kind::Max: with_immediate(Op::MaxImm, left); break;
+            case Kind::Min: with_immediate(Op::MinImm, left); break;
+            case Kind::Greater: with_immediate(Op::LessImm, left); break;
+            default: break;
+        }
+    } else {
+        Op op = Op::Add;
+        switch (node.kind) {
+            case Kind::Add: op = Op::Add; break;
+            case Kind::Sub: op = Op::Sub; break;
+            case Kind::Mul: op = Op::Mul; break;
+            case Kind::Max: op = Op::Max; break;
+            case Kind::Min: op = Op::Min; break;
+            case Kind::Greater: op = Op::Greater; break;
+            default: break;
+        }
+        program_.push_back({op, Feature::Terminal, 0, 0.0, -1});
+    }
+    return false;
+}
+
+void CompiledPayoff::evaluate(const Parameters& params, const Eigen::Ref<const Eigen::MatrixXd>& paths, Eigen::Ref<Eigen::VectorXd> payoffs) const {
+    const Eigen::Index rows = paths.rows();
+    const Eigen::Index cols = paths.cols();
+    if (maxStep_ >= cols) {
+        throw std::runtime_error("CompiledPayoff refers to a step beyond the simulated paths");
+    }
+    Arena& arena = Arena::local();
+    Arena::Scope scope(arena);
+
+    double* parameterValues = arena.allocate_array<double>(std::max<std::size_t>(parameterKeys_.size(), 1));
+    for (std::size_t k = 0; k < parameterKeys_.size(); ++k) {
+        parameterValues[k] = params.get<double>(parameterKeys_[k]);
+    }
+
+    // 一次遍历求出所有需要的路径特征
+    Eigen::Map<Eigen::MatrixXd, Eigen::Aligned64> features = arena.allocate_matrix(rows, 3);
+    auto sum = features.col(0).array();
+    auto maximum = features.col(1).array();
+    auto minimum = features.col(2).array();
+    if (needAverage_) sum = paths.col(0).array();
+    if (needMaximum_) maximum = paths.col(0).array();
+    if (needMinimum_) minimum = paths.col(0).array();
+    if (needAverage_ || needMaximum_ || needMinimum_) {
+        for (Eigen::Index col = 1; col < cols; ++col) {
+            const auto column = paths.col(col).array();
+            if (needAverage_) sum += column;
+            if (needMaximum_) maximum = maximum.max(column);
+            if (needMinimum_) minimum = minimum.min(column);
+        }
+    }
+    if (needAverage_) sum /= static_cast<double>(cols);
+
+    // 路径矩阵的每一列都是连续存储的，特征统一按列首地址引用
+    auto source = [&](const Instruction& instruction) {
+        const double* column = paths.col(cols - 1).data();
+        switch (instruction.feature) {
+            case Feature::Initial: column = paths.col(0).data(); break;
+            case Feature::Average: column = features.col(0).data(); break;
+            case Feature::Maximum: column = features.col(1).data(); break;
+            case Feature::Minimum: column = features.col(2).data(); break;
+            case Feature::Step: column = paths.col(instruction.step).data(); break;
+            case Feature::Terminal: break;
+        }
+        return Eigen::Map<const Eigen::ArrayXd>(column, rows);
+    };
+
+    Eigen::Map<Eigen::MatrixXd, Eigen::Aligned64> stack = arena.allocate_matrix(rows, maxDepth_);
+    int top = -1;
+    for (const Instruction& instruction : program_) {
+        const double value = instruction.parameter >= 0 ? parameterValues[instruction.parameter] : instruction.constant;
+        switch (instruction.op) {
+            case Op::Load: stack.col(++top).array() = source(instruction); break;
+            case Op::LoadCall: stack.col(++top).array() = (source(instruction) - value).max(0.0); break;
+            case Op::LoadPut: stack.col(++top).array() = (value - source(instruction)).max(0.0); break;
+            case Op::AddScaled: --top; stack.col(top) += value * stack.col(top + 1); break;
+            case Op::Immediate: stack.col(++top).setConstant(value); break;
+            case Op::Add: --top; stack.col(top) += stack.col(top + 1); break;
+            case Op::Sub: --top; stack.col(top) -= stack.col(top + 1); break;
+            case Op::Mul: --top; stack.col(top).array() *= stack.col(top + 1).array(); break;
+            case Op::Max: --top; stack.col(top) = stack.col(top).cwiseMax(stack.col(top + 1)); break;
+            case Op::Min: --top; stack.col(top) = stack.col(top).cwiseMin(stack.col(top + 1)); break;
+            case Op::Greater: --top; stack.col(top) = (stack.col(top).array() > stack.col(top + 1).array()).cast<double>().matrix(); break;
+            case Op::AddImm: stack.col(top).array() += value; break;
+            case Op::SubImm: stack.col(top).array() -= value; break;
+            case Op::RSubImm: stack.col(top) = (value - stack.col(top).array()).matrix(); break;
+            case Op::MulImm: stack.col(top) *= value; break;
+            case Op::MaxImm: stack.col(top) = stack.col(top).array().max(value).matrix(); break;
+            case Op::MinImm: stack.col(top) = stack.col(top).array().min(value).matrix(); break;
+            case Op::GreaterImm: stack.col(top) = (stack.col(top).array() > value).cast<double>().matrix(); break;
+            case Op::LessImm: stack.col(top) = (stack.col(top).array() < value).cast<double>().matrix(); break;
+            case Op::Neg: stack.col(top) = -stack.col(top); break;
+        }
+    }
+    payoffs = stack.col(0);
+}
+
+std::string CompiledPayoff::getName() const {
+    return name_;
+}
+
+std::size_t CompiledPayoff::getNumInstructions() const {
+    return program_.size();
+}
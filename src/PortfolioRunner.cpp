@@ -0,0 +1,378 @@
+//
+//  PortfolioRunner.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 同一组的交易共享同一批路径（Pricing::calculateSharedResults）：每轮8个chain各生成一个路径块，组内每笔交易在这批路径上各自计算payoff，
+// 每笔交易有自己的Gelman-Rubin判断，全部收敛（或达到maxSimulations）后整组结束。只有一笔交易的组以及使用重要性抽样的交易
+// （漂移平移量与payoff有关，路径无法共享）直接调用Pricing::calculateResult。所有分组作为任务交给工作窃取调度器，
+// 组内的路径块再作为嵌套任务执行。
+
+# include "PortfolioRunner.hpp"
+# include "ModelParams.hpp"
+# include "MonteCarloSimulator.hpp"
+# include "PricingModel.hpp"
+# include "RateModel.hpp"
+# include "VolatilityModel.hpp"
+# include "AssetPriceModel.hpp"
+# include "Payoff.hpp"
+# include "TransactionCost.hpp"
+# include "SamplingStrategy.hpp"
+# include "ImportanceSampling.hpp"
+# include "TaskScheduler.hpp"
+# include <fstream>
+# include <sstream>
+# include <iostream>
+# include <iomanip>
+# include <memory>
+# include <set>
+# include <chrono>
+# include <stdexcept>
+
+namespace {
+const std::set<std::string> kIntKeys = {"maxSimulations", "seed", "numStrata", "lhsDimensions", "isPilotPaths", "localVolStrikeNodes", "chain_num", "rngChunkSteps"};
+const std::set<std::string> kBoolKeys = {"importanceSampling", "deterministic", "isUpIn", "isDownOut", "isUpOut", "isDownIn", "barrierDiscrete", "quiet", "floatPaths", "payoffDistribution"};
+const std::set<std::string> kStringKeys = {"sampling", "rngPipeline"};
+const std::vector<std::string> kPricingKeys = {"dt", "numSteps", "maxSimulations", "confidenceLevel", "tolerance"};
+
+bool parse_bool(const std::string& text) {
+    if (text == "true" || text == "1") {
+        return true;
+    }
+    if (text == "false" || text == "0") {
+        return false;
+    }
+    throw std::runtime_error("invalid boolean value " + text);
+}
+
+// 整个值都必须是数字，stoi/stod本身会忽略"12abc"后面的字符
+int parse_int(const std::string& text) {
+    size_t used = 0;
+    const int value = std::stoi(text, &used);
+    if (used != text.size()) {
+        throw std::runtime_error("invalid integer value " + text);
+    }
+    return value;
+}
+
+double parse_double(const std::string& text) {
+    size_t used = 0;
+    const double value = std::stod(text, &used);
+    if (used != text.size()) {
+        throw std::runtime_error("invalid number " + text);
+    }
+    return value;
+}
+
+std::unique_ptr<RateModel> make_rate_model(const std::string& name, const Parameters& params) {
+    if (name == "ConstantRateModel") return std::make_unique<ConstantRateModel>(params);
+    if (name == "VasicekModel") return std::make_unique<VasicekModel>(params);
+    if (name == "CIRModel") return std::make_unique<CIRModel>(params);
+    if (name == "HullWhiteModel") return std::make_unique<HullWhiteModel>(params);
+    throw std::runtime_error("Unknown rate model: " + name);
+}
+
+std::unique_ptr<VolatilityModel> make_volatility_model(const std::string& name, const Parameters& params) {
+    if (name == "ConstantVolatilityModel") return std::make_unique<ConstantVolatilityModel>(params);
+    if (name == "LocalVolatilityModel") return std::make_unique<LocalVolatilityModel>(params);
+    if (name == "HestonModel") return std::make_unique<HestonModel>(params);
+    if (name == "SABRModel") return std::make_unique<SABRModel>(params);
+    if (name == "GARCHModel") return std::make_unique<GARCHModel>(params);
+    if (name == "JumpDiffusionModel") return std::make_unique<JumpDiffusionModel>(params);
+    throw std::runtime_error("Unknown volatility model: " + name);
+}
+
+std::unique_ptr<AssetPriceModel> make_asset_model(const std::string& name, const Parameters& params) {
+    if (name == "GeometricBrownianMotionModel") return std::make_unique<GeometricBrownianMotionModel>(params);
+    if (name == "JumpDiffusionPriceModel") return std::make_unique<JumpDiffusionPriceModel>(params);
+    throw std::runtime_error("Unknown asset price model: " + name);
+}
+
+std::unique_ptr<Payoff> make_payoff(const std::string& name) {
+    if (name == "EuropeanCallPayoff") return std::make_unique<EuropeanCallPayoff>();
+    if (name == "EuropeanPutPayoff") return std::make_unique<EuropeanPutPayoff>();
+    if (name == "BarrierPayoff") return std::make_unique<BarrierPayoff>();
+    if (name == "AsianPayoff") return std::make_unique<AsianPayoff>();
+    if (name == "LookbackPayoff") return std::make_unique<LookbackPayoff>();
+    throw std::runtime_error("Unknown payoff: " + name);
+}
+
+// 一组交易共用的模型对象，PricingModel只保存引用，所以这些对象要在整组定价期间存活
+struct GroupModels {
+    std::unique_ptr<RateModel> rateModel;
+    std::unique_ptr<VolatilityModel> volatilityModel;
+    std::unique_ptr<AssetPriceModel> assetModel;
+    std::vector<std::unique_ptr<Payoff>> payoffs;
+    ZeroTransactionCost transactionCost;
+};
+
+// 一组交易在共享路径上的payoff：折现因子每个路径块只算一次，组内每笔交易一个cell
+class TradeGroupEvaluator : public SharedPathEvaluator {
+public:
+    TradeGroupEvaluator(const std::vector<const TradeSpec*>& trades, const GroupModels& models, double dt)
+        : trades_(trades), models_(models), dt_(dt), discountFactors_(Pricing::kNumChains) {}
+
+    std::size_t getNumCells() const override {
+        return trades_.size();
+    }
+
+    void begin_block(int chain, const MonteCarloSimulator& simulator) override {
+        discountFactors_[chain].resize(simulator.get_price_paths().rows());
+        Pricing::calculate_discount_factors(simulator, *models_.rateModel, dt_, discountFactors_[chain]);
+    }
+
+    void evaluate(int chain, const MonteCarloSimulator& simulator, std::size_t cell, Eigen::Ref<Eigen::VectorXd> values) const override {
+        models_.payoffs[cell]->evaluate(trades_[cell]->params, simulator.get_price_paths(), values);
+        values.array() *= discountFactors_[chain].array();
+    }
+
+private:
+    const std::vector<const TradeSpec*>& trades_;
+    const GroupModels& models_;
+    double dt_;
+    std::vector<Eigen::VectorXd> discountFactors_;
+};
+
+// 共享路径的分组定价，由Pricing::calculateSharedResults驱动chain和收敛判断
+std::vector<PricingResult> price_shared_group(const std::vector<const TradeSpec*>& trades, GroupModels& models) {
+    const Parameters& params = trades.front()->params;
+    PricingModel pathModel(*models.rateModel, *models.volatilityModel, *models.assetModel, *models.payoffs.front(), models.transactionCost);
+    TradeGroupEvaluator evaluator(trades, models, params.get<double>("dt"));
+    return Pricing::calculateSharedResults(pathModel, params, evaluator);
+}
+
+// 只影响payoff、不影响路径的字段，分组时忽略：payoff的参数，加上交易编号和障碍期权内层类型在交易文件中的写法
+bool is_payoff_field(const std::string& key) {
+    return key == "trade" || key == "barrierPayoff" || Payoff::getPayoffKeys().count(key) > 0;
+}
+
+bool uses_importance_sampling(const TradeSpec& trade) {
+    return trade.params.contains("importanceSampling") && trade.params.get<bool>("importanceSampling");
+}
+}
+
+PortfolioRunner::PortfolioRunner(const std::string& jobFile) : trades_(read_job_file(jobFile)), elapsedSeconds_(0.0) {}
+
+std::vector<TradeSpec> PortfolioRunner::read_job_file(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open job file: " + path);
+    }
+    std::vector<TradeSpec> trades;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+        std::string token;
+        TradeSpec trade;
+        trade.line = lineNumber;
+        while (tokens >> token) {
+            size_t equals = token.find('=');
+            if (equals == std::string::npos || equals == 0) {
+                throw std::runtime_error("Job file line " + std::to_string(lineNumber) + ": expected key=value, got " + token);
+            }
+            trade.fields[token.substr(0, equals)] = token.substr(equals + 1);
+        }
+        if (trade.fields.empty()) {
+            continue;
+        }
+
+        for (const auto& field : trade.fields) {
+            const std::string& key = field.first;
+            const std::string& value = field.second;
+            try {
+                if (key == "trade") trade.id = value;
+                else if (key == "rateModel") trade.rateModel = value;
+                else if (key == "volatilityModel") trade.volatilityModel = value;
+                else if (key == "assetModel") trade.assetModel = value;
+                else if (key == "payoff") trade.payoff = value;
+                else if (key == "barrierPayoff") trade.params.set<std::string>("payoff", value);
+                else if (kIntKeys.count(key)) trade.params.set<int>(key, parse_int(value));
+                else if (kBoolKeys.count(key)) trade.params.set<bool>(key, parse_bool(value));
+                else if (kStringKeys.count(key)) trade.params.set<std::string>(key, value);
+                else trade.params.set<double>(key, parse_double(value));
+            } catch (const std::exception& e) {
+                throw std::runtime_error("Job file line " + std::to_string(lineNumber) + ": bad value for " + key + " (" + e.what() + ")");
+            }
+        }
+        if (trade.id.empty()) {
+            trade.id = "line" + std::to_string(lineNumber);
+        }
+        trade.params.set<bool>("quiet", true);
+        trades.push_back(std::move(trade));
+    }
+    return trades;
+}
+
+void PortfolioRunner::validate() const {
+    ModelParams modelParams;
+    std::ostringstream problems;
+    std::set<std::string> ids;
+    for (const TradeSpec& trade : trades_) {
+        std::set<std::string> missing;     // 多个模型需要同一个参数时只报告一次
+        std::vector<std::string> unknown;
+        for (const std::string& name : {trade.rateModel, trade.volatilityModel, trade.assetModel, trade.payoff}) {
+            if (name.empty()) {
+                unknown.push_back("(missing model or payoff name)");
+                continue;
+            }
+            try {
+                std::vector<std::string> m = modelParams.checkParams(name, trade.params);
+                missing.insert(m.begin(), m.end());
+            } catch (const std::runtime_error&) {
+                unknown.push_back(name);
+            }
+        }
+        for (const std::string& key : kPricingKeys) {
+            if (!trade.params.contains(key)) {
+                missing.insert(key);
+            }
+        }
+        // 抽样策略（numStrata等）、随机数流水线、重要性抽样需要的参数只有构造时才知道：按定价时的方式构造一遍，不生成路径
+        std::string invalid;
+        if (missing.empty() && unknown.empty()) {
+            try {
+                GroupModels models;
+                models.rateModel = make_rate_model(trade.rateModel, trade.params);
+                models.volatilityModel = make_volatility_model(trade.volatilityModel, trade.params);
+                models.assetModel = make_asset_model(trade.assetModel, trade.params);
+                models.payoffs.push_back(make_payoff(trade.payoff));
+                PricingModel pricingModel(*models.rateModel, *models.volatilityModel, *models.assetModel, *models.payoffs.front(), models.transactionCost);
+                SamplingStrategy::create(trade.params);
+                MonteCarloSimulator simulator(trade.params, pricingModel);
+                if (uses_importance_sampling(trade)) {
+                    ImportanceSampling::initial_drift(pricingModel, trade.params);
+                }
+            } catch (const std::exception& e) {
+                invalid = e.what();
+            }
+        }
+        if (!ids.insert(trade.id).second) {
+            unknown.push_back("duplicate trade id");
+        }
+        if (!missing.empty() || !unknown.empty() || !invalid.empty()) {
+            problems << "trade " << trade.id << " (line " << trade.line << "):";
+            for (const std::string& m : missing) problems << " missing " << m << ";";
+            for (const std::string& u : unknown) problems << " unknown " << u << ";";
+            if (!invalid.empty()) problems << " invalid (" << invalid << ");";
+            problems << "\n";
+        }
+    }
+    if (!problems.str().empty()) {
+        throw std::runtime_error("Job file validation failed:\n" + problems.str());
+    }
+}
+
+std::vector<std::vector<size_t>> PortfolioRunner::group_trades() const {
+    std::map<std::string, std::vector<size_t>> groups;
+    std::vector<std::string> order;
+    for (size_t i = 0; i < trades_.size(); ++i) {
+        const TradeSpec& trade = trades_[i];
+        std::string key;
+        if (uses_importance_sampling(trade)) {
+            key = "#" + trade.id;     // 单独成组
+        } else {
+            for (const auto& field : trade.fields) {
+                if (!is_payoff_field(field.first)) {
+                    key += field.first + "=" + field.second + " ";
+                }
+            }
+        }
+        auto inserted = groups.emplace(key, std::vector<size_t>());
+        if (inserted.second) {
+            order.push_back(key);
+        }
+        inserted.first->second.push_back(i);
+    }
+    // 保持交易文件中的顺序
+    std::vector<std::vector<size_t>> result;
+    for (const std::string& key : order) {
+        result.push_back(groups[key]);
+    }
+    return result;
+}
+
+std::vector<TradeResult> PortfolioRunner::run() {
+    validate();
+    const std::vector<std::vector<size_t>> groups = group_trades();
+    std::vector<TradeResult> results(trades_.size());
+    std::vector<std::string> errors(groups.size());
+
+    auto start = std::chrono::steady_clock::now();
+    TaskGroup taskGroup;
+    for (size_t g = 0; g < groups.size(); ++g) {
+        taskGroup.run([this, g, &groups, &results, &errors]() {
+            const std::vector<size_t>& members = groups[g];
+            const TradeSpec& first = trades_[members.front()];
+            auto groupStart = std::chrono::steady_clock::now();
+            try {
+                GroupModels models;
+                models.rateModel = make_rate_model(first.rateModel, first.params);
+                models.volatilityModel = make_volatility_model(first.volatilityModel, first.params);
+                models.assetModel = make_asset_model(first.assetModel, first.params);
+                std::vector<const TradeSpec*> trades;
+                for (size_t index : members) {
+                    models.payoffs.push_back(make_payoff(trades_[index].payoff));
+                    trades.push_back(&trades_[index]);
+                }
+
+                std::vector<PricingResult> prices;
+                if (members.size() == 1) {
+                    PricingModel pricingModel(*models.rateModel, *models.volatilityModel, *models.assetModel, *models.payoffs.front(), models.transactionCost);
+                    prices.push_back(Pricing::calculateResult(pricingModel, first.params));
+                } else {
+                    prices = price_shared_group(trades, models);
+                }
+
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - groupStart).count();
+                for (size_t k = 0; k < members.size(); ++k) {
+                    TradeResult& result = results[members[k]];
+                    result.id = trades_[members[k]].id;
+                    result.result = prices[k];
+                    result.group = g;
+                    result.groupSize = members.size();
+                    result.groupSeconds = seconds;
+                }
+            } catch (const std::exception& e) {
+                errors[g] = "group of trade " + first.id + ": " + e.what();
+            }
+        });
+    }
+    taskGroup.wait();
+    elapsedSeconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const std::string& error : errors) {
+        if (!error.empty()) {
+            throw std::runtime_error("Portfolio pricing failed: " + error);
+        }
+    }
+    std::cout << "Priced " << trades_.size() << " trades in " << groups.size() << " path groups, "
+              << elapsedSeconds_ << " s (" << getTradesPerSecond() << " trades/s)" << std::endl;
+    return results;
+}
+
+void PortfolioRunner::write_results(const std::string& path, const std::vector<TradeResult>& results) const {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open output file: " + path);
+    }
+    file << "trade,price,lower,upper,standardError,simulations,converged,group,groupSize,groupSeconds\n";
+    file << std::setprecision(10);
+    for (const TradeResult& r : results) {
+        file << r.id << ',' << r.result.price << ',' << r.result.lowerBound << ',' << r.result.upperBound << ','
+             << r.result.standardError << ',' << r.result.numSimulations << ',' << (r.result.converged ? 1 : 0) << ','
+             << r.group << ',' << r.groupSize << ',' << r.groupSeconds << '\n';
+    }
+    file << "# trades=" << results.size() << " seconds=" << elapsedSeconds_ << " tradesPerSecond=" << getTradesPerSecond() << '\n';
+}
+
+double PortfolioRunner::getElapsedSeconds() const {
+    return elapsedSeconds_;
+}
+
+double PortfolioRunner::getTradesPerSecond() const {
+    return elapsedSeconds_ > 0.0 ? trades_.size() / elapsedSeconds_ : 0.0;
+}
@@ -12,6 +12,13 @@
 # include "Payoff.hpp"
 # include "Parameters.hpp"
 # include "PricingModel.hpp"
+# include "ImportanceSampling.hpp"
+# include "SamplingStrategy.hpp"
+# include "TaskScheduler.hpp"
+# include "StatisticsAccumulator.hpp"
+# include "RateModel.hpp"
+# include "YieldCurve.hpp"
+# include "Arena.hpp"
 # include <unordered_map>
 # include <functional>
 # include <memory>
@@ -19,9 +26,50 @@
 # include <cmath>
 # include <iostream>
 # include <algorithm>
+# include <random>
 # include <boost/math/distributions/normal.hpp>
-# include <thread>
-# include <mutex>
+
+namespace {
+struct ChainState {
+    Parameters params;
+    std::unique_ptr<MonteCarloSimulator> simulator;
+    Eigen::VectorXd payoffs;            // 乘上路径权重后的折现payoff，进入Gelman-Rubin的chain
+    Eigen::VectorXd rawPayoffs;         // 不乘路径权重的折现payoff，每轮结束后乘上似然比反馈给自适应抽样
+    Eigen::VectorXd discountFactors;
+    MomentAccumulator block;            // 本轮路径块的矩：确定性模式的汇总，以及每轮的进度
+    std::unique_ptr<QuantileSketch> sketch;     // payoffDistribution为true时该chain的payoff分布
+    std::vector<MomentAccumulator> strataBlocks;    // 分层抽样时本轮每层的矩（乘似然比、不乘抽样权重的折现payoff）
+};
+
+// 共享路径定价的chain：每个cell各有一份块矩、草图和层矩
+struct SharedChain {
+    Parameters params;
+    std::unique_ptr<MonteCarloSimulator> simulator;
+    Eigen::VectorXd payoffs;
+    Eigen::VectorXd samplingPayoffs;            // getSamplingCell的折现payoff乘似然比，反馈给自适应抽样
+    std::vector<MomentAccumulator> blocks;      // 本轮每个cell的块矩
+    std::vector<QuantileSketch> sketches;       // payoffDistribution为true时每个cell的payoff分布
+    std::vector<std::vector<MomentAccumulator>> strataBlocks;   // 分层抽样时本轮每个cell每层的矩
+};
+
+// 给定seed时每个chain用不同但可复现的种子
+Parameters chain_params(const Parameters& params, int chain) {
+    Parameters chainParams = params;
+    if (params.contains("seed")) {
+        std::seed_seq seq{params.get<int>("seed"), chain};
+        std::vector<int> chainSeed(1);
+        seq.generate(chainSeed.begin(), chainSeed.end());
+        chainParams.set<int>("seed", chainSeed[0]);
+    }
+    return chainParams;
+}
+}
+
+void SharedPathEvaluator::begin_block(int, const MonteCarloSimulator&) {}
+
+std::size_t SharedPathEvaluator::getSamplingCell() const {
+    return 0;
+}
 
 double Pricing::calculate_mean(const Eigen::VectorXd& values) {
     return values.mean();
@@ -76,92 +124,423 @@ double Pricing::calculate_gelman_rubin(const std::vector<Eigen::VectorXd>& chain
     return R_hat;
 }
 
+bool Pricing::is_converged(const std::vector<MomentAccumulator>& chains, double tolerance) {
+    double R_hat = calculate_gelman_rubin(chains);
+    std::cout << "Gelman-Rubin 统计量: " << R_hat << std::endl;
+    return std::abs(R_hat - 1) < tolerance;
+}
+
+// 与上面的公式相同（包括用组内标准差作为W），只是8个chain的汇总用固定顺序的标量循环，不依赖Eigen的向量化归约
+double Pricing::calculate_gelman_rubin(const std::vector<MomentAccumulator>& chains) {
+    size_t n_chains = chains.size();
+    double n_samples = chains[0].count();
+
+    double mean_of_means = 0.0;
+    double W = 0.0;
+    for (size_t i = 0; i < n_chains; ++i) {
+        mean_of_means += chains[i].mean();
+        W += chains[i].stdev();
+    }
+    mean_of_means /= n_chains;
+    W /= n_chains;
+
+    double B = 0.0;
+    for (size_t i = 0; i < n_chains; ++i) {
+        B += (chains[i].mean() - mean_of_means) * (chains[i].mean() - mean_of_means);
+    }
+    B = n_samples * B / (n_chains - 1);
+
+    double V_hat = ((n_samples - 1) * W + B) / n_samples;
+    return std::sqrt(V_hat / W);
+}
+
+// 折现因子：对每条路径的短期利率做左端点积分exp(-∫r dt)，积分区间为路径的numSteps个时间步。常数利率时直接用exp(-rT)，避免逐行求和
+Eigen::VectorXd Pricing::calculate_discount_factors(const Eigen::MatrixXd& ratePaths, double dt) {
+    Eigen::VectorXd discountFactors(ratePaths.rows());
+    calculate_discount_factors(ratePaths, dt, discountFactors);
+    return discountFactors;
+}
+
+void Pricing::calculate_discount_factors(const Eigen::Ref<const Eigen::MatrixXd>& ratePaths, double dt, Eigen::Ref<Eigen::VectorXd> discountFactors) {
+    const Eigen::Index numSteps = ratePaths.cols() - 1;
+    if ((ratePaths.array() == ratePaths(0, 0)).all()) {  // 判断是否是constant rate的方法
+        discountFactors.setConstant(std::exp(-ratePaths(0, 0) * numSteps * dt));
+        return;
+    }
+    discountFactors = ratePaths.leftCols(numSteps).rowwise().sum() * dt;
+    discountFactors = (-discountFactors.array()).exp().matrix();
+}
+
+Eigen::VectorXd Pricing::calculate_discount_factors(const MonteCarloSimulator& simulator, const RateModel& rateModel, double dt) {
+    Eigen::VectorXd discountFactors(simulator.get_rate_paths().rows());
+    calculate_discount_factors(simulator, rateModel, dt, discountFactors);
+    return discountFactors;
+}
+
+void Pricing::calculate_discount_factors(const MonteCarloSimulator& simulator, const RateModel& rateModel, double dt, Eigen::Ref<Eigen::VectorXd> discountFactors) {
+    calculate_discount_factors(simulator, rateModel, dt, simulator.get_rate_paths().cols() - 1, discountFactors);
+}
+
+void Pricing::calculate_discount_factors(const MonteCarloSimulator& simulator, const RateModel& rateModel, double dt, Eigen::Index numSteps,
+                                         Eigen::Ref<Eigen::VectorXd> discountFactors) {
+    const CurveGrid* grid = simulator.get_curve_grid();
+    if (grid && rateModel.isDeterministic()) {
+        discountFactors.setConstant(grid->discountFactors(numSteps));
+        return;
+    }
+    if (rateModel.hasIntegratedRate()) {
+        discountFactors = (-simulator.get_integrated_rate_paths().leftCols(numSteps).rowwise().sum().array()).exp().matrix();
+        return;
+    }
+    calculate_discount_factors(simulator.get_rate_paths().leftCols(numSteps + 1), dt, discountFactors);
+}
+
+// 计数排序把路径按层号重排（临时数组从线程的arena中分配），再对每层求矩
+void Pricing::calculate_strata_moments(const Eigen::Ref<const Eigen::VectorXi>& strata, const Eigen::Ref<const Eigen::VectorXd>& values,
+                                       const Eigen::Ref<const Eigen::VectorXd>& likelihoodRatios, std::vector<MomentAccumulator>& moments) {
+    Arena& arena = Arena::local();
+    Arena::Scope scope(arena);
+    const std::size_t numStrata = moments.size();
+    Eigen::Index* offsets = arena.allocate_array<Eigen::Index>(numStrata + 1);
+    std::fill(offsets, offsets + numStrata + 1, 0);
+    for (Eigen::Index i = 0; i < strata.size(); ++i) {
+        ++offsets[strata(i) + 1];
+    }
+    std::partial_sum(offsets, offsets + numStrata + 1, offsets);
+    auto sorted = arena.allocate_vector(strata.size());
+    for (Eigen::Index i = 0; i < strata.size(); ++i) {
+        sorted(offsets[strata(i)]++) = values(i) * likelihoodRatios(i);
+    }
+    // 填充后offsets[k]移到了第k层的末尾，即第k + 1层的起点
+    Eigen::Index begin = 0;
+    for (std::size_t k = 0; k < numStrata; ++k) {
+        moments[k] = MomentAccumulator::from_values(sorted.segment(begin, offsets[k] - begin));
+        begin = offsets[k];
+    }
+}
+
 double Pricing::calculatePrice(const PricingModel& pricingModel, const Parameters& params) {
-    std::vector<Eigen::VectorXd> all_chains(8);  // params.get<int>("chain_num")创建一个有chain_num * 8个动态大小的VectorXd的vector
+    return calculateResult(pricingModel, params).price;
+}
+
+PricingResult Pricing::calculateResult(const PricingModel& pricingModel, const Parameters& params) {
+    return calculateResult(pricingModel, params, nullptr);
+}
+
+PricingResult Pricing::calculateResult(const PricingModel& pricingModel, const Parameters& params, PricingMonitor* monitor) {
+    std::vector<Eigen::VectorXd> all_chains(kNumChains);  // params.get<int>("chain_num")创建一个有chain_num * 8个动态大小的VectorXd的vector
     int num_simulations = 0;
 
     double confidence_level = params.get<double>("confidenceLevel");
     double tolerance = params.get<double>("tolerance");  // 允许设置的精度阈值
+    const bool verbose = !(params.contains("quiet") && params.get<bool>("quiet"));
+
+    // 重要性抽样：在正式模拟前用试算路径确定漂移平移量，之后每条路径的折现payoff乘以似然比
+    double driftShift = 0.0;
+    if (params.contains("importanceSampling") && params.get<bool>("importanceSampling")) {
+        driftShift = ImportanceSampling::optimal_drift(pricingModel, params);
+        if (verbose) {
+            std::cout << "Importance sampling drift shift: " << driftShift << std::endl;
+        }
+    }
+    // 抽样策略在各线程之间共享（generate为const），自适应分层的更新只在每轮结束后由主线程完成
+    std::unique_ptr<SamplingStrategy> sampling = SamplingStrategy::create(params);
+    // 分层抽样时按层累计矩，置信区间用分层估计量的方差（所有路径混在一起的方差包含层间方差，会高估误差）
+    const std::vector<double> strataProbabilities = sampling->getStrataProbabilities();
+    StratifiedAccumulator strataMoments(strataProbabilities);
+
+    // 确定性模式：路径块的划分和种子本来就只由(seed, chain序号)决定，这里再让所有归约与线程数、SIMD宽度无关：
+    // 块内成对求和，块之间按(轮次, chain序号)的固定顺序树形合并。同一个seed在任何机器、任何线程数下得到逐位相同的价格
+    const bool deterministic = params.contains("deterministic") && params.get<bool>("deterministic");
+    if (deterministic && !params.contains("seed")) {
+        throw std::runtime_error("Deterministic pricing requires a seed");
+    }
+    std::vector<TreeAccumulator> chainMoments(kNumChains);
+    TreeAccumulator totalMoments;
+    const bool trackDistribution = params.contains("payoffDistribution") && params.get<bool>("payoffDistribution");
+    const double compression = params.contains("quantileCompression") ? params.get<double>("quantileCompression") : 200.0;
+
+    // 每个chain的参数副本、模拟器和payoff缓冲区只在开始时创建一次，之后每轮复用，路径块的模拟、payoff和折现都不再分配内存
+    std::vector<ChainState> chains(kNumChains);
+    for (int i = 0; i < kNumChains; ++i) {
+        chains[i].params = chain_params(params, i); // 在每个chain中创建params的副本
+        chains[i].simulator = std::make_unique<MonteCarloSimulator>(chains[i].params, pricingModel);
+        chains[i].simulator->set_drift_shift(driftShift);
+        chains[i].simulator->set_sampling_strategy(sampling.get());
+        chains[i].payoffs.resize(MonteCarloSimulator::kBlockPaths);
+        chains[i].rawPayoffs.resize(MonteCarloSimulator::kBlockPaths);
+        chains[i].discountFactors.resize(MonteCarloSimulator::kBlockPaths);
+        if (trackDistribution) {
+            chains[i].sketch = std::make_unique<QuantileSketch>(compression);
+        }
+        if (!strataProbabilities.empty()) {
+            chains[i].strataBlocks.resize(strataProbabilities.size());
+        }
+    }
+    const double dt = params.get<double>("dt");
+    PricingResult result;
+    result.converged = false;
 
     while (num_simulations < params.get<int>("maxSimulations")) {
-        std::vector<std::thread> threads;
-        std::vector<Eigen::VectorXd> payoffs(8, Eigen::VectorXd(200));
-        
-        // 使用8个线程并行生成路径
-        for (int i = 0; i < 8; ++i) {
-            threads.emplace_back([&payoffs, i, &pricingModel, &params]() {  // 这句语法意味着每个for循环对应着一个新建的线程，
-                Parameters local_params = params; // 在每个线程中创建params的副本
-                MonteCarloSimulator simulator(local_params, pricingModel);
+        TaskGroup group;
+
+        // kNumChains个chain各生成一个路径块，作为任务交给工作窃取调度器。调用方本身处在另一个任务中（例如希腊字母的bump）时同样适用
+        for (int i = 0; i < kNumChains; ++i) {
+            group.run([&chain = chains[i], &pricingModel, dt]() {
+                MonteCarloSimulator& simulator = *chain.simulator;
                 simulator.generate_paths();
-                const Eigen::MatrixXd& pricePaths = simulator.get_price_paths();
-                const Eigen::MatrixXd& ratePaths = simulator.get_rate_paths();
-                payoffs[i] = pricingModel.getPayoff()(local_params, pricePaths);
-
-                Eigen::VectorXd discountFactors = Eigen::VectorXd::Ones(200);
-                if (ratePaths.size() > 1 && (ratePaths.array() == ratePaths(0, 0)).all()) {  // 判断是否是constant rate的方法
-                    double rate = ratePaths(0, 0);
-                    discountFactors = Eigen::VectorXd::Constant(200, std::exp(-rate * pricePaths.cols() * local_params.get<double>("dt")));
-                } else {
-                    Eigen::VectorXd accumulatedRate = ratePaths.rowwise().sum() * local_params.get<double>("dt");
-                    discountFactors = accumulatedRate.array().exp().matrix();
+                pricingModel.getPayoff().evaluate(chain.params, simulator.get_price_paths(), chain.rawPayoffs);
+                calculate_discount_factors(simulator, pricingModel.getRateModel(), dt, chain.discountFactors);
+                chain.rawPayoffs.array() *= chain.discountFactors.array();
+                chain.payoffs = chain.rawPayoffs.cwiseProduct(simulator.get_path_weights());
+                chain.block = MomentAccumulator::from_values(chain.payoffs);
+                if (chain.sketch) {
+                    chain.sketch->add(chain.rawPayoffs, simulator.get_path_weights());
+                }
+                if (!chain.strataBlocks.empty()) {
+                    calculate_strata_moments(simulator.get_strata(), chain.rawPayoffs, simulator.get_likelihood_ratios(), chain.strataBlocks);
                 }
-
-                payoffs[i] = payoffs[i].array() * discountFactors.array();
             });
         }
 
-        // 等待所有线程完成
-        for (auto& thread : threads) {
-            thread.join();
+        // 等待所有路径块完成（等待期间当前线程也会执行任务）
+        group.wait();
+        // 自适应分配反馈的是乘上似然比的折现payoff（与层内矩一致），重要性抽样下按Q测度的层内标准差分配
+        for (int i = 0; i < kNumChains; ++i) {
+            chains[i].rawPayoffs.array() *= chains[i].simulator->get_likelihood_ratios().array();
+            sampling->update(chains[i].simulator->get_strata(), chains[i].rawPayoffs);
+            if (!strataMoments.empty()) {
+                strataMoments.add(chains[i].strataBlocks);
+            }
         }
 
 /*        // 将所有线程生成的 payoffs 合并到 all_chains
         for (int chain_idx = 0; chain_idx < params.get<int>("chain_num"); ++chain_idx) {
-            for (int i = 0; i < 8; ++i) {
+            for (int i = 0; i < kNumChains; ++i) {
                 all_chains[chain_idx].conservativeResize(all_chains[chain_idx].size() + payoffs[i].size());
                 all_chains[chain_idx].tail(payoffs[i].size()) = payoffs[i];
             }
         }
 */
-        for (int i = 0; i < 8; ++i) {
-            all_chains[i].conservativeResize(all_chains[i].size() + payoffs[i].size());
-            all_chains[i].tail(payoffs[i].size()) = payoffs[i];
+        num_simulations += kNumChains * MonteCarloSimulator::kBlockPaths;  // 每轮每个chain增加一个路径块
+
+        // 非确定性模式下totalMoments只用来给monitor报告进度，没有monitor时不需要
+        if (deterministic || monitor) {
+            for (int i = 0; i < kNumChains; ++i) {
+                totalMoments.add(chains[i].block);
+            }
+        }
+        // 容差可以由monitor在运行中收紧。打印收敛过程时由is_converged输出R_hat；monitor需要R_hat报告进度
+        const double current_tolerance = monitor ? monitor->tolerance(tolerance) : tolerance;
+        double r_hat = 0.0;
+        auto check_convergence = [&](const auto& chainData) {
+            if (verbose) {
+                if (monitor) {
+                    r_hat = calculate_gelman_rubin(chainData);
+                }
+                return is_converged(chainData, current_tolerance);
+            }
+            r_hat = calculate_gelman_rubin(chainData);
+            return std::abs(r_hat - 1) < current_tolerance;
+        };
+        bool converged = false;
+        if (deterministic) {
+            std::vector<MomentAccumulator> moments(kNumChains);
+            for (int i = 0; i < kNumChains; ++i) {
+                chainMoments[i].add(chains[i].block);
+                moments[i] = chainMoments[i].result();
+            }
+            converged = check_convergence(moments);
+        } else {
+            for (int i = 0; i < kNumChains; ++i) {
+                all_chains[i].conservativeResize(all_chains[i].size() + chains[i].payoffs.size());
+                all_chains[i].tail(chains[i].payoffs.size()) = chains[i].payoffs;
+            }
+            converged = check_convergence(all_chains);
         }
 
-        num_simulations += 1600;  // 每次增加800个样本
+        bool keep_running = true;
+        if (monitor) {
+            const MomentAccumulator total = totalMoments.result();
+            PricingProgress progress;
+            progress.numSimulations = num_simulations;
+            progress.price = total.mean();
+            progress.standardError = strataMoments.empty() ? total.stdev() / std::sqrt(total.count()) : strataMoments.standardError();
+            progress.gelmanRubin = r_hat;
+            progress.converged = converged;
+            keep_running = monitor->on_progress(progress);
+        }
 
-        if (is_converged(all_chains, tolerance)) {
-            std::cout << "Converged after " << num_simulations << " simulations." << std::endl;
+        if (converged) {
+            if (verbose) {
+                std::cout << "Converged after " << num_simulations << " simulations." << std::endl;
+            }
+            result.converged = true;
+            break;
+        }
+        if (!keep_running) {
+            if (verbose) {
+                std::cout << "Stopped after " << num_simulations << " simulations." << std::endl;
+            }
             break;
         }
     }
 
-    if (num_simulations >= params.get<int>("maxSimulations")) {
+    if (num_simulations >= params.get<int>("maxSimulations") && !result.converged && verbose) {
         std::cout << "Reached maximum number of simulations without convergence." << std::endl;
     }
 
     // GR方法可以设置多组蒙特卡罗模拟，一般至少要3组。通过每次给每组增加200个样本，逐渐找到某个精度水平的收敛所要求的最小样本数量。主要的思想依据是组内方差和组间方差相似之后代表着样本量足够大了。一般要求R<=1.1，此时认为收敛，否则认为不收敛。
     // 汇总所有样本
-    std::vector<double> all_payoffs;
-    for (const auto& chain : all_chains) {
-        all_payoffs.insert(all_payoffs.end(), chain.data(), chain.data() + chain.size());
-    }
+    double mean_price = 0.0;
+    double variance = 0.0;
+    double sample_count = 0.0;
+    if (deterministic) {
+        MomentAccumulator total = totalMoments.result();
+        mean_price = total.mean();
+        variance = total.stdev();
+        sample_count = total.count();
+    } else {
+        std::vector<double> all_payoffs;
+        for (const auto& chain : all_chains) {
+            all_payoffs.insert(all_payoffs.end(), chain.data(), chain.data() + chain.size());
+        }
 
-    Eigen::Map<Eigen::VectorXd> all_payoffs_map(all_payoffs.data(), all_payoffs.size());
-    double mean_price = calculate_mean(all_payoffs_map);
-    double variance = calculate_stdev(all_payoffs_map, mean_price);
+        Eigen::Map<Eigen::VectorXd> all_payoffs_map(all_payoffs.data(), all_payoffs.size());
+        mean_price = calculate_mean(all_payoffs_map);
+        variance = calculate_stdev(all_payoffs_map, mean_price);
+        sample_count = all_payoffs_map.size();
+    }
+    const double standard_error = strataMoments.empty() ? variance / std::sqrt(sample_count) : strataMoments.standardError();
     double z = get_z_value(confidence_level);
-    double half_width = z * variance / std::sqrt(all_payoffs_map.size());
+    double half_width = z * standard_error;
 
     // 打印调试信息。confident interval是所有样本的均值在正态分布假设下的置信区间，可以对定价作出更可靠的范围估计
     double lower_bound = mean_price - half_width;
     double upper_bound = mean_price + half_width;
-    std::cout << "Mean Price: " << mean_price << std::endl;
-    std::cout << "Confidence Interval: [" << lower_bound << ", " << upper_bound << "]" << std::endl;
-    
-    return mean_price;
+    if (verbose) {
+        std::cout << "Mean Price: " << mean_price << std::endl;
+        std::cout << "Confidence Interval: [" << lower_bound << ", " << upper_bound << "]" << std::endl;
+    }
+    // 各chain的草图按chain序号合并，与哪个线程先完成无关
+    if (trackDistribution) {
+        auto distribution = std::make_shared<QuantileSketch>(compression);
+        for (const ChainState& chain : chains) {
+            distribution->merge(*chain.sketch);
+        }
+        if (verbose) {
+            std::cout << "Payoff quantiles: 1% " << distribution->quantile(0.01) << ", 50% " << distribution->quantile(0.5)
+                      << ", 99% " << distribution->quantile(0.99) << ", mean above 99% " << distribution->upper_tail_mean(0.99) << std::endl;
+        }
+        result.distribution = distribution;
+    }
+
+    result.price = mean_price;
+    result.lowerBound = lower_bound;
+    result.upperBound = upper_bound;
+    result.standardError = standard_error;
+    result.numSimulations = num_simulations;
+    return result;
 }
 
+std::vector<PricingResult> Pricing::calculateSharedResults(const PricingModel& pathModel, const Parameters& params, SharedPathEvaluator& evaluator) {
+    const std::size_t numCells = evaluator.getNumCells();
+    const std::size_t samplingCell = evaluator.getSamplingCell();
+    std::unique_ptr<SamplingStrategy> sampling = SamplingStrategy::create(params);
+    const std::vector<double> strataProbabilities = sampling->getStrataProbabilities();
+    const bool trackDistribution = params.contains("payoffDistribution") && params.get<bool>("payoffDistribution");
+    const double compression = params.contains("quantileCompression") ? params.get<double>("quantileCompression") : 200.0;
+
+    std::vector<SharedChain> chains(kNumChains);
+    for (int i = 0; i < kNumChains; ++i) {
+        chains[i].params = chain_params(params, i);
+        chains[i].simulator = std::make_unique<MonteCarloSimulator>(chains[i].params, pathModel);
+        chains[i].simulator->set_sampling_strategy(sampling.get());
+        chains[i].blocks.resize(numCells);
+        if (trackDistribution) {
+            chains[i].sketches.assign(numCells, QuantileSketch(compression));
+        }
+        if (!strataProbabilities.empty()) {
+            chains[i].strataBlocks.assign(numCells, std::vector<MomentAccumulator>(strataProbabilities.size()));
+        }
+    }
+
+    const double tolerance = params.get<double>("tolerance");
+    std::vector<std::vector<TreeAccumulator>> chainMoments(numCells, std::vector<TreeAccumulator>(kNumChains));
+    std::vector<TreeAccumulator> totalMoments(numCells);
+    std::vector<StratifiedAccumulator> strataMoments(numCells, StratifiedAccumulator(strataProbabilities));
+    std::vector<bool> converged(numCells, false);
+    std::size_t numConverged = 0;
+    long numSimulations = 0;
+
+    while (numSimulations < params.get<int>("maxSimulations") && numConverged < numCells) {
+        TaskGroup group;
+        for (int i = 0; i < kNumChains; ++i) {
+            group.run([&chain = chains[i], &evaluator, i, numCells, samplingCell]() {
+                MonteCarloSimulator& simulator = *chain.simulator;
+                simulator.generate_paths();
+                chain.payoffs.resize(simulator.get_price_paths().rows());
+                evaluator.begin_block(i, simulator);
+                for (std::size_t c = 0; c < numCells; ++c) {
+                    evaluator.evaluate(i, simulator, c, chain.payoffs);
+                    if (c == samplingCell) {
+                        chain.samplingPayoffs = chain.payoffs.cwiseProduct(simulator.get_likelihood_ratios());
+                    }
+                    if (!chain.sketches.empty()) {
+                        chain.sketches[c].add(chain.payoffs, simulator.get_path_weights());
+                    }
+                    if (!chain.strataBlocks.empty()) {
+                        calculate_strata_moments(simulator.get_strata(), chain.payoffs, simulator.get_likelihood_ratios(), chain.strataBlocks[c]);
+                    }
+                    chain.payoffs.array() *= simulator.get_path_weights().array();
+                    chain.blocks[c] = MomentAccumulator::from_values(chain.payoffs);
+                }
+            });
+        }
+        group.wait();
+        for (int i = 0; i < kNumChains; ++i) {
+            sampling->update(chains[i].simulator->get_strata(), chains[i].samplingPayoffs);
+        }
+        numSimulations += kNumChains * MonteCarloSimulator::kBlockPaths;
+
+        for (std::size_t c = 0; c < numCells; ++c) {
+            std::vector<MomentAccumulator> moments(kNumChains);
+            for (int i = 0; i < kNumChains; ++i) {
+                chainMoments[c][i].add(chains[i].blocks[c]);
+                totalMoments[c].add(chains[i].blocks[c]);
+                moments[i] = chainMoments[c][i].result();
+                if (!strataMoments[c].empty()) {
+                    strataMoments[c].add(chains[i].strataBlocks[c]);
+                }
+            }
+            if (!converged[c] && std::abs(calculate_gelman_rubin(moments) - 1) < tolerance) {
+                converged[c] = true;
+                ++numConverged;
+            }
+        }
+    }
+
+    const double z = get_z_value(params.get<double>("confidenceLevel"));
+    std::vector<PricingResult> results(numCells);
+    for (std::size_t c = 0; c < numCells; ++c) {
+        const MomentAccumulator total = totalMoments[c].result();
+        PricingResult& result = results[c];
+        result.price = total.mean();
+        result.standardError = strataMoments[c].empty() ? total.stdev() / std::sqrt(total.count()) : strataMoments[c].standardError();
+        result.lowerBound = result.price - z * result.standardError;
+        result.upperBound = result.price + z * result.standardError;
+        result.numSimulations = numSimulations;
+        result.converged = converged[c];
+        if (trackDistribution) {
+            auto distribution = std::make_shared<QuantileSketch>(compression);
+            for (const SharedChain& chain : chains) {
+                distribution->merge(chain.sketches[c]);
+            }
+            result.distribution = distribution;
+        }
+    }
+    return results;
+}
 
 // 因为理论上随着数据增加数据的均值和方差对应的正态分布应该可以找到数据的95%数据量的区间，那么如何设计这个收敛条件？正式的方法是GR
 // 主要编写thread内容
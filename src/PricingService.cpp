@@ -0,0 +1,196 @@
+//
+//  PricingService.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+
+# include "PricingService.hpp"
+# include "PricingModel.hpp"
+# include <limits>
+# include <cmath>
+# include <algorithm>
+
+// 请求的共享状态，同时作为Pricing::calculateResult的monitor：句柄在调用方线程上写入，定价任务每轮读取一次
+struct PricingHandle::State : public PricingMonitor {
+    std::function<void(const PricingProgress&)> onProgress;
+    CancellationToken token;
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> deadlineReached{false};
+    std::atomic<double> requestedTolerance{std::numeric_limits<double>::quiet_NaN()};   // NaN表示使用params中的tolerance
+    std::atomic<std::chrono::steady_clock::rep> deadline{std::chrono::steady_clock::time_point::max().time_since_epoch().count()};
+    std::atomic<PricingStatus> status{PricingStatus::Queued};
+    mutable std::mutex mutex;
+    PricingProgress progress = {0, 0.0, 0.0, 0.0, false};
+
+    bool is_cancelled() const {
+        return cancelled.load() || token.is_cancelled();
+    }
+
+    bool on_progress(const PricingProgress& latest) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            progress = latest;
+        }
+        if (onProgress) {
+            onProgress(latest);
+        }
+        if (is_cancelled()) {
+            return false;
+        }
+        if (std::chrono::steady_clock::now().time_since_epoch().count() >= deadline.load()) {
+            deadlineReached = true;
+            return false;
+        }
+        return true;
+    }
+
+    double tolerance(double requested) override {
+        const double current = requestedTolerance.load();
+        return std::isnan(current) ? requested : current;
+    }
+};
+
+CancellationToken::CancellationToken() : cancelled_(std::make_shared<std::atomic<bool>>(false)) {}
+
+void CancellationToken::cancel() {
+    cancelled_->store(true);
+}
+
+bool CancellationToken::is_cancelled() const {
+    return cancelled_->load();
+}
+
+PricingResult PricingHandle::get() const {
+    return result_.get();
+}
+
+std::future_status PricingHandle::wait_for(std::chrono::milliseconds timeout) const {
+    return result_.wait_for(timeout);
+}
+
+void PricingHandle::cancel() {
+    state_->cancelled = true;
+}
+
+void PricingHandle::set_tolerance(double tolerance) {
+    if (!(tolerance > 0.0)) {
+        throw std::runtime_error("Pricing tolerance must be positive");
+    }
+    state_->requestedTolerance = tolerance;
+}
+
+void PricingHandle::set_deadline(std::chrono::steady_clock::time_point deadline) {
+    state_->deadline = deadline.time_since_epoch().count();
+}
+
+PricingStatus PricingHandle::getStatus() const {
+    return state_->status.load();
+}
+
+PricingProgress PricingHandle::getProgress() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->progress;
+}
+
+PricingService::PricingService(unsigned int numRequestThreads) {
+    for (unsigned int i = 0; i < std::max(numRequestThreads, 1u); ++i) {
+        threads_.emplace_back(&PricingService::run_requests, this);
+    }
+}
+
+PricingService::~PricingService() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        for (const auto& weak : states_) {
+            if (auto state = weak.lock()) {
+                state->cancelled = true;
+            }
+        }
+    }
+    available_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+// 排队的请求在停止前也会被取出执行：已取消的请求直接以PricingCancelled结束，保证每个future都会就绪
+void PricingService::run_requests() {
+    while (true) {
+        std::function<void()> request;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            available_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            request = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        request();
+    }
+}
+
+PricingHandle PricingService::submit(const PricingModel& pricingModel, const Parameters& params, const PricingRequestOptions& options) {
+    auto state = std::make_shared<PricingHandle::State>();
+    state->onProgress = options.onProgress;
+    state->token = options.cancellation;
+    state->deadline = options.deadline.time_since_epoch().count();
+    auto promise = std::make_shared<std::promise<PricingResult>>();
+
+    PricingHandle handle;
+    handle.state_ = state;
+    handle.result_ = promise->get_future().share();
+
+    Parameters requestParams = params;
+    requestParams.set<bool>("quiet", true);
+    const PricingModel* model = &pricingModel;
+    std::function<void()> request = [state, promise, model, requestParams]() {
+        // 排队期间已经取消的请求不再开始
+        if (state->is_cancelled()) {
+            state->status = PricingStatus::Cancelled;
+            promise->set_exception(std::make_exception_ptr(PricingCancelled()));
+            return;
+        }
+        state->status = PricingStatus::Running;
+        try {
+            PricingResult result = Pricing::calculateResult(*model, requestParams, state.get());
+            if (!result.converged && state->is_cancelled()) {
+                state->status = PricingStatus::Cancelled;
+                promise->set_exception(std::make_exception_ptr(PricingCancelled()));
+                return;
+            }
+            state->status = result.converged ? PricingStatus::Converged
+                          : state->deadlineReached ? PricingStatus::DeadlineReached : PricingStatus::MaxSimulations;
+            promise->set_value(result);
+        } catch (...) {
+            state->status = PricingStatus::Failed;
+            promise->set_exception(std::current_exception());
+        }
+    };
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            throw std::runtime_error("PricingService is shutting down");
+        }
+        states_.erase(std::remove_if(states_.begin(), states_.end(), [](const std::weak_ptr<PricingHandle::State>& weak) { return weak.expired(); }), states_.end());
+        states_.push_back(state);
+        queue_.push_back(std::move(request));
+    }
+    available_.notify_one();
+    return handle;
+}
+
+std::string PricingService::status_name(PricingStatus status) {
+    switch (status) {
+        case PricingStatus::Queued: return "queued";
+        case PricingStatus::Running: return "running";
+        case PricingStatus::Converged: return "converged";
+        case PricingStatus::MaxSimulations: return "maxSimulations";
+        case PricingStatus::DeadlineReached: return "deadlineReached";
+        case PricingStatus::Cancelled: return "cancelled";
+        case PricingStatus::Failed: return "failed";
+    }
+    return "unknown";
+}
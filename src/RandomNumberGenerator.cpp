@@ -0,0 +1,314 @@
+//
+//  RandomNumberGenerator.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 内核按块处理：每块kLanes个计数器，每个计数器经过10轮Philox得到4个32位整数，拼成2个52位尾数的double。
+// 所有循环都在固定长度的lane数组上进行，没有跨lane依赖，编译器按各自的target自动向量化；x86上三个版本由__builtin_cpu_supports选择，
+// 其他平台（例如ARM的NEON）只编译一个版本。浮点收缩（FMA）被关闭，保证不同指令集下的结果逐位相同（确定性模式依赖这一点）。
+
+# include "RandomNumberGenerator.hpp"
+# include <cmath>
+# include <cstring>
+# include <chrono>
+# include <vector>
+# include <algorithm>
+# include <stdexcept>
+
+# if defined(__clang__)
+#  pragma clang fp contract(off)
+# elif defined(__GNUC__)
+#  pragma GCC optimize("fp-contract=off")
+# endif
+
+# if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#  define DP_RNG_X86_DISPATCH 1
+#  define DP_RNG_TARGET(isa) __attribute__((target(isa)))
+# else
+#  define DP_RNG_X86_DISPATCH 0
+# endif
+
+# if defined(__GNUC__) || defined(__clang__)
+#  define DP_RNG_INLINE inline __attribute__((always_inline))
+// -O3下lane循环会先被完全展开，之后就不再作为循环向量化，这里保留循环交给向量化器
+#  define DP_RNG_LANE_LOOP _Pragma("GCC unroll 1")
+# else
+#  define DP_RNG_INLINE inline
+#  define DP_RNG_LANE_LOOP
+# endif
+
+namespace {
+const std::size_t kLanes = 16;                  // 每块的计数器个数，每块产生2 * kLanes个double
+const std::size_t kBlockDoubles = 2 * kLanes;
+const std::uint32_t kPhiloxM0 = 0xD2511F53u;
+const std::uint32_t kPhiloxM1 = 0xCD9E8D57u;
+const std::uint32_t kPhiloxW0 = 0x9E3779B9u;
+const std::uint32_t kPhiloxW1 = 0xBB67AE85u;
+
+// Acklam逆正态CDF的系数，中心区域为[kLow, 1 - kLow]
+const double kA[6] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02, 1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+const double kB[5] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02, 6.680131188771972e+01, -1.328068155288572e+01};
+const double kC[6] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00, -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+const double kD[4] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00, 3.754408661907416e+00};
+const double kLow = 0.02425;
+
+DP_RNG_INLINE double central_normal(double u) {
+    const double q = u - 0.5;
+    const double r = q * q;
+    return (((((kA[0] * r + kA[1]) * r + kA[2]) * r + kA[3]) * r + kA[4]) * r + kA[5]) * q
+           / (((((kB[0] * r + kB[1]) * r + kB[2]) * r + kB[3]) * r + kB[4]) * r + 1.0);
+}
+
+double tail_normal(double u) {
+    const double p = u < 0.5 ? u : 1.0 - u;
+    const double q = std::sqrt(-2.0 * std::log(p));
+    const double x = (((((kC[0] * q + kC[1]) * q + kC[2]) * q + kC[3]) * q + kC[4]) * q + kC[5])
+                     / ((((kD[0] * q + kD[1]) * q + kD[2]) * q + kD[3]) * q + 1.0);
+    return u < 0.5 ? x : -x;
+}
+
+DP_RNG_INLINE void philox_round(std::uint32_t& x0, std::uint32_t& x1, std::uint32_t& x2, std::uint32_t& x3, std::uint32_t k0, std::uint32_t k1) {
+    const std::uint64_t p0 = static_cast<std::uint64_t>(kPhiloxM0) * x0;
+    const std::uint64_t p1 = static_cast<std::uint64_t>(kPhiloxM1) * x2;
+    const std::uint32_t y0 = static_cast<std::uint32_t>(p1 >> 32) ^ x1 ^ k0;
+    const std::uint32_t y2 = static_cast<std::uint32_t>(p0 >> 32) ^ x3 ^ k1;
+    x1 = static_cast<std::uint32_t>(p1);
+    x3 = static_cast<std::uint32_t>(p0);
+    x0 = y0;
+    x2 = y2;
+}
+
+DP_RNG_INLINE void philox(const std::uint32_t key[2], std::uint32_t stream, std::uint64_t counter, std::uint32_t out[4]) {
+    std::uint32_t x0 = static_cast<std::uint32_t>(counter), x1 = static_cast<std::uint32_t>(counter >> 32), x2 = stream, x3 = 0;
+    std::uint32_t k0 = key[0], k1 = key[1];
+    for (int r = 0; r < 10; ++r) {
+        philox_round(x0, x1, x2, x3, k0, k1);
+        k0 += kPhiloxW0;
+        k1 += kPhiloxW1;
+    }
+    out[0] = x0; out[1] = x1; out[2] = x2; out[3] = x3;
+}
+
+// 52位整数放进[1, 2)的尾数后减1得到[0, 1)，再加2^-53移到(0, 1)，避免inverse_normal(0)
+DP_RNG_INLINE double to_uniform(std::uint32_t hi, std::uint32_t lo) {
+    const std::uint64_t bits = 0x3FF0000000000000ull | (static_cast<std::uint64_t>(hi) << 20) | (lo >> 12);
+    double d;
+    std::memcpy(&d, &bits, sizeof(d));
+    return (d - 1.0) + 0x1.0p-53;
+}
+
+DP_RNG_INLINE void kernel_body(const std::uint32_t key[2], std::uint32_t stream, std::uint64_t counter, double* out, std::size_t numBlocks, bool normal) {
+    for (std::size_t b = 0; b < numBlocks; ++b) {
+        std::uint32_t x0[kLanes], x1[kLanes], x2[kLanes], x3[kLanes];
+        const std::uint64_t base = counter + b * kLanes;
+        DP_RNG_LANE_LOOP
+        for (std::size_t l = 0; l < kLanes; ++l) {
+            x0[l] = static_cast<std::uint32_t>(base + l);
+            x1[l] = static_cast<std::uint32_t>((base + l) >> 32);
+            x2[l] = stream;
+            x3[l] = 0;
+        }
+        std::uint32_t k0 = key[0], k1 = key[1];
+        for (int r = 0; r < 10; ++r) {
+            DP_RNG_LANE_LOOP
+            for (std::size_t l = 0; l < kLanes; ++l) {
+                philox_round(x0[l], x1[l], x2[l], x3[l], k0, k1);
+            }
+            k0 += kPhiloxW0;
+            k1 += kPhiloxW1;
+        }
+
+        double* block = out + b * kBlockDoubles;
+        for (std::size_t l = 0; l < kLanes; ++l) {
+            block[l] = to_uniform(x0[l], x1[l]);
+            block[kLanes + l] = to_uniform(x2[l], x3[l]);
+        }
+        if (normal) {
+            double u[kBlockDoubles];
+            for (std::size_t i = 0; i < kBlockDoubles; ++i) {
+                u[i] = block[i];
+                block[i] = central_normal(u[i]);
+            }
+            for (std::size_t i = 0; i < kBlockDoubles; ++i) {
+                if (u[i] < kLow || u[i] > 1.0 - kLow) {
+                    block[i] = tail_normal(u[i]);
+                }
+            }
+        }
+    }
+}
+
+using Kernel = void (*)(const std::uint32_t key[2], std::uint32_t stream, std::uint64_t counter, double* out, std::size_t numBlocks, bool normal);
+
+void kernel_portable(const std::uint32_t key[2], std::uint32_t stream, std::uint64_t counter, double* out, std::size_t numBlocks, bool normal) {
+    kernel_body(key, stream, counter, out, numBlocks, normal);
+}
+
+# if DP_RNG_X86_DISPATCH
+DP_RNG_TARGET("avx2")
+void kernel_avx2(const std::uint32_t key[2], std::uint32_t stream, std::uint64_t counter, double* out, std::size_t numBlocks, bool normal) {
+    kernel_body(key, stream, counter, out, numBlocks, normal);
+}
+
+DP_RNG_TARGET("avx512f")
+void kernel_avx512(const std::uint32_t key[2], std::uint32_t stream, std::uint64_t counter, double* out, std::size_t numBlocks, bool normal) {
+    kernel_body(key, stream, counter, out, numBlocks, normal);
+}
+# endif
+
+Kernel select_kernel(RandomNumberGenerator::SimdLevel level) {
+# if DP_RNG_X86_DISPATCH
+    if (level == RandomNumberGenerator::SimdLevel::AVX512) return kernel_avx512;
+    if (level == RandomNumberGenerator::SimdLevel::AVX2) return kernel_avx2;
+# endif
+    (void)level;
+    return kernel_portable;         // x86-64上即为SSE2
+}
+
+// seed的高低32位作为Philox的密钥
+void set_key(std::uint64_t seed, std::uint32_t key[2]) {
+    key[0] = static_cast<std::uint32_t>(seed);
+    key[1] = static_cast<std::uint32_t>(seed >> 32);
+}
+}
+
+RandomNumberGenerator::RandomNumberGenerator(std::uint64_t seed, std::uint32_t stream)
+    : RandomNumberGenerator(seed, stream, detect_simd_level()) {}
+
+RandomNumberGenerator::RandomNumberGenerator(std::uint64_t seed, std::uint32_t stream, SimdLevel level)
+    : stream_(stream), counter_(0), level_(level), wordIndex_(4) {
+    if (!is_supported(level)) {
+        throw std::runtime_error("SIMD level " + simd_name(level) + " is not supported on this CPU");
+    }
+    set_key(seed, key_);
+}
+
+RandomNumberGenerator::SimdLevel RandomNumberGenerator::detect_simd_level() {
+# if DP_RNG_X86_DISPATCH
+    if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+#  if defined(__x86_64__)
+    return SimdLevel::SSE2;
+#  endif
+# endif
+    return SimdLevel::Portable;
+}
+
+bool RandomNumberGenerator::is_supported(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Portable:
+            return true;
+# if DP_RNG_X86_DISPATCH
+        case SimdLevel::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case SimdLevel::AVX2:
+            return __builtin_cpu_supports("avx2");
+        case SimdLevel::AVX512:
+            return __builtin_cpu_supports("avx512f");
+# endif
+        default:
+            return false;
+    }
+}
+
+std::string RandomNumberGenerator::simd_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SSE2: return "SSE2";
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::AVX512: return "AVX-512";
+        default: return "Portable";
+    }
+}
+
+RandomNumberGenerator::SimdLevel RandomNumberGenerator::getSimdLevel() const {
+    return level_;
+}
+
+std::uint64_t RandomNumberGenerator::getCounter() const {
+    return counter_;
+}
+
+void RandomNumberGenerator::setCounter(std::uint64_t counter) {
+    counter_ = counter;
+    wordIndex_ = 4;
+}
+
+std::uint64_t RandomNumberGenerator::counters_for(std::size_t n) {
+    return (n + kBlockDoubles - 1) / kBlockDoubles * kLanes;
+}
+
+RandomNumberGenerator::result_type RandomNumberGenerator::operator()() {
+    if (wordIndex_ == 4) {
+        philox(key_, stream_, counter_++, words_);
+        wordIndex_ = 0;
+    }
+    return words_[wordIndex_++];
+}
+
+// 整块直接写入out；最后不足一块的部分先写入栈上的缓冲区再复制，计数器总是按整块前进
+void RandomNumberGenerator::fill(double* out, std::size_t n, bool normal) {
+    const Kernel kernel = select_kernel(level_);
+    const std::size_t fullBlocks = n / kBlockDoubles;
+    kernel(key_, stream_, counter_, out, fullBlocks, normal);
+    counter_ += fullBlocks * kLanes;
+    const std::size_t remainder = n - fullBlocks * kBlockDoubles;
+    if (remainder > 0) {
+        double tail[kBlockDoubles];
+        kernel(key_, stream_, counter_, tail, 1, normal);
+        counter_ += kLanes;
+        std::memcpy(out + fullBlocks * kBlockDoubles, tail, remainder * sizeof(double));
+    }
+}
+
+void RandomNumberGenerator::fill_uniform(double* out, std::size_t n) {
+    fill(out, n, false);
+}
+
+void RandomNumberGenerator::fill_normal(double* out, std::size_t n) {
+    fill(out, n, true);
+}
+
+// 连续存储（例如arena中的矩阵）时一次填满；否则（例如topRows）按整块生成到栈上的缓冲区再按列主序分发，
+// 得到的序列与同样大小的连续矩阵相同，也不会在每列末尾浪费半块
+void RandomNumberGenerator::fill_normal(Eigen::Ref<Eigen::MatrixXd> out) {
+    const std::size_t total = static_cast<std::size_t>(out.size());
+    if (out.outerStride() == out.rows()) {
+        fill(out.data(), total, true);
+        return;
+    }
+    double buffer[32 * kBlockDoubles];
+    const std::size_t rows = static_cast<std::size_t>(out.rows());
+    for (std::size_t done = 0; done < total; ) {
+        const std::size_t chunk = std::min<std::size_t>(32 * kBlockDoubles, total - done);
+        fill(buffer, chunk, true);
+        for (std::size_t i = 0; i < chunk; ++i, ++done) {
+            out(done % rows, done / rows) = buffer[i];
+        }
+    }
+}
+
+double RandomNumberGenerator::normal() {
+    const std::uint32_t hi = (*this)();
+    const std::uint32_t lo = (*this)();
+    return inverse_normal(to_uniform(hi, lo));
+}
+
+double RandomNumberGenerator::inverse_normal(double u) {
+    if (u < kLow || u > 1.0 - kLow) {
+        return tail_normal(u);
+    }
+    return central_normal(u);
+}
+
+double RandomNumberGenerator::benchmark(SimdLevel level, std::size_t count) {
+    RandomNumberGenerator rng(12345, 0, level);
+    std::vector<double> buffer(4096);
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t done = 0; done < count; done += buffer.size()) {
+        rng.fill_normal(buffer.data(), buffer.size());
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const std::size_t generated = (count + buffer.size() - 1) / buffer.size() * buffer.size();
+    return generated / seconds;
+}
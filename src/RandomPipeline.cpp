@@ -0,0 +1,99 @@
+//
+//  RandomPipeline.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+
+# include "RandomPipeline.hpp"
+# include "TaskScheduler.hpp"
+# include <thread>
+# include <algorithm>
+# include <stdexcept>
+
+RandomPipeline::RandomPipeline(Mode mode, int numSlots) : mode_(mode) {
+    if (numSlots < 1) {
+        throw std::runtime_error("RandomPipeline requires at least one slot");
+    }
+    // 交替模式只会用到一个槽位
+    const int count = mode == Mode::Interleaved ? 1 : numSlots;
+    for (int i = 0; i < count; ++i) {
+        slots_.push_back(std::make_unique<Slot>());
+        slots_.back()->ready = -1;
+    }
+}
+
+RandomPipeline::Mode RandomPipeline::getMode() const {
+    return mode_;
+}
+
+std::size_t RandomPipeline::getBufferBytes() const {
+    std::size_t bytes = 0;
+    for (const auto& slot : slots_) {
+        bytes += slot->normals.size() * sizeof(double) + slot->weights.size() * sizeof(double) + slot->strata.size() * sizeof(int);
+    }
+    return bytes;
+}
+
+// 槽位在第一次使用时分配，之后大小不变就不再分配
+void RandomPipeline::reserve(Eigen::Index rows, Eigen::Index cols) {
+    for (auto& slot : slots_) {
+        if (slot->normals.rows() != rows || slot->normals.cols() != cols) {
+            slot->normals.resize(rows, cols);
+            slot->weights.resize(rows);
+            slot->strata.resize(rows);
+        }
+        slot->ready = -1;
+    }
+}
+
+void RandomPipeline::run(long numChunks, Eigen::Index rows, Eigen::Index cols, const Producer& produce, const Consumer& consume) {
+    reserve(rows, cols);
+    const long numSlots = static_cast<long>(slots_.size());
+    if (mode_ == Mode::Interleaved || numChunks == 1) {
+        Slot& slot = *slots_[0];
+        for (long chunk = 0; chunk < numChunks; ++chunk) {
+            produce(chunk, slot);
+            consume(chunk, slot);
+        }
+        return;
+    }
+
+    // failed在group之前声明：consume抛出异常时group先析构并等待所有生产任务结束，任务中引用的局部变量仍然有效
+    std::atomic<bool> failed(false);
+    TaskGroup group;
+    auto submit = [&](long chunk) {
+        Slot& slot = *slots_[chunk % numSlots];
+        group.run([&produce, &failed, &slot, chunk]() {
+            try {
+                produce(chunk, slot);
+            } catch (...) {
+                failed = true;
+                slot.ready.store(chunk, std::memory_order_release);
+                throw;
+            }
+            slot.ready.store(chunk, std::memory_order_release);
+        });
+    };
+
+    for (long chunk = 0; chunk < std::min(numSlots, numChunks); ++chunk) {
+        submit(chunk);
+    }
+    TaskScheduler& scheduler = TaskScheduler::instance();
+    for (long chunk = 0; chunk < numChunks; ++chunk) {
+        Slot& slot = *slots_[chunk % numSlots];
+        while (slot.ready.load(std::memory_order_acquire) != chunk) {
+            if (!scheduler.try_run_one()) {
+                std::this_thread::yield();
+            }
+        }
+        if (failed) {
+            group.wait();       // 重新抛出生产任务中的异常
+        }
+        consume(chunk, slot);
+        if (chunk + numSlots < numChunks) {
+            submit(chunk + numSlots);
+        }
+    }
+    group.wait();
+}
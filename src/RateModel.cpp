@@ -23,29 +23,165 @@
 # include "RateModel.hpp"
 # include <cmath>
 # include <random>
+# include <algorithm>
+# include <stdexcept>
+# include <boost/math/distributions/chi_squared.hpp>
+# include <boost/math/distributions/non_central_chi_squared.hpp>
 # include "Parameters.hpp"
+# include "YieldCurve.hpp"
 
-// 恒定利率模型实现
+bool RateModel::isDeterministic() const {
+    return false;
+}
+
+// 恒定利率模型实现。给定yieldCurve时，模拟器在params中放入该时间网格上的CurveGrid，利率取当前这一步的远期利率（确定性的期限结构）
 ConstantRateModel::ConstantRateModel(const Parameters& params) {}
 
 double ConstantRateModel::getRate(const Parameters& params) const {
+    if (params.contains("curveGrid")) {
+        return params.get<const CurveGrid*>("curveGrid")->forwardRates(params.get<int>("stepIndex") + 1);
+    }
     return params.get<double>("rt");
 }
 
-// Vasicek Model 均值回归随机游走，适用于短期利率，横盘随机游走
-// dr = (v - gamma * r)dt + sigma dW      gamma 是回归速率，v / gamma是均值率
-// return v + (r - v) * exp(- gamma * t) + sigma(Wt - gamma 积分0～t{e^(gamma * (s - t)) * W(s) ds} )
+bool ConstantRateModel::isDeterministic() const {
+    return true;
+}
+
+double RateModel::getIntegratedRate(const Parameters& /*params*/) const {
+    throw std::runtime_error("This rate model does not sample the integrated rate");
+}
+
+bool RateModel::hasIntegratedRate() const {
+    return false;
+}
+
+namespace {
+// OU过程 dx = -kappa * x dt + sigma * dW 在一步dt上的精确转移：
+// x_next = x * e^(-kappa dt) + sdNext * Z1
+// 一步内的积分 I = ∫x ds 与x_next联合正态，E[I] = x * B，B = (1 - e^(-kappa dt)) / kappa，
+// Var(I) = sigma^2 / kappa^2 * (dt - 2B + (1 - e^(-2 kappa dt)) / (2 kappa))，Cov(x_next, I) = sigma^2 / (2 kappa^2) * (1 - e^(-kappa dt))^2
+// 给定x_next后 I = x * B + beta * (x_next - x * e^(-kappa dt)) + condSd * Z2
+struct OrnsteinUhlenbeckStep {
+    double decay;
+    double sdNext;
+    double integralFactor;
+    double beta;
+    double condSdIntegral;
+};
 
-// Cox Ingersoll Ross CIR model dr = (v - gamma * r)dt + sigma r^(1/2) dW             没有解析解的时候则可以采用这里的式子直接用欧拉马尔科夫方法模拟
+OrnsteinUhlenbeckStep ou_step(double kappa, double sigma, double dt) {
+    OrnsteinUhlenbeckStep step;
+    step.decay = std::exp(-kappa * dt);
+    const double varNext = sigma * sigma * (1.0 - step.decay * step.decay) / (2.0 * kappa);
+    step.sdNext = std::sqrt(varNext);
+    step.integralFactor = (1.0 - step.decay) / kappa;
+    const double varIntegral = sigma * sigma / (kappa * kappa) * (dt - 2.0 * step.integralFactor + (1.0 - step.decay * step.decay) / (2.0 * kappa));
+    const double covariance = sigma * sigma / (2.0 * kappa * kappa) * (1.0 - step.decay) * (1.0 - step.decay);
+    step.beta = covariance / varNext;
+    step.condSdIntegral = std::sqrt(std::max(0.0, varIntegral - covariance * step.beta));
+    return step;
+}
+
+double ou_integral(const OrnsteinUhlenbeckStep& step, double x, double xNext, double z) {
+    return x * step.integralFactor + step.beta * (xNext - x * step.decay) + step.condSdIntegral * z;
+}
+}
 
-// Hull-White模型实现
+// Vasicek模型 dr = kappa * (theta - r)dt + sigma * dW，x = r - theta为OU过程，用精确转移，任意步长都没有离散化误差
+VasicekModel::VasicekModel(const Parameters& params)
+    : kappa_VM_(params.get<double>("kappa_VM")), theta_VM_(params.get<double>("theta_VM")), sigma_VM_(params.get<double>("sigma_VM")) {}
+
+double VasicekModel::getRate(const Parameters& params) const {
+    const double dt = params.get<double>("dt");
+    const OrnsteinUhlenbeckStep step = ou_step(kappa_VM_, sigma_VM_, dt);
+    const double x = params.get<double>("rt") - theta_VM_;
+    return theta_VM_ + x * step.decay + step.sdNext * params.get<double>("dW_rate") / std::sqrt(dt);
+}
+
+double VasicekModel::getIntegratedRate(const Parameters& params) const {
+    const double dt = params.get<double>("dt");
+    const OrnsteinUhlenbeckStep step = ou_step(kappa_VM_, sigma_VM_, dt);
+    const double x = params.get<double>("rt") - theta_VM_;
+    const double xNext = params.get<double>("rtNext") - theta_VM_;
+    return theta_VM_ * dt + ou_integral(step, x, xNext, params.get<double>("dW_rateIntegral") / std::sqrt(dt));
+}
+
+bool VasicekModel::hasIntegratedRate() const {
+    return true;
+}
+
+// CIR模型 dr = kappa * (theta - r)dt + sigma * sqrt(r) dW。r_next / c服从自由度d = 4 * kappa * theta / sigma^2、
+// 非中心参数lambda = r * e^(-kappa dt) / c的非中心卡方分布，c = sigma^2 * (1 - e^(-kappa dt)) / (4 * kappa)。
+// 用dW_rate对应的正态分位数做逆变换抽样，保持与其他驱动相同的随机数（对偶、分层仍然有效），利率始终非负
+CIRModel::CIRModel(const Parameters& params)
+    : kappa_CIRM_(params.get<double>("kappa_CIRM")), theta_CIRM_(params.get<double>("theta_CIRM")), sigma_CIRM_(params.get<double>("sigma_CIRM")) {}
+
+double CIRModel::getRate(const Parameters& params) const {
+    const double dt = params.get<double>("dt");
+    const double decay = std::exp(-kappa_CIRM_ * dt);
+    const double c = sigma_CIRM_ * sigma_CIRM_ * (1.0 - decay) / (4.0 * kappa_CIRM_);
+    const double degrees = 4.0 * kappa_CIRM_ * theta_CIRM_ / (sigma_CIRM_ * sigma_CIRM_);
+    const double lambda = std::max(0.0, params.get<double>("rt")) * decay / c;
+
+    // 正态分布函数在尾部取到0或1时分位数无穷大，截断到双精度可以表示的范围
+    double u = 0.5 * std::erfc(-params.get<double>("dW_rate") / std::sqrt(2.0 * dt));
+    u = std::min(std::max(u, 1e-16), 1.0 - 1e-16);
+    // 分位数的求根精度降到10位有效数字，远小于蒙特卡罗误差，速度快数倍
+    typedef boost::math::policies::policy<boost::math::policies::digits10<10>> QuantilePolicy;
+    if (lambda == 0.0) {
+        return c * boost::math::quantile(boost::math::chi_squared_distribution<double, QuantilePolicy>(degrees), u);
+    }
+    return c * boost::math::quantile(boost::math::non_central_chi_squared_distribution<double, QuantilePolicy>(degrees, lambda), u);
+}
+
+// Hull-White模型 dr = (theta(t) - a * r)dt + sigma * dW。写成r = x + alpha(t)，x为从0出发的OU过程，
+// alpha(t) = f(0, t) + sigma^2 / (2a^2) * (1 - e^(-at))^2。x用精确转移；一步内alpha的积分取
+// ln(P(0, t_k) / P(0, t_k+1)) + (V(t_k+1) - V(t_k)) / 2，V(t)为∫x的方差，这样E[exp(-∫r)] = P(0, T)在任何网格上都精确成立。
+// 没有yieldCurve时用水平的初始利率rate作为曲线
 HullWhiteModel::HullWhiteModel(const Parameters& params)
-    : a_HWM_(params.get<double>("a_HWM")), sigma_HWM_(params.get<double>("sigma_HWM")), dt_(params.get<double>("dt")) {}
+    : a_HWM_(params.get<double>("a_HWM")), sigma_HWM_(params.get<double>("sigma_HWM")) {}
+
+double HullWhiteModel::alpha(const Parameters& params, int stepIndex) const {
+    const double dt = params.get<double>("dt");
+    const double forward = params.contains("curveGrid") ? params.get<const CurveGrid*>("curveGrid")->forwardRates(stepIndex) : params.get<double>("rate");
+    const double g = 1.0 - std::exp(-a_HWM_ * stepIndex * dt);
+    return forward + sigma_HWM_ * sigma_HWM_ / (2.0 * a_HWM_ * a_HWM_) * g * g;
+}
+
+double HullWhiteModel::integral_variance(double t) const {
+    const double B = (1.0 - std::exp(-a_HWM_ * t)) / a_HWM_;
+    const double B2 = (1.0 - std::exp(-2.0 * a_HWM_ * t)) / (2.0 * a_HWM_);
+    return sigma_HWM_ * sigma_HWM_ / (a_HWM_ * a_HWM_) * (t - 2.0 * B + B2);
+}
 
 double HullWhiteModel::getRate(const Parameters& params) const {
-    return params.get<double>("rt") * std::exp(-a_HWM_ * dt_ + sigma_HWM_ * params.get<double>("dW_rate")); // 示例实现
+    const double dt = params.get<double>("dt");
+    const int k = params.get<int>("stepIndex");
+    const OrnsteinUhlenbeckStep step = ou_step(a_HWM_, sigma_HWM_, dt);
+    const double x = params.get<double>("rt") - alpha(params, k);
+    return alpha(params, k + 1) + x * step.decay + step.sdNext * params.get<double>("dW_rate") / std::sqrt(dt);
 }
 
+double HullWhiteModel::getIntegratedRate(const Parameters& params) const {
+    const double dt = params.get<double>("dt");
+    const int k = params.get<int>("stepIndex");
+    const OrnsteinUhlenbeckStep step = ou_step(a_HWM_, sigma_HWM_, dt);
+    const double x = params.get<double>("rt") - alpha(params, k);
+    const double xNext = params.get<double>("rtNext") - alpha(params, k + 1);
+
+    double logForward = params.get<double>("rate") * dt;
+    if (params.contains("curveGrid")) {
+        const CurveGrid& grid = *params.get<const CurveGrid*>("curveGrid");
+        logForward = grid.forwardRates(k) * dt;     // 网格上的步长远期利率正好是ln(P_k / P_k+1) / dt
+    }
+    const double alphaIntegral = logForward + 0.5 * (integral_variance((k + 1) * dt) - integral_variance(k * dt));
+    return alphaIntegral + ou_integral(step, x, xNext, params.get<double>("dW_rateIntegral") / std::sqrt(dt));
+}
+
+bool HullWhiteModel::hasIntegratedRate() const {
+    return true;
+}
 
 // 1. ratemodel是否做dt模型
 // 2. MCS中delta gamma vega theta rho的编写。以及是否加入pricepath
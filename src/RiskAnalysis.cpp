@@ -5,5 +5,222 @@
 //  Created by 俊延 on 2024/7/17.
 //
 // VaR
+// 持有期h日用h / 252年计：全量重估时期权剩余期限减少h / 252（包含时间价值的衰减），delta-gamma-vega近似不含theta。
+// 情景块之间相互独立，每块的组合盈亏写入各自的位置，结果与线程数无关；蒙特卡罗情景的每块用(seed, 块序号)播种。
 
 #include "RiskAnalysis.hpp"
+#include "BlackScholes.hpp"
+#include "TaskScheduler.hpp"
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+const long kScenarioBlock = 256;
+const double kTradingDays = 252.0;
+const double kMinVolatility = 1e-4;
+
+// 行为日期、列为因子的样本协方差
+Eigen::MatrixXd sample_covariance(const Eigen::MatrixXd& data) {
+    Eigen::MatrixXd centered = data.rowwise() - data.colwise().mean();
+    return centered.transpose() * centered / static_cast<double>(data.rows() - 1);
+}
+}
+
+RiskAnalysis::RiskAnalysis(const std::vector<RiskPosition>& positions, const Eigen::VectorXd& spots, const Parameters& params)
+    : positions_(positions), spots_(spots), rate_(params.get<double>("rate")), confidenceLevel_(params.get<double>("confidenceLevel")),
+      horizonDays_(params.contains("varHorizonDays") ? params.get<int>("varHorizonDays") : 1) {
+    if (horizonDays_ < 1 || confidenceLevel_ <= 0.0 || confidenceLevel_ >= 1.0) {
+        throw std::runtime_error("RiskAnalysis requires varHorizonDays >= 1 and 0 < confidenceLevel < 1");
+    }
+    if (params.contains("seed")) {
+        seed_ = static_cast<unsigned int>(params.get<int>("seed"));
+    } else {
+        std::random_device rd;
+        seed_ = rd();
+    }
+    basePrices_.resize(positions_.size());
+    baseGreeks_.resize(positions_.size());
+    for (std::size_t i = 0; i < positions_.size(); ++i) {
+        const RiskPosition& position = positions_[i];
+        if (position.underlying < 0 || position.underlying >= spots_.size()) {
+            throw std::runtime_error("RiskPosition refers to an unknown underlying");
+        }
+        if (position.useGreeks) {
+            baseGreeks_[i] = position.greeks;
+        } else {
+            baseGreeks_[i] = BlackScholes::greeks(position.isCall, spots_(position.underlying), position.strike, rate_, position.volatility, position.maturity);
+        }
+        basePrices_[i] = baseGreeks_[i].price;
+    }
+}
+
+void RiskAnalysis::set_historical_scenarios(const Eigen::MatrixXd& dailyReturns, const Eigen::MatrixXd& dailyVolatilityChanges) {
+    const long numDays = dailyReturns.rows();
+    if (dailyReturns.cols() != spots_.size() || numDays < horizonDays_) {
+        throw std::runtime_error("Historical returns must have one column per underlying and at least varHorizonDays rows");
+    }
+    const bool hasVolatility = dailyVolatilityChanges.size() > 0;
+    if (hasVolatility && (dailyVolatilityChanges.rows() != numDays || dailyVolatilityChanges.cols() != spots_.size())) {
+        throw std::runtime_error("Historical volatility changes must have the same shape as the returns");
+    }
+
+    // 重叠的h日累计值用前缀和计算
+    const long numScenarios = numDays - horizonDays_ + 1;
+    auto overlapping_sums = [this, numDays, numScenarios](const Eigen::MatrixXd& daily) {
+        Eigen::MatrixXd prefix = Eigen::MatrixXd::Zero(numDays + 1, daily.cols());
+        for (long t = 0; t < numDays; ++t) {
+            prefix.row(t + 1) = prefix.row(t) + daily.row(t);
+        }
+        return Eigen::MatrixXd(prefix.bottomRows(numScenarios) - prefix.topRows(numScenarios));
+    };
+    spotScenarios_ = overlapping_sums(dailyReturns);
+    volatilityScenarios_ = hasVolatility ? overlapping_sums(dailyVolatilityChanges) : Eigen::MatrixXd::Zero(numScenarios, spots_.size());
+}
+
+void RiskAnalysis::set_monte_carlo_scenarios(const Eigen::MatrixXd& dailyReturns, long numScenarios, const Eigen::MatrixXd& dailyVolatilityChanges) {
+    const long numUnderlyings = spots_.size();
+    if (dailyReturns.cols() != numUnderlyings || dailyReturns.rows() < 2 || numScenarios < 1) {
+        throw std::runtime_error("Monte Carlo scenarios need daily returns with one column per underlying and numScenarios >= 1");
+    }
+    const bool hasVolatility = dailyVolatilityChanges.size() > 0;
+    if (hasVolatility && (dailyVolatilityChanges.rows() != dailyReturns.rows() || dailyVolatilityChanges.cols() != numUnderlyings)) {
+        throw std::runtime_error("Volatility changes must have the same shape as the returns");
+    }
+
+    // 收益率和波动率变化一起估计协方差，保留二者的相关性（例如spot下跌时波动率上升）
+    Eigen::MatrixXd factors(dailyReturns.rows(), hasVolatility ? 2 * numUnderlyings : numUnderlyings);
+    factors.leftCols(numUnderlyings) = dailyReturns;
+    if (hasVolatility) {
+        factors.rightCols(numUnderlyings) = dailyVolatilityChanges;
+    }
+    const long numFactors = factors.cols();
+    Eigen::MatrixXd covariance = sample_covariance(factors) * static_cast<double>(horizonDays_);
+    Eigen::LLT<Eigen::MatrixXd> llt(covariance);
+    Eigen::MatrixXd chol;
+    if (llt.info() == Eigen::Success) {
+        chol = llt.matrixL();
+    } else {
+        // 因子共线（例如两个标的完全相关）时协方差半正定，改用特征分解
+        Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigen(covariance);
+        chol = eigen.eigenvectors() * eigen.eigenvalues().cwiseMax(0.0).cwiseSqrt().asDiagonal();
+    }
+
+    Eigen::MatrixXd scenarios(numScenarios, numFactors);
+    const long numBlocks = (numScenarios + kScenarioBlock - 1) / kScenarioBlock;
+    TaskScheduler::instance().parallel_for(0, numBlocks, 1, [&](long b) {
+        const long begin = b * kScenarioBlock;
+        const long count = std::min(kScenarioBlock, numScenarios - begin);
+        std::seed_seq seq{seed_, static_cast<unsigned int>(b)};
+        std::mt19937 gen(seq);
+        std::normal_distribution<> dis(0.0, 1.0);
+        Eigen::MatrixXd z = Eigen::MatrixXd::NullaryExpr(count, numFactors, [&]() { return dis(gen); });
+        scenarios.middleRows(begin, count) = z * chol.transpose();
+    });
+
+    spotScenarios_ = scenarios.leftCols(numUnderlyings);
+    volatilityScenarios_ = hasVolatility ? Eigen::MatrixXd(scenarios.rightCols(numUnderlyings)) : Eigen::MatrixXd::Zero(numScenarios, numUnderlyings);
+}
+
+void RiskAnalysis::check_scenarios() const {
+    if (spotScenarios_.rows() == 0) {
+        throw std::runtime_error("RiskAnalysis has no scenarios; call set_historical_scenarios or set_monte_carlo_scenarios first");
+    }
+}
+
+Eigen::MatrixXd RiskAnalysis::shocked_spots(const Eigen::Ref<const Eigen::MatrixXd>& spotShocks) const {
+    return spotShocks.array().exp().matrix() * spots_.asDiagonal();
+}
+
+void RiskAnalysis::position_pnl(std::size_t index, const Eigen::Ref<const Eigen::MatrixXd>& shockedSpots, const Eigen::Ref<const Eigen::MatrixXd>& volatilityShocks,
+                                RevaluationMethod method, Eigen::Ref<Eigen::ArrayXd> pnl) const {
+    const RiskPosition& position = positions_[index];
+    const double spot = spots_(position.underlying);
+    const auto levels = shockedSpots.col(position.underlying).array();
+    const auto volatilityShock = volatilityShocks.col(position.underlying).array();
+
+    if (method == RevaluationMethod::FullRevaluation && !position.useGreeks) {
+        const double remaining = position.maturity - horizonDays_ / kTradingDays;
+        const Eigen::ArrayXd shockedVolatilities = (position.volatility + volatilityShock).max(kMinVolatility);
+        BlackScholes::price(position.isCall, levels, position.strike, rate_, shockedVolatilities, remaining, pnl);
+        pnl = position.quantity * (pnl - basePrices_[index]);
+    } else {
+        const Greeks& greeks = baseGreeks_[index];
+        const Eigen::ArrayXd dS = levels - spot;
+        pnl = position.quantity * (greeks.delta * dS + 0.5 * greeks.gamma * dS.square() + greeks.vega * volatilityShock);
+    }
+}
+
+Eigen::VectorXd RiskAnalysis::scenario_pnl(RevaluationMethod method) const {
+    check_scenarios();
+    const long numScenarios = spotScenarios_.rows();
+    Eigen::VectorXd portfolio(numScenarios);
+    const long numBlocks = (numScenarios + kScenarioBlock - 1) / kScenarioBlock;
+
+    // 每个任务负责一个情景块，逐笔交易累加，交易的盈亏只在块大小的缓冲区中存在
+    TaskScheduler::instance().parallel_for(0, numBlocks, 1, [&](long b) {
+        const long begin = b * kScenarioBlock;
+        const long count = std::min(kScenarioBlock, numScenarios - begin);
+        const Eigen::MatrixXd levels = shocked_spots(spotScenarios_.middleRows(begin, count));
+        Eigen::ArrayXd total = Eigen::ArrayXd::Zero(count);
+        Eigen::ArrayXd pnl(count);
+        for (std::size_t i = 0; i < positions_.size(); ++i) {
+            position_pnl(i, levels, volatilityScenarios_.middleRows(begin, count), method, pnl);
+            total += pnl;
+        }
+        portfolio.segment(begin, count) = total.matrix();
+    });
+    return portfolio;
+}
+
+RiskMeasures RiskAnalysis::calculate(RevaluationMethod method) const {
+    const Eigen::VectorXd pnl = scenario_pnl(method);
+    const long numScenarios = pnl.size();
+
+    // 按损失从大到小，取最差的ceil((1 - c) * N)个情景作为尾部，VaR为尾部中最小的损失
+    const long tailSize = std::max(1L, static_cast<long>(std::ceil((1.0 - confidenceLevel_) * numScenarios - 1e-9)));
+    std::vector<long> order(numScenarios);
+    std::iota(order.begin(), order.end(), 0L);
+    std::nth_element(order.begin(), order.begin() + (tailSize - 1), order.end(), [&pnl](long a, long b) {
+        return pnl(a) < pnl(b) || (pnl(a) == pnl(b) && a < b);
+    });
+    std::vector<long> tail(order.begin(), order.begin() + tailSize);
+    std::sort(tail.begin(), tail.end());
+
+    RiskMeasures measures;
+    measures.numScenarios = numScenarios;
+    measures.horizonDays = horizonDays_;
+    measures.meanPnL = pnl.mean();
+    measures.valueAtRisk = -pnl(order[tailSize - 1]);
+    double tailSum = 0.0;
+    for (long s : tail) {
+        tailSum += pnl(s);
+    }
+    measures.expectedShortfall = -tailSum / tailSize;
+
+    // ES的分解：只对尾部情景重估，按交易分块并行，每笔交易得到尾部平均损失
+    Eigen::MatrixXd tailSpots(tailSize, spotScenarios_.cols());
+    Eigen::MatrixXd tailVolatilities(tailSize, volatilityScenarios_.cols());
+    for (long k = 0; k < tailSize; ++k) {
+        tailSpots.row(k) = spotScenarios_.row(tail[k]);
+        tailVolatilities.row(k) = volatilityScenarios_.row(tail[k]);
+    }
+    const Eigen::MatrixXd tailLevels = shocked_spots(tailSpots);
+    measures.contributions.assign(positions_.size(), 0.0);
+    TaskScheduler::instance().parallel_for(0, static_cast<long>(positions_.size()), 64, [&](long i) {
+        Eigen::ArrayXd positionPnl(tailSize);
+        position_pnl(static_cast<std::size_t>(i), tailLevels, tailVolatilities, method, positionPnl);
+        measures.contributions[i] = -positionPnl.mean();
+    });
+    return measures;
+}
+
+int RiskAnalysis::getHorizonDays() const {
+    return horizonDays_;
+}
+
+const Eigen::MatrixXd& RiskAnalysis::getSpotScenarios() const {
+    return spotScenarios_;
+}
@@ -0,0 +1,222 @@
+//
+//  SamplingStrategy.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 分层抽样：把W_T的分布按概率等分为K层，第k层的终值 W_T = sqrt(T) * Phi^-1((k + U) / K)，再用布朗桥从W_0 = 0和W_T补齐中间各步，
+// 所以路径的边际分布不变，但终值（大部分payoff最敏感的维度）在各层之间被均匀覆盖。
+// 层内样本数按照Neyman分配 n_k 正比于 p_k * sigma_k 自适应调整，每条路径权重为 p_k * N / n_k，保证加权平均无偏。
+// 拉丁超立方：前d个时间步的每一维都把[0, 1]等分为N份，每份恰好一个样本，随机打乱后组合，其余维度伪随机。
+// 对偶变量不再强制使用，作为antithetic策略可选。
+
+# include "SamplingStrategy.hpp"
+# include "Parameters.hpp"
+# include "Arena.hpp"
+# include <algorithm>
+# include <random>
+# include <numeric>
+# include <cmath>
+# include <stdexcept>
+
+namespace {
+// 层内的均匀数可能取到0或者舍入到1，先夹到开区间内，再用与批量内核相同的逆CDF
+double clamped_inverse_normal(double u) {
+    return RandomNumberGenerator::inverse_normal(std::min(std::max(u, 1e-16), 1.0 - 1e-16));
+}
+}
+
+void SamplingStrategy::update(const Eigen::VectorXi& /*strata*/, const Eigen::VectorXd& /*values*/) {}
+
+bool SamplingStrategy::isAntithetic() const {
+    return false;
+}
+
+bool SamplingStrategy::supportsStreaming() const {
+    return false;
+}
+
+std::vector<double> SamplingStrategy::getStrataProbabilities() const {
+    return {};
+}
+
+std::unique_ptr<SamplingStrategy> SamplingStrategy::create(const Parameters& params) {
+    std::string sampling = params.contains("sampling") ? params.get<std::string>("sampling") : "antithetic";
+    if (sampling == "pseudo") {
+        return std::make_unique<PseudoRandomSampling>();
+    } else if (sampling == "antithetic") {
+        return std::make_unique<AntitheticSampling>();
+    } else if (sampling == "stratified") {
+        return std::make_unique<StratifiedSampling>(params.get<int>("numStrata"));
+    } else if (sampling == "latinHypercube") {
+        return std::make_unique<LatinHypercubeSampling>(params.get<int>("lhsDimensions"));
+    } else {
+        throw std::runtime_error("Unknown sampling strategy: " + sampling);
+    }
+}
+
+// 伪随机
+void PseudoRandomSampling::generate(RandomNumberGenerator& rng, Eigen::Index /*numPaths*/, Eigen::Index /*numSteps*/,
+                                    Eigen::Ref<Eigen::MatrixXd> normals, Eigen::Ref<Eigen::VectorXd> weights, Eigen::Ref<Eigen::VectorXi> strata) const {
+    rng.fill_normal(normals);
+    weights.setOnes();
+    strata.setConstant(-1);
+}
+
+bool PseudoRandomSampling::supportsStreaming() const {
+    return true;
+}
+
+std::string PseudoRandomSampling::getName() const {
+    return "PseudoRandomSampling";
+}
+
+// 对偶变量：前一半路径伪随机，后一半取相反数
+void AntitheticSampling::generate(RandomNumberGenerator& rng, Eigen::Index numPaths, Eigen::Index /*numSteps*/,
+                                  Eigen::Ref<Eigen::MatrixXd> normals, Eigen::Ref<Eigen::VectorXd> weights, Eigen::Ref<Eigen::VectorXi> strata) const {
+    if (numPaths % 2 != 0) {
+        throw std::runtime_error("Antithetic sampling requires an even number of paths");
+    }
+    const Eigen::Index half = numPaths / 2;
+    rng.fill_normal(normals.topRows(half));
+    normals.bottomRows(half) = -normals.topRows(half);
+    weights.setOnes();
+    strata.setConstant(-1);
+}
+
+bool AntitheticSampling::isAntithetic() const {
+    return true;
+}
+
+bool AntitheticSampling::supportsStreaming() const {
+    return true;
+}
+
+std::string AntitheticSampling::getName() const {
+    return "AntitheticSampling";
+}
+
+// 终值分层 + 布朗桥
+StratifiedSampling::StratifiedSampling(int numStrata)
+    : numStrata_(numStrata), allocation_(numStrata, 1.0 / numStrata), count_(numStrata, 0.0), sum_(numStrata, 0.0), sum2_(numStrata, 0.0) {
+    if (numStrata < 1) {
+        throw std::runtime_error("numStrata must be positive");
+    }
+}
+
+void StratifiedSampling::generate(RandomNumberGenerator& rng, Eigen::Index numPaths, Eigen::Index numSteps,
+                                  Eigen::Ref<Eigen::MatrixXd> normals, Eigen::Ref<Eigen::VectorXd> weights, Eigen::Ref<Eigen::VectorXi> strata) const {
+    if (numPaths < numStrata_) {
+        throw std::runtime_error("Stratified sampling requires at least numStrata paths per block");
+    }
+    // 每层至少1条路径，剩余的按照allocation_取整，余数给小数部分最大的层。临时数组从线程的arena中分配
+    Arena& arena = Arena::local();
+    Arena::Scope scope(arena);
+    Eigen::Index* counts = arena.allocate_array<Eigen::Index>(numStrata_);
+    double* remainders = arena.allocate_array<double>(numStrata_);
+    int* order = arena.allocate_array<int>(numStrata_);
+    Eigen::Index assigned = numStrata_;
+    const Eigen::Index free = numPaths - numStrata_;
+    for (int k = 0; k < numStrata_; ++k) {
+        double target = allocation_[k] * free;
+        counts[k] = 1 + static_cast<Eigen::Index>(std::floor(target));
+        remainders[k] = target - std::floor(target);
+        assigned += static_cast<Eigen::Index>(std::floor(target));
+    }
+    std::iota(order, order + numStrata_, 0);
+    std::sort(order, order + numStrata_, [&](int a, int b) { return remainders[a] > remainders[b]; });
+    for (int i = 0; assigned < numPaths; ++i, ++assigned) {
+        counts[order[i % numStrata_]] += 1;
+    }
+
+    std::uniform_real_distribution<> uniform(0.0, 1.0);
+
+    // 以sqrt(dt)为单位，T对应numSteps个单位步长，每一步的方差为1
+    const double n = static_cast<double>(numSteps);
+    Eigen::Index row = 0;
+    for (int k = 0; k < numStrata_; ++k) {
+        const double weight = static_cast<double>(numPaths) / (numStrata_ * counts[k]);
+        for (Eigen::Index c = 0; c < counts[k]; ++c, ++row) {
+            const double terminal = std::sqrt(n) * clamped_inverse_normal((k + uniform(rng)) / numStrata_);
+            double previous = 0.0;
+            for (Eigen::Index j = 0; j < numSteps - 1; ++j) {
+                const double remaining = n - j;    // 当前点到终点还剩的步数
+                const double mean = previous + (terminal - previous) / remaining;
+                const double current = mean + std::sqrt((remaining - 1.0) / remaining) * rng.normal();
+                normals(row, j) = current - previous;
+                previous = current;
+            }
+            normals(row, numSteps - 1) = terminal - previous;
+            weights(row) = weight;
+            strata(row) = k;
+        }
+    }
+}
+
+// 累计各层的矩，下一轮按照 p_k * sigma_k 分配，并保留10%的等比例分配，防止某层的方差估计为0后再也得不到样本
+void StratifiedSampling::update(const Eigen::VectorXi& strata, const Eigen::VectorXd& values) {
+    for (Eigen::Index i = 0; i < strata.size(); ++i) {
+        int k = strata(i);
+        if (k < 0 || k >= numStrata_) {
+            continue;
+        }
+        count_[k] += 1.0;
+        sum_[k] += values(i);
+        sum2_[k] += values(i) * values(i);
+    }
+    std::vector<double> sigma(numStrata_, 0.0);
+    double total = 0.0;
+    for (int k = 0; k < numStrata_; ++k) {
+        if (count_[k] > 1.0) {
+            double mean = sum_[k] / count_[k];
+            sigma[k] = std::sqrt(std::max(0.0, (sum2_[k] - count_[k] * mean * mean) / (count_[k] - 1.0)));
+        }
+        total += sigma[k];
+    }
+    if (total <= 0.0) {
+        return;
+    }
+    for (int k = 0; k < numStrata_; ++k) {
+        allocation_[k] = 0.9 * sigma[k] / total + 0.1 / numStrata_;
+    }
+}
+
+// 按概率等分，每层的概率相同
+std::vector<double> StratifiedSampling::getStrataProbabilities() const {
+    return std::vector<double>(numStrata_, 1.0 / numStrata_);
+}
+
+const std::vector<double>& StratifiedSampling::getAllocation() const {
+    return allocation_;
+}
+
+std::string StratifiedSampling::getName() const {
+    return "StratifiedSampling";
+}
+
+// 拉丁超立方
+LatinHypercubeSampling::LatinHypercubeSampling(int dimensions) : dimensions_(dimensions) {}
+
+void LatinHypercubeSampling::generate(RandomNumberGenerator& rng, Eigen::Index numPaths, Eigen::Index numSteps,
+                                      Eigen::Ref<Eigen::MatrixXd> normals, Eigen::Ref<Eigen::VectorXd> weights, Eigen::Ref<Eigen::VectorXi> strata) const {
+    std::uniform_real_distribution<> uniform(0.0, 1.0);
+    rng.fill_normal(normals);
+
+    Arena& arena = Arena::local();
+    Arena::Scope scope(arena);
+    Eigen::Index* permutation = arena.allocate_array<Eigen::Index>(numPaths);
+    const Eigen::Index lhsColumns = std::min<Eigen::Index>(dimensions_, numSteps);
+    for (Eigen::Index j = 0; j < lhsColumns; ++j) {
+        std::iota(permutation, permutation + numPaths, 0);
+        std::shuffle(permutation, permutation + numPaths, rng);
+        for (Eigen::Index i = 0; i < numPaths; ++i) {
+            normals(i, j) = clamped_inverse_normal((permutation[i] + uniform(rng)) / numPaths);
+        }
+    }
+    weights.setOnes();
+    strata.setConstant(-1);
+}
+
+std::string LatinHypercubeSampling::getName() const {
+    return "LatinHypercubeSampling";
+}
@@ -38,37 +38,108 @@
 # include "PricingModel.hpp"
 # include "RateModel.hpp"
 # include "VolatilityModel.hpp"
+# include "Pricing.hpp"
+# include "TaskScheduler.hpp"
+# include "PathBlockStore.hpp"
+# include <random>
+
+// 构造函数实现。spot的bump取1%，volatility的bump取0.01，可以用spotBump和volatilityBump参数覆盖
+SensitivityAnalysis::SensitivityAnalysis(const PricingModel& model, const Parameters& params)
+    : model(model), params(params), spot(params.get<double>("spot")), volatility(params.get<double>("volatility")),
+      spotBump(params.contains("spotBump") ? params.get<double>("spotBump") : 0.01 * params.get<double>("spot")),
+      volatilityBump(params.contains("volatilityBump") ? params.get<double>("volatilityBump") : 0.01) {
+    if (!this->params.contains("seed")) {
+        std::random_device rd;
+        this->params.set<int>("seed", static_cast<int>(rd() >> 1));
+    }
+}
 
-/*
-// 构造函数实现
-SensitivityAnalysis::SensitivityAnalysis(const PricingModel& model, double spot, double strike, double maturity, double volatility)
-    : model(model), spot(spot), strike(strike), maturity(maturity), volatility(volatility) {}
+Parameters SensitivityAnalysis::bumped(const std::string& key, double value, CalculationMethod method, int scenario) const {
+    Parameters scenarioParams = params;
+    scenarioParams.set<double>(key, value);
+    if (method == CalculationMethod::MonteCarlo) {
+        scenarioParams.set<int>("seed", params.get<int>("seed") + 7919 * (scenario + 1));
+    }
+    return scenarioParams;
+}
+
+// 第一个情景按Gelman-Rubin收敛决定路径数，其余情景用完全相同的路径数（容差为0，只在达到maxSimulations时停止），
+// 各情景不会在不同的路径数上停下，差分中不混入收敛判断的噪声。其余情景各作为一个任务，Pricing::calculateResult内部的路径块又是子任务，
+// 由调度器统一均衡。所有情景都不打印收敛过程，避免并行的输出交错
+std::vector<double> SensitivityAnalysis::price_scenarios(const std::vector<Parameters>& scenarios) const {
+    std::vector<double> prices(scenarios.size(), 0.0);
+    Parameters first = scenarios[0];
+    first.set<bool>("quiet", true);
+    const PricingResult firstResult = Pricing::calculateResult(model, first);
+    prices[0] = firstResult.price;
+
+    std::vector<Parameters> fixed(scenarios.begin() + 1, scenarios.end());
+    TaskGroup group;
+    for (size_t i = 0; i < fixed.size(); ++i) {
+        fixed[i].set<bool>("quiet", true);
+        fixed[i].set<double>("tolerance", 0.0);
+        fixed[i].set<int>("maxSimulations", static_cast<int>(firstResult.numSimulations));
+        group.run([this, &fixed, &prices, i]() {
+            prices[i + 1] = Pricing::calculateResult(model, fixed[i]).price;
+        });
+    }
+    group.wait();
+    return prices;
+}
 
 // 计算Delta
 double SensitivityAnalysis::computeDelta(CalculationMethod method) const {
-    if (method == CalculationMethod::FiniteDifference) {
-        return model.computeDeltaFiniteDifference(spot, strike, maturity, volatility);
-    } else {
-        return model.computeDeltaMonteCarlo(spot, strike, maturity, volatility);
-    }
+    std::vector<double> prices = price_scenarios({bumped("spot", spot + spotBump, method, 0), bumped("spot", spot - spotBump, method, 1)});
+    return (prices[0] - prices[1]) / (2 * spotBump);
 }
 
 // 计算Gamma
 double SensitivityAnalysis::computeGamma(CalculationMethod method) const {
-    if (method == CalculationMethod::FiniteDifference) {
-        return model.computeGammaFiniteDifference(spot, strike, maturity, volatility);
-    } else {
-        return model.computeGammaMonteCarlo(spot, strike, maturity, volatility);
-    }
+    std::vector<double> prices = price_scenarios({bumped("spot", spot + spotBump, method, 0), bumped("spot", spot, method, 2), bumped("spot", spot - spotBump, method, 1)});
+    return (prices[0] - 2 * prices[1] + prices[2]) / (spotBump * spotBump);
 }
 
 // 计算Vega
 double SensitivityAnalysis::computeVega(CalculationMethod method) const {
-    if (method == CalculationMethod::FiniteDifference) {
-        return model.computeVegaFiniteDifference(spot, strike, maturity, volatility);
-    } else {
-        return model.computeVegaMonteCarlo(spot, strike, maturity, volatility);
-    }
+    std::vector<double> prices = price_scenarios({bumped("volatility", volatility + volatilityBump, method, 3), bumped("volatility", volatility - volatilityBump, method, 4)});
+    return (prices[0] - prices[1]) / (2 * volatilityBump);
 }
 
-*/
+Greeks SensitivityAnalysis::computeGreeks(CalculationMethod method) const {
+    std::vector<double> prices = price_scenarios({
+        bumped("spot", spot, method, 2),
+        bumped("spot", spot + spotBump, method, 0),
+        bumped("spot", spot - spotBump, method, 1),
+        bumped("volatility", volatility + volatilityBump, method, 3),
+        bumped("volatility", volatility - volatilityBump, method, 4)});
+    Greeks greeks;
+    greeks.price = prices[0];
+    greeks.delta = (prices[1] - prices[2]) / (2 * spotBump);
+    greeks.gamma = (prices[1] - 2 * prices[0] + prices[2]) / (spotBump * spotBump);
+    greeks.vega = (prices[3] - prices[4]) / (2 * volatilityBump);
+    return greeks;
+}
+
+Greeks SensitivityAnalysis::computeGreeks(const PathBlockStore& paths) const {
+    const std::vector<Parameters> scenarios = {
+        bumped("spot", spot, CalculationMethod::FiniteDifference, 2),
+        bumped("spot", spot + spotBump, CalculationMethod::FiniteDifference, 0),
+        bumped("spot", spot - spotBump, CalculationMethod::FiniteDifference, 1),
+        bumped("volatility", volatility + volatilityBump, CalculationMethod::FiniteDifference, 3),
+        bumped("volatility", volatility - volatilityBump, CalculationMethod::FiniteDifference, 4)};
+    std::vector<double> prices(scenarios.size(), 0.0);
+    TaskGroup group;
+    for (size_t i = 0; i < scenarios.size(); ++i) {
+        group.run([&paths, &scenarios, &prices, i]() {
+            prices[i] = paths.price(scenarios[i]).price;
+        });
+    }
+    group.wait();
+
+    Greeks greeks;
+    greeks.price = prices[0];
+    greeks.delta = (prices[1] - prices[2]) / (2 * spotBump);
+    greeks.gamma = (prices[1] - 2 * prices[0] + prices[2]) / (spotBump * spotBump);
+    greeks.vega = (prices[3] - prices[4]) / (2 * volatilityBump);
+    return greeks;
+}
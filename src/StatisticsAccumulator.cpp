@@ -0,0 +1,338 @@
+//
+//  StatisticsAccumulator.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 普通的顺序求和或者Eigen向量化的sum，舍入误差的累积方式取决于数据如何切分、由几条SIMD通道并行累加，
+// 所以同样的seed在笔记本和多核服务器上可能得到末几位不同的价格。这里固定三件事：
+// 1. 块的划分固定（每个路径块200条路径，块序号决定随机数种子）；
+// 2. 块内用成对求和；
+// 3. 块之间的合并树只由块序号决定。
+
+# include "StatisticsAccumulator.hpp"
+# include <cmath>
+# include <limits>
+# include <algorithm>
+# include <stdexcept>
+
+namespace {
+const double kPi = 3.14159265358979323846;
+}
+
+MomentAccumulator::MomentAccumulator() : count_(0.0), mean_(0.0), m2_(0.0) {}
+
+MomentAccumulator MomentAccumulator::from_values(const Eigen::Ref<const Eigen::VectorXd>& values) {
+    MomentAccumulator accumulator;
+    const Eigen::Index n = values.size();
+    if (n == 0) {
+        return accumulator;
+    }
+    accumulator.count_ = static_cast<double>(n);
+    accumulator.mean_ = pairwise_sum(0, n, [&](Eigen::Index i) { return values(i); }) / n;
+    const double mean = accumulator.mean_;
+    accumulator.m2_ = pairwise_sum(0, n, [&](Eigen::Index i) { double d = values(i) - mean; return d * d; });
+    return accumulator;
+}
+
+void MomentAccumulator::merge(const MomentAccumulator& other) {
+    if (other.count_ == 0.0) {
+        return;
+    }
+    if (count_ == 0.0) {
+        *this = other;
+        return;
+    }
+    const double total = count_ + other.count_;
+    const double delta = other.mean_ - mean_;
+    mean_ += delta * other.count_ / total;
+    m2_ += other.m2_ + delta * delta * count_ * other.count_ / total;
+    count_ = total;
+}
+
+double MomentAccumulator::count() const {
+    return count_;
+}
+
+double MomentAccumulator::mean() const {
+    return mean_;
+}
+
+double MomentAccumulator::variance() const {
+    return count_ > 1.0 ? m2_ / (count_ - 1.0) : 0.0;
+}
+
+double MomentAccumulator::stdev() const {
+    return std::sqrt(variance());
+}
+
+void TreeAccumulator::add(const MomentAccumulator& block) {
+    MomentAccumulator carry = block;
+    size_t level = 0;
+    while (level < levels_.size() && occupied_[level]) {
+        // 低层的部分和代表更早的块，放在左边合并
+        MomentAccumulator merged = levels_[level];
+        merged.merge(carry);
+        carry = merged;
+        occupied_[level] = false;
+        ++level;
+    }
+    if (level == levels_.size()) {
+        levels_.push_back(carry);
+        occupied_.push_back(true);
+    } else {
+        levels_[level] = carry;
+        occupied_[level] = true;
+    }
+}
+
+MomentAccumulator TreeAccumulator::result() const {
+    // 高层代表更早的块，从高到低依次合并
+    MomentAccumulator total;
+    for (size_t level = levels_.size(); level-- > 0; ) {
+        if (occupied_[level]) {
+            total.merge(levels_[level]);
+        }
+    }
+    return total;
+}
+
+StratifiedAccumulator::StratifiedAccumulator(const std::vector<double>& probabilities)
+    : probabilities_(probabilities), moments_(probabilities.size()), blockWeights_(probabilities.size(), 0.0), count_(0.0) {}
+
+void StratifiedAccumulator::add(const std::vector<MomentAccumulator>& block) {
+    double blockCount = 0.0;
+    for (const MomentAccumulator& moments : block) {
+        blockCount += moments.count();
+    }
+    for (std::size_t k = 0; k < probabilities_.size(); ++k) {
+        if (block[k].count() > 0.0) {
+            blockWeights_[k] += blockCount * blockCount / block[k].count();
+            moments_[k].add(block[k]);
+        }
+    }
+    count_ += blockCount;
+}
+
+bool StratifiedAccumulator::empty() const {
+    return probabilities_.empty();
+}
+
+double StratifiedAccumulator::standardError() const {
+    if (count_ == 0.0) {
+        return 0.0;
+    }
+    double variance = 0.0;
+    for (std::size_t k = 0; k < probabilities_.size(); ++k) {
+        variance += probabilities_[k] * probabilities_[k] * moments_[k].result().variance() * blockWeights_[k];
+    }
+    return std::sqrt(variance) / count_;
+}
+
+QuantileSketch::QuantileSketch(double compression)
+    : compression_(compression), count_(0.0), min_(std::numeric_limits<double>::infinity()), max_(-std::numeric_limits<double>::infinity()) {
+    if (compression < 10.0) {
+        throw std::runtime_error("QuantileSketch compression must be at least 10");
+    }
+}
+
+void QuantileSketch::add(double value, double weight) {
+    if (!(weight > 0.0)) {
+        return;
+    }
+    buffer_.push_back({value, weight});
+    count_ += weight;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    if (buffer_.size() >= static_cast<std::size_t>(5 * compression_)) {
+        flush();
+    }
+}
+
+void QuantileSketch::add(const Eigen::Ref<const Eigen::VectorXd>& values) {
+    for (Eigen::Index i = 0; i < values.size(); ++i) {
+        add(values(i), 1.0);
+    }
+}
+
+void QuantileSketch::add(const Eigen::Ref<const Eigen::VectorXd>& values, const Eigen::Ref<const Eigen::VectorXd>& weights) {
+    if (values.size() != weights.size()) {
+        throw std::runtime_error("QuantileSketch values and weights must have the same size");
+    }
+    for (Eigen::Index i = 0; i < values.size(); ++i) {
+        add(values(i), weights(i));
+    }
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+    other.flush();
+    if (other.centroids_.empty()) {
+        return;
+    }
+    buffer_.insert(buffer_.end(), other.centroids_.begin(), other.centroids_.end());
+    count_ += other.count_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    flush();
+}
+
+void QuantileSketch::flush() const {
+    if (buffer_.empty()) {
+        return;
+    }
+    std::vector<Centroid> all;
+    all.reserve(centroids_.size() + buffer_.size());
+    all.insert(all.end(), centroids_.begin(), centroids_.end());
+    all.insert(all.end(), buffer_.begin(), buffer_.end());
+    buffer_.clear();
+    std::sort(all.begin(), all.end(), [](const Centroid& a, const Centroid& b) { return a.mean < b.mean; });
+
+    // 相邻的质心在k尺度上的跨度不超过1时合并：q处允许的最大累计权重为 total * k^{-1}(k(q) + 1)
+    double total = 0.0;
+    for (const Centroid& c : all) {
+        total += c.weight;
+    }
+    const double scale = compression_ / (2.0 * kPi);
+    auto weight_limit = [&](double weightSoFar) {
+        const double k = scale * std::asin(std::min(1.0, std::max(-1.0, 2.0 * weightSoFar / total - 1.0))) + 1.0;
+        return total * (std::sin(std::min(k / scale, kPi / 2)) + 1.0) / 2.0;
+    };
+
+    centroids_.clear();
+    Centroid current = all.front();
+    double weightSoFar = 0.0;
+    double limit = weight_limit(0.0);
+    for (std::size_t i = 1; i < all.size(); ++i) {
+        const Centroid& next = all[i];
+        if (weightSoFar + current.weight + next.weight <= limit) {
+            current.weight += next.weight;
+            current.mean += (next.mean - current.mean) * next.weight / current.weight;
+        } else {
+            weightSoFar += current.weight;
+            centroids_.push_back(current);
+            limit = weight_limit(weightSoFar);
+            current = next;
+        }
+    }
+    centroids_.push_back(current);
+}
+
+double QuantileSketch::count() const {
+    return count_;
+}
+
+double QuantileSketch::min() const {
+    return min_;
+}
+
+double QuantileSketch::max() const {
+    return max_;
+}
+
+std::size_t QuantileSketch::getNumCentroids() const {
+    flush();
+    return centroids_.size();
+}
+
+// 分位数函数取为累计权重u上的分段线性函数，节点为(0, min)、每个质心的(中点累计权重, 均值)、(总权重, max)
+double QuantileSketch::quantile(double q) const {
+    flush();
+    if (centroids_.empty()) {
+        throw std::runtime_error("QuantileSketch is empty");
+    }
+    const double target = std::min(1.0, std::max(0.0, q)) * count_;
+    double previousU = 0.0;
+    double previousV = min_;
+    double cumulative = 0.0;
+    for (const Centroid& c : centroids_) {
+        const double u = cumulative + c.weight / 2.0;
+        if (target <= u) {
+            return u > previousU ? previousV + (c.mean - previousV) * (target - previousU) / (u - previousU) : c.mean;
+        }
+        previousU = u;
+        previousV = c.mean;
+        cumulative += c.weight;
+    }
+    return count_ > previousU ? previousV + (max_ - previousV) * (target - previousU) / (count_ - previousU) : max_;
+}
+
+double QuantileSketch::cdf(double x) const {
+    flush();
+    if (centroids_.empty()) {
+        throw std::runtime_error("QuantileSketch is empty");
+    }
+    if (x < min_) {
+        return 0.0;
+    }
+    if (x >= max_) {
+        return 1.0;
+    }
+    double previousU = 0.0;
+    double previousV = min_;
+    double cumulative = 0.0;
+    for (std::size_t i = 0; i <= centroids_.size(); ++i) {
+        const double u = i < centroids_.size() ? cumulative + centroids_[i].weight / 2.0 : count_;
+        const double v = i < centroids_.size() ? centroids_[i].mean : max_;
+        if (x < v) {
+            return (previousU + (u - previousU) * (x - previousV) / (v - previousV)) / count_;
+        }
+        previousU = u;
+        previousV = v;
+        if (i < centroids_.size()) {
+            cumulative += centroids_[i].weight;
+        }
+    }
+    return 1.0;
+}
+
+Eigen::VectorXd QuantileSketch::histogram(const Eigen::Ref<const Eigen::VectorXd>& edges) const {
+    if (edges.size() < 2) {
+        throw std::runtime_error("QuantileSketch histogram requires at least two edges");
+    }
+    Eigen::VectorXd probabilities(edges.size() - 1);
+    double lower = cdf(edges(0));
+    for (Eigen::Index k = 0; k + 1 < edges.size(); ++k) {
+        const double upper = cdf(edges(k + 1));
+        probabilities(k) = std::max(0.0, upper - lower);
+        lower = upper;
+    }
+    return probabilities;
+}
+
+double QuantileSketch::integral(double weight) const {
+    double area = 0.0;
+    double previousU = 0.0;
+    double previousV = min_;
+    double cumulative = 0.0;
+    for (std::size_t i = 0; i <= centroids_.size(); ++i) {
+        const double u = i < centroids_.size() ? cumulative + centroids_[i].weight / 2.0 : count_;
+        const double v = i < centroids_.size() ? centroids_[i].mean : max_;
+        if (weight <= u) {
+            const double end = u > previousU ? previousV + (v - previousV) * (weight - previousU) / (u - previousU) : v;
+            return area + (weight - previousU) * (previousV + end) / 2.0;
+        }
+        area += (u - previousU) * (previousV + v) / 2.0;
+        previousU = u;
+        previousV = v;
+        if (i < centroids_.size()) {
+            cumulative += centroids_[i].weight;
+        }
+    }
+    return area;
+}
+
+double QuantileSketch::lower_tail_mean(double q) const {
+    flush();
+    if (centroids_.empty() || !(q > 0.0 && q <= 1.0)) {
+        throw std::runtime_error("QuantileSketch lower_tail_mean requires a non-empty sketch and 0 < q <= 1");
+    }
+    return integral(q * count_) / (q * count_);
+}
+
+double QuantileSketch::upper_tail_mean(double q) const {
+    flush();
+    if (centroids_.empty() || !(q >= 0.0 && q < 1.0)) {
+        throw std::runtime_error("QuantileSketch upper_tail_mean requires a non-empty sketch and 0 <= q < 1");
+    }
+    return (integral(count_) - integral(q * count_)) / ((1.0 - q) * count_);
+}
@@ -0,0 +1,158 @@
+//
+//  TaskScheduler.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 原来的并行方式是每个chain一个std::thread，线程数固定为8，廉价的香草期权和昂贵的Heston障碍期权混在一起时无法均衡，
+// 嵌套并行（例如希腊字母的每个bump各自再做一次定价）还会成倍地创建线程。
+// 这里改为固定数量的工作线程 + 每线程一个双端队列：
+// 1. 本线程产生的任务压入自己的队尾，并从队尾取（LIFO，缓存友好，嵌套任务先完成）；
+// 2. 自己的队列为空时从其他线程的队首窃取（FIFO，偷走的通常是粒度最大的任务）；
+// 3. TaskGroup::wait不会阻塞线程，而是继续执行任务，直到本组任务全部完成。
+
+# include "TaskScheduler.hpp"
+
+namespace {
+thread_local TaskScheduler* currentScheduler = nullptr;
+thread_local unsigned int currentWorker = 0;
+}
+
+TaskScheduler::TaskScheduler(unsigned int numWorkers) : stop_(false), nextWorker_(0), queued_(0) {
+    numWorkers = std::max(1u, numWorkers);
+    for (unsigned int i = 0; i < numWorkers; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (unsigned int i = 0; i < numWorkers; ++i) {
+        threads_.emplace_back([this, i]() { worker_loop(i); });
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stop_ = true;
+    }
+    sleepCv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+TaskScheduler& TaskScheduler::instance() {
+    static TaskScheduler scheduler;
+    return scheduler;
+}
+
+unsigned int TaskScheduler::getNumWorkers() const {
+    return static_cast<unsigned int>(workers_.size());
+}
+
+void TaskScheduler::submit(Task task) {
+    unsigned int index = (currentScheduler == this) ? currentWorker : nextWorker_++ % getNumWorkers();
+    {
+        std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+        workers_[index]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);     // 在锁内修改计数，避免工作线程错过唤醒
+        ++queued_;
+    }
+    sleepCv_.notify_one();
+}
+
+bool TaskScheduler::pop_task(Task& task) {
+    const unsigned int numWorkers = getNumWorkers();
+    const bool isWorker = (currentScheduler == this);
+    bool found = false;
+
+    if (isWorker) {
+        Worker& own = *workers_[currentWorker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            found = true;
+        }
+    }
+    // 从下一个线程开始依次窃取队首任务
+    unsigned int start = isWorker ? currentWorker + 1 : nextWorker_.load();
+    for (unsigned int k = 0; k < numWorkers && !found; ++k) {
+        Worker& victim = *workers_[(start + k) % numWorkers];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            found = true;
+        }
+    }
+    if (found) {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        --queued_;
+    }
+    return found;
+}
+
+bool TaskScheduler::try_run_one() {
+    Task task;
+    if (!pop_task(task)) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+void TaskScheduler::worker_loop(unsigned int index) {
+    currentScheduler = this;
+    currentWorker = index;
+    while (true) {
+        if (try_run_one()) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleepCv_.wait(lock, [this]() { return stop_ || queued_ > 0; });
+        if (stop_ && queued_ == 0) {
+            return;
+        }
+    }
+}
+
+TaskGroup::TaskGroup(TaskScheduler& scheduler) : scheduler_(scheduler), pending_(0) {}
+
+TaskGroup::~TaskGroup() {
+    // 析构时不能抛出异常，未被wait取走的异常直接丢弃
+    while (pending_ > 0) {
+        if (!scheduler_.try_run_one()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void TaskGroup::run(TaskScheduler::Task task) {
+    ++pending_;
+    scheduler_.submit([this, task = std::move(task)]() {
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+        }
+        --pending_;
+    });
+}
+
+void TaskGroup::wait() {
+    while (pending_ > 0) {
+        if (!scheduler_.try_run_one()) {
+            std::this_thread::yield();
+        }
+    }
+    std::lock_guard<std::mutex> lock(errorMutex_);
+    if (error_) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,126 @@
+//
+//  TermStructurePricer.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+
+# include "TermStructurePricer.hpp"
+# include "MonteCarloSimulator.hpp"
+# include "PricingModel.hpp"
+# include "Payoff.hpp"
+# include "RateModel.hpp"
+# include <cmath>
+# include <stdexcept>
+
+namespace {
+// (payoff, 到期日)的价格表：每个路径块先算好所有到期日的折现因子，cell = payoff序号 * 到期日数 + 到期日序号
+class StripEvaluator : public SharedPathEvaluator {
+public:
+    StripEvaluator(const std::vector<const Payoff*>& payoffs, const std::vector<const Parameters*>& payoffParams,
+                   const std::vector<int>& steps, const RateModel& rateModel, double dt)
+        : payoffs_(payoffs), payoffParams_(payoffParams), steps_(steps), rateModel_(rateModel), dt_(dt), discountFactors_(Pricing::kNumChains) {}
+
+    std::size_t getNumCells() const override {
+        return payoffs_.size() * steps_.size();
+    }
+
+    void begin_block(int chain, const MonteCarloSimulator& simulator) override {
+        Eigen::MatrixXd& discountFactors = discountFactors_[chain];
+        discountFactors.resize(simulator.get_price_paths().rows(), steps_.size());
+        for (std::size_t m = 0; m < steps_.size(); ++m) {
+            Pricing::calculate_discount_factors(simulator, rateModel_, dt_, steps_[m], discountFactors.col(m));
+        }
+    }
+
+    // 期初到第steps_[m]步的路径，payoff看到的就是以该日为到期日的路径
+    void evaluate(int chain, const MonteCarloSimulator& simulator, std::size_t cell, Eigen::Ref<Eigen::VectorXd> values) const override {
+        const std::size_t p = cell / steps_.size();
+        const std::size_t m = cell % steps_.size();
+        payoffs_[p]->evaluate(*payoffParams_[p], simulator.get_price_paths().leftCols(steps_[m] + 1), values);
+        values.array() *= discountFactors_[chain].col(m).array();
+    }
+
+    // 第一个payoff在最后一个到期日的payoff反馈给自适应抽样
+    std::size_t getSamplingCell() const override {
+        return steps_.size() - 1;
+    }
+
+private:
+    const std::vector<const Payoff*>& payoffs_;
+    const std::vector<const Parameters*>& payoffParams_;
+    const std::vector<int>& steps_;
+    const RateModel& rateModel_;
+    double dt_;
+    std::vector<Eigen::MatrixXd> discountFactors_;      // 每个chain的 路径数 x 到期日数
+};
+}
+
+TermStructurePricer::TermStructurePricer(const PricingModel& pathModel, const Parameters& params)
+    : pathModel_(pathModel), params_(params), dt_(params.get<double>("dt")) {
+    if (params.contains("importanceSampling") && params.get<bool>("importanceSampling")) {
+        throw std::runtime_error("TermStructurePricer does not support importance sampling");
+    }
+    const std::vector<double>& times = params.getRef<std::vector<double>>("observationTimes");
+    if (times.empty()) {
+        throw std::runtime_error("TermStructurePricer requires at least one observation time");
+    }
+    for (double t : times) {
+        const int step = static_cast<int>(std::lround(t / dt_));
+        if (step < 1 || (!steps_.empty() && step <= steps_.back())) {
+            throw std::runtime_error("Observation times must be increasing and at least one time step apart");
+        }
+        steps_.push_back(step);
+    }
+    params_.set<double>("numSteps", static_cast<double>(steps_.back()));
+}
+
+std::size_t TermStructurePricer::add_payoff(const Payoff& payoff, const Parameters& payoffParams) {
+    payoffs_.push_back({&payoff, payoffParams});
+    return payoffs_.size() - 1;
+}
+
+std::size_t TermStructurePricer::add_payoff(const Payoff& payoff) {
+    return add_payoff(payoff, params_);
+}
+
+const std::vector<int>& TermStructurePricer::getSteps() const {
+    return steps_;
+}
+
+std::vector<double> TermStructurePricer::getMaturities() const {
+    std::vector<double> maturities;
+    for (int step : steps_) {
+        maturities.push_back(step * dt_);
+    }
+    return maturities;
+}
+
+std::vector<std::vector<PricingResult>> TermStructurePricer::price() const {
+    if (payoffs_.empty()) {
+        throw std::runtime_error("TermStructurePricer has no payoffs");
+    }
+    std::vector<const Payoff*> payoffs;
+    std::vector<const Parameters*> payoffParams;
+    for (const PayoffEntry& entry : payoffs_) {
+        payoffs.push_back(entry.payoff);
+        payoffParams.push_back(&entry.params);
+    }
+    StripEvaluator evaluator(payoffs, payoffParams, steps_, pathModel_.getRateModel(), dt_);
+    const std::vector<PricingResult> cells = Pricing::calculateSharedResults(pathModel_, params_, evaluator);
+
+    // payoff自己的confidenceLevel覆盖构造时params中的值
+    const std::size_t numMaturities = steps_.size();
+    std::vector<std::vector<PricingResult>> results(payoffs_.size(), std::vector<PricingResult>(numMaturities));
+    for (std::size_t p = 0; p < payoffs_.size(); ++p) {
+        const Parameters& params = payoffs_[p].params;
+        const double z = Pricing::get_z_value(params.contains("confidenceLevel") ? params.get<double>("confidenceLevel") : params_.get<double>("confidenceLevel"));
+        for (std::size_t m = 0; m < numMaturities; ++m) {
+            PricingResult& result = results[p][m];
+            result = cells[p * numMaturities + m];
+            result.lowerBound = result.price - z * result.standardError;
+            result.upperBound = result.price + z * result.standardError;
+        }
+    }
+    return results;
+}
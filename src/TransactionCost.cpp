@@ -8,15 +8,28 @@
 
 # include "TransactionCost.hpp"
 
+void TransactionCost::getCostColumn(const Eigen::Ref<const Eigen::ArrayXd>& transactionSizes, Eigen::Ref<Eigen::ArrayXd> costs) const {
+    for (Eigen::Index i = 0; i < transactionSizes.size(); ++i) {
+        costs(i) = transactionSizes(i) == 0.0 ? 0.0 : getCost(transactionSizes(i));
+    }
+}
 
 // 零交易成本实现
 double ZeroTransactionCost::getCost(double transactionSize) const {
     return 0.0;
 }
 
+void ZeroTransactionCost::getCostColumn(const Eigen::Ref<const Eigen::ArrayXd>& /*transactionSizes*/, Eigen::Ref<Eigen::ArrayXd> costs) const {
+    costs.setZero();
+}
+
 // 固定交易成本实现
 FixedTransactionCost::FixedTransactionCost(double cost) : cost(cost) {}
 
 double FixedTransactionCost::getCost(double transactionSize) const {
     return cost;
 }
+
+void FixedTransactionCost::getCostColumn(const Eigen::Ref<const Eigen::ArrayXd>& transactionSizes, Eigen::Ref<Eigen::ArrayXd> costs) const {
+    costs = (transactionSizes != 0.0).cast<double>() * cost;
+}
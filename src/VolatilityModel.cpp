@@ -24,8 +24,18 @@
 # include "VolatilityModel.hpp"
 # include <cmath>
 # include <random>
+# include <algorithm>
+# include <stdexcept>
 # include "Parameters.hpp"
 
+bool VolatilityModel::supportsColumnEvaluation() const {
+    return false;
+}
+
+void VolatilityModel::getVolatilityColumn(const Parameters& /*params*/, double /*t*/, const Eigen::Ref<const Eigen::VectorXd>& /*spots*/, Eigen::Ref<Eigen::VectorXd> /*volatilities*/) const {
+    throw std::runtime_error("This volatility model does not support column evaluation");
+}
+
 // ConstantVolatilityModel implementation
 ConstantVolatilityModel::ConstantVolatilityModel(const Parameters& params) {}
 
@@ -33,26 +43,186 @@ double ConstantVolatilityModel::getVolatility(const Parameters& params) const {
     return params.get<double>("vt");
 }
 
+// LocalVolatilityModel implementation
+// Gatheral用总隐含方差w(y, T) = sigma_imp^2 * T表示的Dupire公式，y = ln(K / F_T)，F_T = S0 * e^(rT)：
+// sigma_loc^2 = (dw/dT) / (1 - y / w * dw/dy + 1/4 * (-1/4 - 1/w + y^2 / w^2) * (dw/dy)^2 + 1/2 * d2w/dy2)
+// dw/dy、d2w/dy2在同一到期日上用非均匀三点差分；dw/dT在固定y上差分，相邻到期日在该y处线性插值（超出行权价范围时隐含波动率取边界值），
+// T = 0处w = 0。分母和局部方差都截断在合理范围内，避免隐含波动率网格的噪声产生负的局部方差
+namespace {
+const double kMinLocalVariance = 1e-4;      // 局部波动率不低于1%
+const double kMaxLocalVariance = 25.0;      // 不高于500%
+const double kMinDenominator = 1e-3;
+
+// 对非均匀节点(x, f)在x0处线性插值，超出范围时取边界值
+double interpolate_flat(const std::vector<double>& x, const std::vector<double>& f, double x0) {
+    if (x0 <= x.front()) {
+        return f.front();
+    }
+    if (x0 >= x.back()) {
+        return f.back();
+    }
+    size_t j = std::upper_bound(x.begin(), x.end(), x0) - x.begin();
+    double weight = (x0 - x[j - 1]) / (x[j] - x[j - 1]);
+    return f[j - 1] + weight * (f[j] - f[j - 1]);
+}
+}
+
+LocalVolatilityModel::LocalVolatilityModel(const Parameters& params)
+    : maturities_(params.get<std::vector<double>>("impliedVolMaturities")) {
+    const std::vector<double> strikes = params.get<std::vector<double>>("impliedVolStrikes");
+    const Eigen::MatrixXd& impliedVol = params.getRef<Eigen::MatrixXd>("impliedVolGrid");
+    const Eigen::Index numMaturities = static_cast<Eigen::Index>(maturities_.size());
+    const Eigen::Index numStrikes = static_cast<Eigen::Index>(strikes.size());
+    if (numStrikes < 3 || numMaturities < 1 || impliedVol.rows() != numMaturities || impliedVol.cols() != numStrikes) {
+        throw std::runtime_error("LocalVolatilityModel requires an impliedVolGrid of size maturities x strikes with at least 3 strikes");
+    }
+    const double spot = params.get<double>("spot");
+    const double rate = params.get<double>("rate");
+
+    // 每个到期日上的对数在值程度y和总方差w
+    std::vector<std::vector<double>> y(numMaturities, std::vector<double>(numStrikes));
+    std::vector<std::vector<double>> w(numMaturities, std::vector<double>(numStrikes));
+    for (Eigen::Index i = 0; i < numMaturities; ++i) {
+        const double forward = spot * std::exp(rate * maturities_[i]);
+        for (Eigen::Index j = 0; j < numStrikes; ++j) {
+            y[i][j] = std::log(strikes[j] / forward);
+            w[i][j] = impliedVol(i, j) * impliedVol(i, j) * maturities_[i];
+        }
+    }
+
+    Eigen::MatrixXd nodeVol(numStrikes, numMaturities);
+    for (Eigen::Index i = 0; i < numMaturities; ++i) {
+        const double Tprev = i == 0 ? 0.0 : maturities_[i - 1];
+        const double Tnext = i + 1 < numMaturities ? maturities_[i + 1] : maturities_[i];
+        for (Eigen::Index j = 0; j < numStrikes; ++j) {
+            const Eigen::Index jl = std::max<Eigen::Index>(j - 1, 0);
+            const Eigen::Index jr = std::min<Eigen::Index>(j + 1, numStrikes - 1);
+            const Eigen::Index jc = std::min(std::max(j, Eigen::Index(1)), numStrikes - 2);    // 边界上的二阶导数取相邻内点
+            const double h1 = y[i][jc] - y[i][jc - 1];
+            const double h2 = y[i][jc + 1] - y[i][jc];
+            const double dwdy = (w[i][jr] - w[i][jl]) / (y[i][jr] - y[i][jl]);
+            const double d2wdy2 = 2.0 * (h1 * w[i][jc + 1] - (h1 + h2) * w[i][jc] + h2 * w[i][jc - 1]) / (h1 * h2 * (h1 + h2));
+
+            // 固定y在相邻到期日上的总方差
+            const double wPrev = i == 0 ? 0.0 : interpolate_flat(y[i - 1], w[i - 1], y[i][j]);
+            const double wNext = i + 1 < numMaturities ? interpolate_flat(y[i + 1], w[i + 1], y[i][j]) : w[i][j];
+            double dwdT = 0.0;
+            if (i + 1 < numMaturities) {
+                // 非均匀三点中心差分
+                const double k1 = maturities_[i] - Tprev;
+                const double k2 = Tnext - maturities_[i];
+                dwdT = (k1 * k1 * wNext + (k2 * k2 - k1 * k1) * w[i][j] - k2 * k2 * wPrev) / (k1 * k2 * (k1 + k2));
+            } else {
+                dwdT = (w[i][j] - wPrev) / (maturities_[i] - Tprev);
+            }
+
+            const double wij = w[i][j];
+            const double yij = y[i][j];
+            const double denominator = 1.0 - yij / wij * dwdy + 0.25 * (-0.25 - 1.0 / wij + yij * yij / (wij * wij)) * dwdy * dwdy + 0.5 * d2wdy2;
+            const double localVariance = std::max(dwdT, 0.0) / std::max(denominator, kMinDenominator);
+            nodeVol(j, i) = std::sqrt(std::min(std::max(localVariance, kMinLocalVariance), kMaxLocalVariance));
+        }
+    }
+
+    // 重新采样到均匀的行权价网格
+    const Eigen::Index numNodes = params.contains("localVolStrikeNodes") ? params.get<int>("localVolStrikeNodes") : 200;
+    if (numNodes < 2) {
+        throw std::runtime_error("localVolStrikeNodes must be at least 2");
+    }
+    strikeMin_ = strikes.front();
+    strikeStep_ = (strikes.back() - strikes.front()) / (numNodes - 1);
+    inverseStrikeStep_ = 1.0 / strikeStep_;
+    localVol_.resize(numNodes, numMaturities);
+    slopes_.resize(numNodes, numMaturities);
+    for (Eigen::Index i = 0; i < numMaturities; ++i) {
+        std::vector<double> column(nodeVol.col(i).data(), nodeVol.col(i).data() + numStrikes);
+        for (Eigen::Index j = 0; j < numNodes; ++j) {
+            localVol_(j, i) = interpolate_flat(strikes, column, strikeMin_ + j * strikeStep_);
+        }
+        for (Eigen::Index j = 0; j + 1 < numNodes; ++j) {
+            slopes_(j, i) = (localVol_(j + 1, i) - localVol_(j, i)) * inverseStrikeStep_;
+        }
+        slopes_(numNodes - 1, i) = 0.0;
+    }
+}
+
+// 第一个到期日之前和最后一个到期日之后取边界上的局部波动率，中间按时间线性插值
+void LocalVolatilityModel::locate_maturity(double t, Eigen::Index& lower, Eigen::Index& upper, double& weight) const {
+    const Eigen::Index last = static_cast<Eigen::Index>(maturities_.size()) - 1;
+    if (t <= maturities_.front()) {
+        lower = upper = 0;
+        weight = 0.0;
+        return;
+    }
+    if (t >= maturities_.back()) {
+        lower = upper = last;
+        weight = 0.0;
+        return;
+    }
+    upper = std::upper_bound(maturities_.begin(), maturities_.end(), t) - maturities_.begin();
+    lower = upper - 1;
+    weight = (t - maturities_[lower]) / (maturities_[upper] - maturities_[lower]);
+}
+
+double LocalVolatilityModel::localVolatility(double spot, double t) const {
+    Eigen::Index lower, upper;
+    double weight;
+    locate_maturity(t, lower, upper, weight);
+    const Eigen::Index last = localVol_.rows() - 1;
+    const double x = std::min(std::max((spot - strikeMin_) * inverseStrikeStep_, 0.0), static_cast<double>(last));
+    const Eigen::Index j = std::min(static_cast<Eigen::Index>(x), last - 1);
+    const double dK = (x - j) * strikeStep_;
+    return (1.0 - weight) * (localVol_(j, lower) + slopes_(j, lower) * dK) + weight * (localVol_(j, upper) + slopes_(j, upper) * dK);
+}
+
+double LocalVolatilityModel::getVolatility(const Parameters& params) const {
+    return localVolatility(params.get<double>("St"), params.get<int>("stepIndex") * params.get<double>("dt"));
+}
+
+bool LocalVolatilityModel::supportsColumnEvaluation() const {
+    return true;
+}
+
+// 时间方向的定位对整列只做一次，每条路径只剩一次乘法取下标和两次乘加，没有分支和二分查找
+void LocalVolatilityModel::getVolatilityColumn(const Parameters& /*params*/, double t, const Eigen::Ref<const Eigen::VectorXd>& spots, Eigen::Ref<Eigen::VectorXd> volatilities) const {
+    Eigen::Index lower, upper;
+    double weight;
+    locate_maturity(t, lower, upper, weight);
+    const double* vol0 = localVol_.col(lower).data();
+    const double* vol1 = localVol_.col(upper).data();
+    const double* slope0 = slopes_.col(lower).data();
+    const double* slope1 = slopes_.col(upper).data();
+    const double last = static_cast<double>(localVol_.rows() - 1);
+    const Eigen::Index lastCell = localVol_.rows() - 2;
+
+    for (Eigen::Index row = 0; row < spots.size(); ++row) {
+        const double x = std::min(std::max((spots(row) - strikeMin_) * inverseStrikeStep_, 0.0), last);
+        const Eigen::Index j = std::min(static_cast<Eigen::Index>(x), lastCell);
+        const double dK = (x - j) * strikeStep_;
+        volatilities(row) = (1.0 - weight) * (vol0[j] + slope0[j] * dK) + weight * (vol1[j] + slope1[j] * dK);
+    }
+}
+
 // HestonModel implementation
 HestonModel::HestonModel(const Parameters& params)
-    : kappa_HM_(params.get<double>("kappa_HM")), theta_HM_(params.get<double>("theta_HM")), xi_HM_(params.get<double>("xi_HM")), rho_HM_(params.get<double>("rho_HM")), dt_(params.get<double>("dt")) {}
+    : kappa_HM_(params.get<double>("kappa_HM")), theta_HM_(params.get<double>("theta_HM")), xi_HM_(params.get<double>("xi_HM")), rho_HM_(params.get<double>("rho_HM")) {}
 
 double HestonModel::getVolatility(const Parameters& params) const {
-    double volatility = params.get<double>("vt") + kappa_HM_ * (theta_HM_ - params.get<double>("vt")) * dt_ + xi_HM_ * std::sqrt(params.get<double>("vt")) * params.get<double>("dW_volatilit");
+    double volatility = params.get<double>("vt") + kappa_HM_ * (theta_HM_ - params.get<double>("vt")) * params.get<double>("dt") + xi_HM_ * std::sqrt(params.get<double>("vt")) * params.get<double>("dW_volatilit");
     return volatility;
 }
 
 // SABRModel implementation
 SABRModel::SABRModel(const Parameters& params)
-    : alpha_SABRM_(params.get<double>("alpha_SABRM")), beta_SABRM_(params.get<double>("beta_SABRM")), rho_SABRM_(params.get<double>("rho_SABRM")), nu_SABRM_(params.get<double>("nu_SABRM")), dt_(params.get<double>("dt")) {}
+    : alpha_SABRM_(params.get<double>("alpha_SABRM")), beta_SABRM_(params.get<double>("beta_SABRM")), rho_SABRM_(params.get<double>("rho_SABRM")), nu_SABRM_(params.get<double>("nu_SABRM")) {}
 
 double SABRModel::getVolatility(const Parameters& params) const {
-    return alpha_SABRM_ * std::pow(dt_, beta_SABRM_) * std::exp(nu_SABRM_ * params.get<double>("dW_volatility"));
+    return alpha_SABRM_ * std::pow(params.get<double>("dt"), beta_SABRM_) * std::exp(nu_SABRM_ * params.get<double>("dW_volatility"));
 }
 
 // GARCH模型实现
 GARCHModel::GARCHModel(const Parameters& params)
-    : alpha0_GARCHM_(params.get<double>("alpha0_GARCHM")), alpha1_GARCHM_(params.get<double>("alpha1_GARCHM")), beta_GARCHM_(params.get<double>("beta_GARCHM")),  dt_(params.get<double>("dt")) {}
+    : alpha0_GARCHM_(params.get<double>("alpha0_GARCHM")), alpha1_GARCHM_(params.get<double>("alpha1_GARCHM")), beta_GARCHM_(params.get<double>("beta_GARCHM")) {}
 
 double GARCHModel::getVolatility(const Parameters& params) const {
     double vol = std::sqrt(alpha0_GARCHM_ + alpha1_GARCHM_ * std::pow(params.get<double>("dW_volatility"), 2) + beta_GARCHM_ * std::pow(params.get<double>("vt"), 2)); // 示例实现
@@ -61,10 +231,10 @@ double GARCHModel::getVolatility(const Parameters& params) const {
 
 // JumpDiffusionModel implementation
 JumpDiffusionModel::JumpDiffusionModel(const Parameters& params)
-    : jumpMean_JDM_(params.get<double>("jumpMean_JDM")), jumpVol_JDM_(params.get<double>("jumpVol_JDM")), dt_(params.get<double>("dt")) {}
+    : jumpMean_JDM_(params.get<double>("jumpMean_JDM")), jumpVol_JDM_(params.get<double>("jumpVol_JDM")) {}
 
 double JumpDiffusionModel::getVolatility(const Parameters& params) const {
-    return params.get<double>("vt") * (1 + jumpMean_JDM_ * dt_) + jumpVol_JDM_ * params.get<double>("dW_volatility");
+    return params.get<double>("vt") * (1 + jumpMean_JDM_ * params.get<double>("dt")) + jumpVol_JDM_ * params.get<double>("dW_volatility");
 }
 
 
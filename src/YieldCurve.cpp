@@ -0,0 +1,155 @@
+//
+//  YieldCurve.cpp
+//  DerivativesPricing
+//
+//  Created by 俊延 on 2026/10/19.
+//
+// 对数线性插值：ln P(0, t)在相邻节点之间线性，等价于节点之间的瞬时远期利率为常数，保证折现因子为正且单调（远期利率为正时）。
+// 最后一个节点之后沿用最后一段的远期利率外推。
+
+# include "YieldCurve.hpp"
+# include <algorithm>
+# include <cmath>
+# include <stdexcept>
+
+YieldCurve::YieldCurve(const std::vector<double>& times, const std::vector<double>& discountFactors) {
+    if (times.empty() || times.size() != discountFactors.size()) {
+        throw std::runtime_error("YieldCurve requires matching, non-empty times and discount factors");
+    }
+    times_.push_back(0.0);
+    logDiscounts_.push_back(0.0);
+    for (size_t i = 0; i < times.size(); ++i) {
+        if (times[i] <= times_.back() || discountFactors[i] <= 0.0) {
+            throw std::runtime_error("YieldCurve times must be increasing and discount factors positive");
+        }
+        times_.push_back(times[i]);
+        logDiscounts_.push_back(std::log(discountFactors[i]));
+    }
+}
+
+std::shared_ptr<YieldCurve> YieldCurve::bootstrap(std::vector<CurveQuote> quotes) {
+    std::sort(quotes.begin(), quotes.end(), [](const CurveQuote& a, const CurveQuote& b) { return a.maturity < b.maturity; });
+
+    // 自举过程中的节点，包含P(0, 0) = 1
+    std::vector<double> times{0.0};
+    std::vector<double> logDiscounts{0.0};
+    // t不超过最后一个已知节点时在已知节点间插值；否则在最后一个已知节点与待求节点y = ln P(0, T)之间插值，weight为y的权重
+    auto interpolate = [&](double t, double maturity, double y, double& weight) {
+        if (t <= times.back()) {
+            weight = 0.0;
+            size_t j = std::min<size_t>(std::upper_bound(times.begin(), times.end(), t) - times.begin(), times.size() - 1);
+            return logDiscounts[j - 1] + (logDiscounts[j] - logDiscounts[j - 1]) * (t - times[j - 1]) / (times[j] - times[j - 1]);
+        }
+        weight = (t - times.back()) / (maturity - times.back());
+        return logDiscounts.back() + weight * (y - logDiscounts.back());
+    };
+
+    for (const CurveQuote& quote : quotes) {
+        if (quote.maturity <= times.back()) {
+            throw std::runtime_error("YieldCurve::bootstrap: duplicate or non-positive maturity");
+        }
+
+        double y = 0.0;
+        if (quote.type == CurveQuote::Type::Deposit) {
+            y = -std::log(1.0 + quote.rate * quote.maturity);
+        } else {
+            // 平价条件 S * tau * sum P(t_i) + P(T) = 1，对y = ln P(T)做牛顿迭代
+            const int numPayments = static_cast<int>(std::lround(quote.maturity * quote.paymentsPerYear));
+            if (numPayments < 1) {
+                throw std::runtime_error("YieldCurve::bootstrap: swap shorter than one payment period");
+            }
+            const double tau = quote.maturity / numPayments;
+            y = -quote.rate * quote.maturity;
+            bool converged = false;
+            for (int iter = 0; iter < 50 && !converged; ++iter) {
+                double g = -1.0;
+                double dg = 0.0;
+                for (int i = 1; i <= numPayments; ++i) {
+                    double weight = 0.0;
+                    double P = std::exp(interpolate(i * tau, quote.maturity, y, weight));
+                    double cashflow = quote.rate * tau + (i == numPayments ? 1.0 : 0.0);
+                    g += cashflow * P;
+                    dg += cashflow * weight * P;
+                }
+                double step = g / dg;
+                y -= step;
+                converged = std::abs(step) < 1e-13;
+            }
+            if (!converged) {
+                throw std::runtime_error("YieldCurve::bootstrap: swap quote did not converge");
+            }
+        }
+        times.push_back(quote.maturity);
+        logDiscounts.push_back(y);
+    }
+
+    std::vector<double> discountFactors(logDiscounts.size() - 1);
+    std::transform(logDiscounts.begin() + 1, logDiscounts.end(), discountFactors.begin(), [](double l) { return std::exp(l); });
+    return std::make_shared<YieldCurve>(std::vector<double>(times.begin() + 1, times.end()), discountFactors);
+}
+
+double YieldCurve::log_discount(double t) const {
+    if (t <= 0.0) {
+        return 0.0;
+    }
+    auto it = std::upper_bound(times_.begin(), times_.end(), t);
+    size_t j = it - times_.begin();    // times_[j - 1] <= t < times_[j]
+    if (j == times_.size()) {
+        j = times_.size() - 1;         // 最后一段向外延伸
+    }
+    double weight = (t - times_[j - 1]) / (times_[j] - times_[j - 1]);
+    return logDiscounts_[j - 1] + weight * (logDiscounts_[j] - logDiscounts_[j - 1]);
+}
+
+double YieldCurve::discount(double t) const {
+    return std::exp(log_discount(t));
+}
+
+double YieldCurve::zeroRate(double t) const {
+    if (t <= 0.0) {
+        return instantaneousForward(0.0);
+    }
+    return -log_discount(t) / t;
+}
+
+double YieldCurve::forwardRate(double t1, double t2) const {
+    if (t2 <= t1) {
+        return instantaneousForward(t1);
+    }
+    return (log_discount(t1) - log_discount(t2)) / (t2 - t1);
+}
+
+double YieldCurve::instantaneousForward(double t) const {
+    auto it = std::upper_bound(times_.begin(), times_.end(), std::max(t, 0.0));
+    size_t j = std::min<size_t>(it - times_.begin(), times_.size() - 1);
+    return (logDiscounts_[j - 1] - logDiscounts_[j]) / (times_[j] - times_[j - 1]);
+}
+
+const std::vector<double>& YieldCurve::getTimes() const {
+    return times_;
+}
+
+std::shared_ptr<const CurveGrid> YieldCurve::grid(double dt, int numSteps) const {
+    std::lock_guard<std::mutex> lock(gridMutex_);
+    for (const auto& cached : grids_) {
+        if (cached->dt == dt && cached->discountFactors.size() == numSteps + 1) {
+            return cached;
+        }
+    }
+
+    auto result = std::make_shared<CurveGrid>();
+    result->dt = dt;
+    result->discountFactors.resize(numSteps + 1);
+    result->forwardRates.resize(numSteps + 2);     // 多一步，供最后一列的利率使用
+    double previous = 0.0;
+    for (int k = 0; k <= numSteps + 1; ++k) {
+        double next = log_discount((k + 1) * dt);
+        if (k <= numSteps) {
+            result->discountFactors(k) = std::exp(previous);
+        }
+        result->forwardRates(k) = (previous - next) / dt;
+        previous = next;
+    }
+    grids_.push_back(result);
+    return result;
+}
@@ -73,8 +73,49 @@
 # include "TransactionCost.hpp"
 # include "ModelParams.hpp"
 # include "Pricing.hpp"
+# include "PortfolioRunner.hpp"
+# include "RandomNumberGenerator.hpp"
+# include <string>
+# include <random>
+# include <chrono>
+
+int main(int argc, char** argv) {
+    // 随机数基准：DerivativesPricing --benchmark-rng，比较各指令集的批量正态数生成速度与std::normal_distribution
+    if (argc == 2 && std::string(argv[1]) == "--benchmark-rng") {
+        const std::size_t count = 50000000;
+        for (RandomNumberGenerator::SimdLevel level : {RandomNumberGenerator::SimdLevel::Portable, RandomNumberGenerator::SimdLevel::SSE2,
+                                                       RandomNumberGenerator::SimdLevel::AVX2, RandomNumberGenerator::SimdLevel::AVX512}) {
+            // x86上Portable与SSE2是同一个内核
+            const bool duplicate = level == RandomNumberGenerator::SimdLevel::Portable && RandomNumberGenerator::is_supported(RandomNumberGenerator::SimdLevel::SSE2);
+            if (RandomNumberGenerator::is_supported(level) && !duplicate) {
+                std::cout << RandomNumberGenerator::simd_name(level) << ": " << RandomNumberGenerator::benchmark(level, count) / 1e6 << " M normals/s" << std::endl;
+            }
+        }
+        std::mt19937 gen(12345);
+        std::normal_distribution<> dis(0.0, 1.0);
+        double sum = 0.0;
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < count; ++i) {
+            sum += dis(gen);
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "std::normal_distribution: " << count / seconds / 1e6 << " M normals/s (checksum " << sum << ")" << std::endl;
+        std::cout << "Selected: " << RandomNumberGenerator::simd_name(RandomNumberGenerator::detect_simd_level()) << std::endl;
+        return 0;
+    }
+    // 批量定价：DerivativesPricing <交易文件> <输出文件>
+    if (argc >= 3) {
+        try {
+            PortfolioRunner runner(argv[1]);
+            std::vector<TradeResult> results = runner.run();
+            runner.write_results(argv[2], results);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
 
-int main() {
     /*
     ModelParams modelParams;
     std::vector<std::string> availableModels = modelParams.getAvailableModels();